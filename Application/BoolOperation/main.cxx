@@ -27,7 +27,6 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkInteractorEventRecorder.h"
 #include "vtkTextProperty.h"
 #include "vtkBezierSurfaceSource.h"
-#include "vtkPolyDataNormals.h"
 #include "vtkDataSetMapper.h"
 #include "vtkBezierSurfaceWidget.h"
 
@@ -43,10 +42,9 @@ int main(int vtkNotUsed(argc), char *vtkNotUsed(argv)[])
 		}
 	}
 
-	vtkNew<vtkPolyDataNormals> polydatanormals;
-	polydatanormals->SetInputConnection(besizersurfacesource->GetOutputPort());
+	besizersurfacesource->GenerateNormalsOn();
 	vtkNew<vtkDataSetMapper> mapper;
-	mapper->SetInputConnection(polydatanormals->GetOutputPort());
+	mapper->SetInputConnection(besizersurfacesource->GetOutputPort());
 	vtkNew<vtkActor> actor;
 	actor->SetMapper(mapper);
 	vtkNew<vtkRenderer> renderer;
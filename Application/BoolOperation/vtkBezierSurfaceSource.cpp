@@ -37,25 +37,61 @@ Credits:
 #include "vtkCellArray.h"
 #include "vtkPointData.h"
 #include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
 #include "vtkImageData.h"
 #include "vtkExecutive.h"
+#include "vtkStructuredGrid.h"
 #include "vtkOutputWindow.h"
+#include "vtkSMPTools.h"
+#include "vtkVersion.h"
+#include "vtkRenderer.h"
+#include "vtkCamera.h"
+#include "vtkMath.h"
 #include <math.h>
+#include <algorithm>
+#include <functional>
+#include <map>
 
 vtkStandardNewMacro(vtkBezierSurfaceSource);
 
+// Number of rank-1 updates applied to the cached surface before it is
+// evaluated from scratch again, so that round-off cannot accumulate.
+static const int MaxIncrementalUpdates = 256;
+
 vtkBezierSurfaceSource::vtkBezierSurfaceSource()
 {
     this->Dimensions[0] = 10;
     this->Dimensions[1] = 10;
 
+    this->BasisTableSize[0] = this->BasisTableSize[1] = 0;
+    this->BasisTableSize[2] = this->BasisTableSize[3] = 0;
+
+    this->IncrementalUpdate = 1;
+    this->GenerateNormals = 0;
+    this->GenerateTangents = 0;
+    this->DerivativesValid = 0;
+
+    this->TessellationMode = UNIFORM_TESSELLATION;
+    this->FlatnessTolerance = 0.001;
+    this->ScreenSpaceError = 1.0;
+    this->MaximumSubdivisionLevel = 6;
+    this->SurfaceValid = 0;
+    this->IncrementalUpdateCount = 0;
+    this->SurfacePoints = 0;
+    this->SurfaceTCoords = 0;
+    this->SurfaceCells = 0;
+    this->GenerateSurfaceCells = 1;
+    this->SurfaceGridSize[0] = this->SurfaceGridSize[1] = 0;
+    this->QueryTreeValid = 0;
+    this->QueryTreeDiagonal = 0;
+
     this->NumberOfControlPoints[0] = 0;
     this->NumberOfControlPoints[1] = 0;
     this->ControlPoints = 0;
     this->SetNumberOfControlPoints(4, 4);
 
     this->SetNumberOfInputPorts(0);
-    this->SetNumberOfOutputPorts(2);
+    this->SetNumberOfOutputPorts(3);
 
     vtkPolyData *output2 = vtkPolyData::New();
     this->GetExecutive()->SetOutputData(1, output2);
@@ -66,6 +102,12 @@ vtkBezierSurfaceSource::~vtkBezierSurfaceSource()
 {
     if(this->ControlPoints)
         delete [] this->ControlPoints;
+    if(this->SurfacePoints)
+        this->SurfacePoints->Delete();
+    if(this->SurfaceTCoords)
+        this->SurfaceTCoords->Delete();
+    if(this->SurfaceCells)
+        this->SurfaceCells->Delete();
 }
 
 void vtkBezierSurfaceSource::PrintSelf(ostream& os, vtkIndent indent)
@@ -74,6 +116,15 @@ void vtkBezierSurfaceSource::PrintSelf(ostream& os, vtkIndent indent)
 
     os << "Dimensions: " << this->Dimensions[0] << ", " << this->Dimensions[1] << "\n";
     os << "Number of Control Points : " << this->NumberOfControlPoints[0] << ", " << this->NumberOfControlPoints[1] << "\n";
+    os << "Incremental Update: " << (this->IncrementalUpdate ? "On" : "Off") << "\n";
+    os << "Generate Surface Cells: " << (this->GenerateSurfaceCells ? "On" : "Off") << "\n";
+    os << "Generate Normals: " << (this->GenerateNormals ? "On" : "Off") << "\n";
+    os << "Generate Tangents: " << (this->GenerateTangents ? "On" : "Off") << "\n";
+    os << "Tessellation Mode: " << (this->TessellationMode == ADAPTIVE_TESSELLATION ? "Adaptive" : "Uniform") << "\n";
+    os << "Flatness Tolerance: " << this->FlatnessTolerance << "\n";
+    os << "Screen Space Error: " << this->ScreenSpaceError << "\n";
+    os << "Maximum Subdivision Level: " << this->MaximumSubdivisionLevel << "\n";
+    os << "Renderer: " << this->Renderer.GetPointer() << "\n";
 
     int index = 0;
     for(int i=0; i<this->NumberOfControlPoints[0]; i++)
@@ -98,6 +149,22 @@ vtkPolyData* vtkBezierSurfaceSource::GetBezierSurfaceOutput()
     return vtkPolyData::SafeDownCast( this->GetExecutive()->GetOutputData(0) );
 }
 
+vtkStructuredGrid* vtkBezierSurfaceSource::GetStructuredGridOutput()
+{
+    return vtkStructuredGrid::SafeDownCast( this->GetExecutive()->GetOutputData(2) );
+}
+
+int vtkBezierSurfaceSource::FillOutputPortInformation(int port, vtkInformation* info)
+{
+    if(port == 2)
+    {
+        info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkStructuredGrid");
+        return 1;
+    }
+
+    return this->Superclass::FillOutputPortInformation(port, info);
+}
+
 void vtkBezierSurfaceSource::SetNumberOfControlPoints(int m, int n)
 {
     if( this->NumberOfControlPoints[0] == m && this->NumberOfControlPoints[1] == n )
@@ -114,6 +181,8 @@ void vtkBezierSurfaceSource::SetNumberOfControlPoints(int m, int n)
     if(this->ControlPoints)
         delete [] this->ControlPoints;
 
+    m = this->NumberOfControlPoints[0];
+    n = this->NumberOfControlPoints[1];
     this->ControlPoints = new double[m*n*3];
     this->ResetControlPoints();
 }
@@ -126,12 +195,22 @@ void vtkBezierSurfaceSource::SetControlPoint(int m, int n, double pt[3])
     if(n < 0 || n >= this->NumberOfControlPoints[1])
         return;
 
-    int index = n + m*this->NumberOfControlPoints[0];
+    int index = n + m*this->NumberOfControlPoints[1];
     double* cpt = this->ControlPoints + (index*3);
+    if(cpt[0] == pt[0] && cpt[1] == pt[1] && cpt[2] == pt[2])
+        return;
+
     cpt[0] = pt[0];
     cpt[1] = pt[1];
     cpt[2] = pt[2];
 
+    // Remember which control point moved, so that the next update only has
+    // to add its contribution to the cached surface.
+    if(std::find(this->DirtyControlPoints.begin(), this->DirtyControlPoints.end(), index) ==
+       this->DirtyControlPoints.end())
+        this->DirtyControlPoints.push_back(index);
+
+    this->QueryTreeValid = 0;
     this->Modified();
 }
 
@@ -143,14 +222,14 @@ void vtkBezierSurfaceSource::GetControlPoint(int m, int n, double pt[3])
     if(n < 0 || n >= this->NumberOfControlPoints[1])
         return;
 
-    int index = n + m*this->NumberOfControlPoints[0];
+    int index = n + m*this->NumberOfControlPoints[1];
     double* cpt = this->ControlPoints + (index*3);
     pt[0] = cpt[0];
     pt[1] = cpt[1];
     pt[2] = cpt[2];
 }
 
-double* vtkBezierSurfaceSource::GetControlPoint(int m, int n)
+const double* vtkBezierSurfaceSource::GetControlPoint(int m, int n)
 {
     if(m < 0 || m >= this->NumberOfControlPoints[0])
         return 0;
@@ -158,8 +237,8 @@ double* vtkBezierSurfaceSource::GetControlPoint(int m, int n)
     if(n < 0 || n >= this->NumberOfControlPoints[1])
         return 0;
 
-    int index = n + m*this->NumberOfControlPoints[0];
-    double* cpt = this->ControlPoints + (index*3);
+    int index = n + m*this->NumberOfControlPoints[1];
+    const double* cpt = this->ControlPoints + (index*3);
     return cpt;
 }
 
@@ -186,6 +265,8 @@ void vtkBezierSurfaceSource::ResetControlPoints()
         }
     }
 
+    this->SurfaceValid = 0;
+    this->QueryTreeValid = 0;
     this->Modified();
 }
 
@@ -197,6 +278,7 @@ void vtkBezierSurfaceSource::SetDimensions(int x, int y)
     this->Dimensions[0] = x;
     this->Dimensions[1] = y;
 
+    this->SurfaceValid = 0;
     this->Modified();
 }
 
@@ -218,6 +300,13 @@ int vtkBezierSurfaceSource::RequestData(
     {
         vtkPolyData *bsOutput = vtkPolyData::SafeDownCast(bsOutInfo->Get(vtkDataObject::DATA_OBJECT()));
         this->UpdateBezierSurfacePolyData(bsOutput);
+
+        vtkInformation *sgOutInfo = outputVector->GetInformationObject(2);
+        if(sgOutInfo)
+        {
+            vtkStructuredGrid *sgOutput = vtkStructuredGrid::SafeDownCast(sgOutInfo->Get(vtkDataObject::DATA_OBJECT()));
+            this->UpdateStructuredGrid(sgOutput, bsOutput);
+        }
     }
 
     return 1;
@@ -228,17 +317,14 @@ void vtkBezierSurfaceSource::UpdateControlPointsPolyData(vtkPolyData* pd)
     if(!pd)
         return;
 
-    // Create points array (geometry)
-    vtkPoints* points = vtkPoints::New();
+    // Create points array (geometry). The control points are already
+    // packed xyz doubles, so they are copied in one go.
+    vtkPoints* points = vtkPoints::New(VTK_DOUBLE);
 
     int nrPoints = this->NumberOfControlPoints[0]*this->NumberOfControlPoints[1];
     points->SetNumberOfPoints(nrPoints);
-
-    for(int i=0; i<nrPoints; i++)
-    {
-        double* pt = this->ControlPoints + (i*3);
-        points->SetPoint(i, pt);
-    }
+    std::copy(this->ControlPoints, this->ControlPoints + nrPoints*3,
+              vtkDoubleArray::SafeDownCast(points->GetData())->GetPointer(0));
 
     pd->SetPoints(points);
     points->Delete();
@@ -283,154 +369,1488 @@ http://local.wasp.uwa.edu.au/~pbourke/geometry/bezier/index.html
 
 Credits to Paul Bourke for explaining Bezier surfaces so well.
 */
-// Methods used while computing the bezier surface
-double BezierBlend(int k, double mu, int n);
-void EvalBezierSurface(const double* controlPoints, int m, int n, int dimx, int dimy, vtkPoints* surfacePoints);
+namespace
+{
+// out(j) = sum_k q(k) * b(k, j) for the j = 0..dimy-1 samples of one row.
+// q holds n xyz triplets and b is an n x dimy table.
+inline void AccumulateRow(const double* q, const double* b, int n, int dimy, double* out)
+{
+    for(int j=0; j<dimy*3; j++)
+        out[j] = 0;
+
+    for(int k=0; k<n; k++)
+    {
+        const double qx = q[k*3];
+        const double qy = q[k*3+1];
+        const double qz = q[k*3+2];
+        const double* bk = b + k*dimy;
+        for(int j=0; j<dimy; j++)
+        {
+            out[j*3]   += bk[j] * qx;
+            out[j*3+1] += bk[j] * qy;
+            out[j*3+2] += bk[j] * qz;
+        }
+    }
+}
+
+// q = sum_k b(k) * P(k, :) for the m rows of the control net.
+inline void CombineControlRows(const double* controlPoints, const double* b, int m, int rowLength, double* q)
+{
+    for(int c=0; c<rowLength; c++)
+        q[c] = 0;
+
+    for(int k=0; k<m; k++)
+    {
+        const double bk = b[k];
+        const double* p = controlPoints + k*rowLength;
+        for(int c=0; c<rowLength; c++)
+            q[c] += bk * p[c];
+    }
+}
+
+// Evaluates rows [begin, end) of the u-sampled surface as
+// S(i, :) = (Bu(i, :) * P) * Bv^T. When derivative outputs are given the
+// partial derivatives Su = (Bu' * P) * Bv^T and Sv = (Bu * P) * Bv'^T are
+// produced in the same pass. Every row only writes its own slice of the
+// partial-sum and output buffers, so rows can run concurrently.
+class EvaluateSurfaceRows
+{
+public:
+    const double* ControlPoints;
+    const double* BasisU;
+    const double* BasisV;
+    const double* DBasisU;
+    const double* DBasisV;
+    double* PartialSums;
+    double* SurfacePoints;
+    double* DerivativesU;
+    double* DerivativesV;
+    int M, N, DimY;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        const int rowLength = this->N*3;
+        for(vtkIdType i=begin; i<end; i++)
+        {
+            const vtkIdType offset = i*this->DimY*3;
+
+            double* q = this->PartialSums + i*rowLength*2;
+            CombineControlRows(this->ControlPoints, this->BasisU + i*this->M, this->M, rowLength, q);
+            AccumulateRow(q, this->BasisV, this->N, this->DimY, this->SurfacePoints + offset);
+
+            if(this->DerivativesU)
+            {
+                double* dq = q + rowLength;
+                CombineControlRows(this->ControlPoints, this->DBasisU + i*this->M, this->M, rowLength, dq);
+                AccumulateRow(dq, this->BasisV, this->N, this->DimY, this->DerivativesU + offset);
+                AccumulateRow(q, this->DBasisV, this->N, this->DimY, this->DerivativesV + offset);
+            }
+        }
+    }
+};
+
+// Adds the contribution of one moved control point (Ki, Kj) to rows
+// [begin, end) of the surface: S(i, j) += Delta * Bu(i, Ki) * Bv(Kj, j).
+// The partial derivatives, when present, are patched the same way.
+class ApplyControlPointDelta
+{
+public:
+    const double* BasisU;
+    const double* BasisV;
+    const double* DBasisU;
+    const double* DBasisV;
+    double* SurfacePoints;
+    double* DerivativesU;
+    double* DerivativesV;
+    double Delta[3];
+    int M, DimY;
+    int Ki, Kj;
+
+    static void AddScaledRow(const double* b, const double d[3], int dimy, double* out)
+    {
+        for(int j=0; j<dimy; j++)
+        {
+            out[j*3]   += b[j] * d[0];
+            out[j*3+1] += b[j] * d[1];
+            out[j*3+2] += b[j] * d[2];
+        }
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        const double* bv = this->BasisV + this->Kj*this->DimY;
+        for(vtkIdType i=begin; i<end; i++)
+        {
+            const vtkIdType offset = i*this->DimY*3;
+            const double b = this->BasisU[i*this->M + this->Ki];
+            double d[3] = { b*this->Delta[0], b*this->Delta[1], b*this->Delta[2] };
+            if(b != 0)
+                AddScaledRow(bv, d, this->DimY, this->SurfacePoints + offset);
+
+            if(this->DerivativesU)
+            {
+                const double db = this->DBasisU[i*this->M + this->Ki];
+                double dd[3] = { db*this->Delta[0], db*this->Delta[1], db*this->Delta[2] };
+                if(db != 0)
+                    AddScaledRow(bv, dd, this->DimY, this->DerivativesU + offset);
+                if(b != 0)
+                    AddScaledRow(this->DBasisV + this->Kj*this->DimY, d, this->DimY, this->DerivativesV + offset);
+            }
+        }
+    }
+};
+
+// Computes unit normals (Su x Sv) and/or unit u-tangents (Su) for point
+// range [begin, end) from the cached partial derivatives.
+class ComputeNormalsAndTangents
+{
+public:
+    const double* DerivativesU;
+    const double* DerivativesV;
+    float* Normals;
+    float* Tangents;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        for(vtkIdType p=begin; p<end; p++)
+        {
+            const double* su = this->DerivativesU + p*3;
+            const double* sv = this->DerivativesV + p*3;
+
+            if(this->Normals)
+            {
+                double n[3] = {
+                    su[1]*sv[2] - su[2]*sv[1],
+                    su[2]*sv[0] - su[0]*sv[2],
+                    su[0]*sv[1] - su[1]*sv[0] };
+                double len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+                double inv = (len > 0) ? 1.0/len : 0.0;
+                float* out = this->Normals + p*3;
+                out[0] = float(n[0]*inv);
+                out[1] = float(n[1]*inv);
+                out[2] = float(n[2]*inv);
+            }
+
+            if(this->Tangents)
+            {
+                double len = sqrt(su[0]*su[0] + su[1]*su[1] + su[2]*su[2]);
+                double inv = (len > 0) ? 1.0/len : 0.0;
+                float* out = this->Tangents + p*3;
+                out[0] = float(su[0]*inv);
+                out[1] = float(su[1]*inv);
+                out[2] = float(su[2]*inv);
+            }
+        }
+    }
+};
+
+// Fills texture coordinates for rows [begin, end) of the u-parameter.
+// Point (i, j) is stored at index i*GridY + j and gets (s, t) = (v, u).
+class GenerateTCoordRows
+{
+public:
+    double* TCoords;
+    int GridX, GridY;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        for(vtkIdType i=begin; i<end; i++)
+        {
+            double* tc = this->TCoords + i*this->GridY*2;
+            double t = double(i)/double(this->GridX);
+            for(int j=0; j<this->GridY; j++)
+            {
+                tc[j*2] = double(j)/double(this->GridY);
+                tc[j*2+1] = t;
+            }
+        }
+    }
+};
+
+// Writes the two triangles of every quad in rows [begin, end) straight into
+// a presized legacy cell array (npts, id0, id1, id2 per cell).
+class GenerateTriangleRows
+{
+public:
+    vtkIdType* Cells;
+    int GridX, GridY;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        for(vtkIdType i=begin; i<end; i++)
+        {
+            vtkIdType* cell = this->Cells + i*(this->GridY-1)*8;
+            for(int j=0; j<this->GridY-1; j++)
+            {
+                vtkIdType base = i*this->GridY + j;
+                vtkIdType a = base;
+                vtkIdType b = base+1;
+                vtkIdType c = base+this->GridY+1;
+                vtkIdType d = base+this->GridY;
+
+                cell[0] = 3; cell[1] = c; cell[2] = b; cell[3] = a;
+                cell[4] = 3; cell[5] = d; cell[6] = c; cell[7] = a;
+                cell += 8;
+            }
+        }
+    }
+};
+}
 
 void vtkBezierSurfaceSource::UpdateBezierSurfacePolyData(vtkPolyData* pd)
 {
     if(!pd)
         return;
 
+    if(this->TessellationMode == ADAPTIVE_TESSELLATION)
+    {
+        // The uniform cache is not maintained meanwhile, so it has to be
+        // evaluated from scratch when switching back.
+        this->UpdateAdaptiveSurfacePolyData(pd);
+        this->SurfaceValid = 0;
+        return;
+    }
+
+    int grid_x = Dimensions[0];
+    int grid_y = Dimensions[1];
+    vtkIdType nrPoints = vtkIdType(grid_x)*grid_y;
+
+    // The grid (texture coordinates and connectivity) only depends on the
+    // dimensions, so it is built once and reused across control point edits.
+    if(!this->SurfacePoints ||
+       this->SurfaceGridSize[0] != grid_x || this->SurfaceGridSize[1] != grid_y)
+    {
+        this->BuildSurfaceGrid();
+        this->SurfaceValid = 0;
+    }
+
+    // Partial derivatives are only tracked while normals or tangents are
+    // requested; switching them on needs one full evaluation.
+    int needDerivatives = this->GenerateNormals || this->GenerateTangents;
+    if(needDerivatives && !this->DerivativesValid)
+        this->SurfaceValid = 0;
+    if(needDerivatives)
+    {
+        this->DerivativesU.resize(nrPoints*3);
+        this->DerivativesV.resize(nrPoints*3);
+    }
+    else
+    {
+        this->DerivativesU.clear();
+        this->DerivativesV.clear();
+    }
+
+    this->UpdateBasisTables();
+    double* pts = vtkDoubleArray::SafeDownCast(this->SurfacePoints->GetData())->GetPointer(0);
+
+    // The surface is linear in its control points, so when only a few of
+    // them moved the cached points are patched with rank-1 updates instead
+    // of being evaluated again.
+    if(!this->SurfaceValid || !this->IncrementalUpdate ||
+       this->IncrementalUpdateCount >= MaxIncrementalUpdates)
+    {
+        this->EvaluateSurfacePoints(pts);
+        this->IncrementalUpdateCount = 0;
+    }
+    else if(!this->DirtyControlPoints.empty())
+    {
+        this->ApplyControlPointDeltas(pts);
+        ++this->IncrementalUpdateCount;
+    }
+
+    int nrControlPts = this->NumberOfControlPoints[0]*this->NumberOfControlPoints[1];
+    this->EvaluatedControlPoints.assign(this->ControlPoints, this->ControlPoints + nrControlPts*3);
+    this->DirtyControlPoints.clear();
+    this->SurfaceValid = 1;
+    this->DerivativesValid = needDerivatives;
+    this->SurfacePoints->Modified();
+
+    // The connectivity is only built when asked for; without it the
+    // polydata carries just the points and the structured grid output
+    // supplies the (implicit) topology.
+    if(this->GenerateSurfaceCells && !this->SurfaceCells)
+        this->BuildSurfaceCells();
+    else if(!this->GenerateSurfaceCells && this->SurfaceCells)
+    {
+        this->SurfaceCells->Delete();
+        this->SurfaceCells = 0;
+    }
+
+    // Set the cached arrays into the output polydata.
+    pd->SetPoints(this->SurfacePoints);
+    pd->GetPointData()->SetTCoords(this->SurfaceTCoords);
+    pd->SetPolys(0);
+    pd->SetStrips(this->SurfaceCells);
+
+    // Normals and tangents come straight from the tensor-product
+    // derivatives, so no vtkPolyDataNormals is needed downstream.
+    vtkFloatArray* normals = 0;
+    vtkFloatArray* tangents = 0;
+    if(this->GenerateNormals)
+    {
+        normals = vtkFloatArray::New();
+        normals->SetName("Normals");
+        normals->SetNumberOfComponents(3);
+        normals->SetNumberOfTuples(nrPoints);
+    }
+    if(this->GenerateTangents)
+    {
+        tangents = vtkFloatArray::New();
+        tangents->SetName("Tangents");
+        tangents->SetNumberOfComponents(3);
+        tangents->SetNumberOfTuples(nrPoints);
+    }
+
+    if(needDerivatives && nrPoints > 0)
+    {
+        ComputeNormalsAndTangents frames;
+        frames.DerivativesU = &this->DerivativesU[0];
+        frames.DerivativesV = &this->DerivativesV[0];
+        frames.Normals = normals ? normals->GetPointer(0) : 0;
+        frames.Tangents = tangents ? tangents->GetPointer(0) : 0;
+        vtkSMPTools::For(0, nrPoints, frames);
+    }
+
+    pd->GetPointData()->SetNormals(normals);
+    if(normals)
+        normals->Delete();
+
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+    pd->GetPointData()->SetTangents(tangents);
+#else
+    pd->GetPointData()->RemoveArray("Tangents");
+    if(tangents)
+        pd->GetPointData()->AddArray(tangents);
+#endif
+    if(tangents)
+        tangents->Delete();
+}
+
+void vtkBezierSurfaceSource::BuildSurfaceGrid()
+{
     // First construct a grid.
     // Construct the basic grid
     int grid_x = Dimensions[0];
     int grid_y = Dimensions[1];
 
-    vtkPoints* points = vtkPoints::New();
-    vtkDoubleArray* tcoords = vtkDoubleArray::New();
-    points->SetNumberOfPoints(grid_x*grid_y);
-    tcoords->SetNumberOfComponents(2);
-    tcoords->SetNumberOfTuples(grid_x*grid_y);
-    for(int i=0; i<grid_x; i++)
+    if(this->SurfacePoints)
+        this->SurfacePoints->Delete();
+    if(this->SurfaceTCoords)
+        this->SurfaceTCoords->Delete();
+    if(this->SurfaceCells)
+        this->SurfaceCells->Delete();
+
+    this->SurfacePoints = vtkPoints::New(VTK_DOUBLE);
+    this->SurfaceTCoords = vtkDoubleArray::New();
+    this->SurfacePoints->SetNumberOfPoints(grid_x*grid_y);
+    this->SurfaceTCoords->SetNumberOfComponents(2);
+    this->SurfaceTCoords->SetNumberOfTuples(grid_x*grid_y);
+
+    // Points need not be computed, because the EvaluateSurfacePoints()
+    // method does it for us.
+    GenerateTCoordRows tcoordRows;
+    tcoordRows.TCoords = this->SurfaceTCoords->GetPointer(0);
+    tcoordRows.GridX = grid_x;
+    tcoordRows.GridY = grid_y;
+    vtkSMPTools::For(0, grid_x, tcoordRows);
+
+    this->SurfaceCells = 0;
+    this->SurfaceGridSize[0] = grid_x;
+    this->SurfaceGridSize[1] = grid_y;
+}
+
+void vtkBezierSurfaceSource::BuildSurfaceCells()
+{
+    int grid_x = this->SurfaceGridSize[0];
+    int grid_y = this->SurfaceGridSize[1];
+
+    this->SurfaceCells = vtkCellArray::New();
+    if(grid_x > 1 && grid_y > 1)
     {
-        for(int j=0; j<grid_y; j++)
-        {
-            // Points need not be computed, because the EvalBezierSurface()
-            // method does it for us.
+        vtkIdType nrCells = vtkIdType(grid_x-1)*(grid_y-1)*2;
+        GenerateTriangleRows triangleRows;
+        triangleRows.Cells = this->SurfaceCells->WritePointer(nrCells, nrCells*4);
+        triangleRows.GridX = grid_x;
+        triangleRows.GridY = grid_y;
+        vtkSMPTools::For(0, grid_x-1, triangleRows);
+    }
+}
+
+// Hands the cached uniform surface to the structured grid output. The grid
+// is x = v fastest, matching the i*Dimensions[1] + j point layout, so the
+// points and point data arrays are shared rather than copied.
+void vtkBezierSurfaceSource::UpdateStructuredGrid(vtkStructuredGrid* sg, vtkPolyData* pd)
+{
+    if(!sg)
+        return;
+
+    sg->Initialize();
+    if(this->TessellationMode == ADAPTIVE_TESSELLATION || !this->SurfacePoints)
+        return;
+
+    sg->SetDimensions(this->SurfaceGridSize[1], this->SurfaceGridSize[0], 1);
+    sg->SetPoints(this->SurfacePoints);
+    sg->GetPointData()->PassData(pd->GetPointData());
+}
+
+void vtkBezierSurfaceSource::UpdateBasisTables()
+{
+    int m = this->NumberOfControlPoints[0];
+    int n = this->NumberOfControlPoints[1];
+    int dimx = this->Dimensions[0];
+    int dimy = this->Dimensions[1];
 
-            double s = double(i)/double(grid_x);
-            double t = double(j)/double(grid_y);
-            tcoords->SetTuple2(j*grid_x+i, s, t);
+    // The tables only depend on the grid and the control net sizes, so
+    // they are reused across control point edits.
+    if( this->BasisTableSize[0] == m && this->BasisTableSize[1] == n &&
+        this->BasisTableSize[2] == dimx && this->BasisTableSize[3] == dimy )
+        return;
+
+    // BasisU holds one row of m weights per sample along u.
+    this->BasisU.resize(dimx*m);
+    this->DBasisU.resize(dimx*m);
+    for(int i=0; i<dimx; i++)
+    {
+        double mu = (dimx > 1) ? i / (double)(dimx-1) : 0.0;
+        ComputeBernsteinBasis(m-1, mu, &this->BasisU[i*m]);
+        ComputeBernsteinDerivatives(m-1, mu, &this->DBasisU[i*m]);
+    }
+
+    // BasisV is stored transposed (one row of dimy samples per control
+    // point) so that the second product runs over unit-stride memory.
+    std::vector<double> basis(n);
+    std::vector<double> derivs(n);
+    this->BasisV.resize(n*dimy);
+    this->DBasisV.resize(n*dimy);
+    for(int j=0; j<dimy; j++)
+    {
+        double mu = (dimy > 1) ? j / (double)(dimy-1) : 0.0;
+        ComputeBernsteinBasis(n-1, mu, &basis[0]);
+        ComputeBernsteinDerivatives(n-1, mu, &derivs[0]);
+        for(int kj=0; kj<n; kj++)
+        {
+            this->BasisV[kj*dimy + j] = basis[kj];
+            this->DBasisV[kj*dimy + j] = derivs[kj];
         }
     }
 
-    // Now evaluate the bezier curve on the grid.
+    this->BasisTableSize[0] = m;
+    this->BasisTableSize[1] = n;
+    this->BasisTableSize[2] = dimx;
+    this->BasisTableSize[3] = dimy;
+}
+
+// Evaluates the surface as S = Bu * P * Bv^T, where P is the m x n grid of
+// control points. surfacePoints must hold Dimensions[0]*Dimensions[1] xyz
+// triplets; point (i, j) is stored at index i*Dimensions[1] + j. The
+// partial derivatives are evaluated alongside when they are tracked.
+void vtkBezierSurfaceSource::EvaluateSurfacePoints(double* surfacePoints)
+{
     int m = this->NumberOfControlPoints[0];
     int n = this->NumberOfControlPoints[1];
     int dimx = this->Dimensions[0];
     int dimy = this->Dimensions[1];
-    EvalBezierSurface(this->ControlPoints, m, n, dimx, dimy, points);
+    if(dimx < 1 || dimy < 1)
+        return;
 
-    // Set the points into the output polydata.
-    pd->SetPoints(points);
-    points->Delete();
-    pd->GetPointData()->SetTCoords(tcoords);
-    tcoords->Delete();
+    int needDerivatives = !this->DerivativesU.empty();
+    this->PartialSums.resize(dimx*n*6);
+
+    EvaluateSurfaceRows rows;
+    rows.ControlPoints = this->ControlPoints;
+    rows.BasisU = &this->BasisU[0];
+    rows.BasisV = &this->BasisV[0];
+    rows.DBasisU = &this->DBasisU[0];
+    rows.DBasisV = &this->DBasisV[0];
+    rows.PartialSums = &this->PartialSums[0];
+    rows.SurfacePoints = surfacePoints;
+    rows.DerivativesU = needDerivatives ? &this->DerivativesU[0] : 0;
+    rows.DerivativesV = needDerivatives ? &this->DerivativesV[0] : 0;
+    rows.M = m;
+    rows.N = n;
+    rows.DimY = dimy;
+    vtkSMPTools::For(0, dimx, rows);
+}
 
-    vtkCellArray* cells = vtkCellArray::New();
-    for(int i=0; i<grid_x-1; i++)
+// Adds delta * Bu(:, ki) * Bv(kj, :) to the cached surface for every control
+// point that moved since the last evaluation. Each moved control point costs
+// one multiply-add per surface sample.
+void vtkBezierSurfaceSource::ApplyControlPointDeltas(double* surfacePoints)
+{
+    int n = this->NumberOfControlPoints[1];
+    int needDerivatives = !this->DerivativesU.empty();
+
+    ApplyControlPointDelta update;
+    update.BasisU = &this->BasisU[0];
+    update.BasisV = &this->BasisV[0];
+    update.DBasisU = &this->DBasisU[0];
+    update.DBasisV = &this->DBasisV[0];
+    update.SurfacePoints = surfacePoints;
+    update.DerivativesU = needDerivatives ? &this->DerivativesU[0] : 0;
+    update.DerivativesV = needDerivatives ? &this->DerivativesV[0] : 0;
+    update.M = this->NumberOfControlPoints[0];
+    update.DimY = this->Dimensions[1];
+
+    for(unsigned int k=0; k<this->DirtyControlPoints.size(); k++)
     {
-        for(int j=0; j<grid_y-1; j++)
+        int index = this->DirtyControlPoints[k];
+        const double* cpt = this->ControlPoints + index*3;
+        const double* old = &this->EvaluatedControlPoints[index*3];
+
+        update.Delta[0] = cpt[0] - old[0];
+        update.Delta[1] = cpt[1] - old[1];
+        update.Delta[2] = cpt[2] - old[2];
+        if(update.Delta[0] == 0 && update.Delta[1] == 0 && update.Delta[2] == 0)
+            continue;
+
+        update.Ki = index / n;
+        update.Kj = index % n;
+        vtkSMPTools::For(0, this->Dimensions[0], update);
+    }
+}
+
+// Evaluates the surface at (u, v) in [0,1]x[0,1]. du and dv receive the
+// partial derivatives when they are non-null. Does not modify the source,
+// so it may be called from several threads at once.
+void vtkBezierSurfaceSource::EvaluatePoint(double u, double v, double pt[3], double du[3], double dv[3])
+{
+    int m = this->NumberOfControlPoints[0];
+    int n = this->NumberOfControlPoints[1];
+
+    double stackBuffer[128];
+    std::vector<double> heapBuffer;
+    double* bu = stackBuffer;
+    if(2*(m+n) > 128)
+    {
+        heapBuffer.resize(2*(m+n));
+        bu = &heapBuffer[0];
+    }
+    double* dbu = bu + m;
+    double* bv = dbu + m;
+    double* dbv = bv + n;
+
+    ComputeBernsteinBasis(m-1, u, bu);
+    ComputeBernsteinBasis(n-1, v, bv);
+    ComputeBernsteinDerivatives(m-1, u, dbu);
+    ComputeBernsteinDerivatives(n-1, v, dbv);
+
+    pt[0] = pt[1] = pt[2] = 0;
+    if(du)
+        du[0] = du[1] = du[2] = 0;
+    if(dv)
+        dv[0] = dv[1] = dv[2] = 0;
+
+    for(int ki=0; ki<m; ki++)
+    {
+        // r = sum_kj Bv(kj) * P(ki, kj) and rv = sum_kj Bv'(kj) * P(ki, kj)
+        double r[3] = {0, 0, 0};
+        double rv[3] = {0, 0, 0};
+        const double* p = this->ControlPoints + ki*n*3;
+        for(int kj=0; kj<n; kj++)
         {
-            int base = j*grid_x + i;
-            int a = base;
-            int b = base+1;
-            int c = base+grid_x+1;
-            int d = base+grid_x;
+            for(int c=0; c<3; c++)
+            {
+                r[c] += bv[kj] * p[kj*3+c];
+                rv[c] += dbv[kj] * p[kj*3+c];
+            }
+        }
 
-            vtkIdType tgl[3];
-            tgl[2] = a; tgl[1] = b; tgl[0] = c;
-            cells->InsertNextCell(3, tgl);
-            tgl[2] = a; tgl[1] = c; tgl[0] = d;
-            cells->InsertNextCell(3, tgl);
+        for(int c=0; c<3; c++)
+        {
+            pt[c] += bu[ki] * r[c];
+            if(du)
+                du[c] += dbu[ki] * r[c];
+            if(dv)
+                dv[c] += bu[ki] * rv[c];
         }
     }
-    pd->SetStrips(cells);
-    cells->Delete();
 }
 
-// This function computes the blending function as used in the Bezier
-// surface code above. It is written for clarity, not efficiency.
-// Normally, if the number of control points is constant, the blending
-// function would be calculated once for each desired value of mu.
-double BezierBlend(int k, double mu, int n)
+namespace
+{
+// Number of times the control net may be split in each direction when
+// building the query hierarchy.
+const int MaxQueryTreeDepth = 6;
+
+// B''(k,p) = p * (B'(k-1,p-1) - B'(k,p-1)), computed in place like the
+// first derivatives.
+void ComputeBernsteinSecondDerivatives(int degree, double mu, double* derivs)
+{
+    if(degree < 2)
+    {
+        for(int k=0; k<=degree; k++)
+            derivs[k] = 0;
+        return;
+    }
+
+    double* lower = derivs + 1;
+    vtkBezierSurfaceSource::ComputeBernsteinDerivatives(degree-1, mu, lower);
+
+    derivs[0] = -degree * lower[0];
+    for(int k=1; k<degree; k++)
+        derivs[k] = degree * (lower[k-1] - lower[k]);
+    derivs[degree] = degree * lower[degree-1];
+}
+
+// Splits an m x n control net at the parameter midpoint along u (alongU)
+// or v with de Casteljau's algorithm.
+void SplitControlNet(const std::vector<double>& net, int m, int n, int alongU,
+                     std::vector<double>& lo, std::vector<double>& hi)
+{
+    int count = alongU ? m : n;
+    int lines = alongU ? n : m;
+    std::vector<double> work(count*3);
+    lo.resize(net.size());
+    hi.resize(net.size());
+
+    for(int line=0; line<lines; line++)
+    {
+        for(int k=0; k<count; k++)
+        {
+            int idx = alongU ? (k*n + line) : (line*n + k);
+            for(int c=0; c<3; c++)
+                work[k*3+c] = net[idx*3+c];
+        }
+
+        for(int r=0; r<count; r++)
+        {
+            if(r > 0)
+            {
+                for(int k=0; k<count-r; k++)
+                    for(int c=0; c<3; c++)
+                        work[k*3+c] = 0.5 * (work[k*3+c] + work[(k+1)*3+c]);
+            }
+
+            int loIdx = alongU ? (r*n + line) : (line*n + r);
+            int hiK = count-1-r;
+            int hiIdx = alongU ? (hiK*n + line) : (line*n + hiK);
+            for(int c=0; c<3; c++)
+            {
+                lo[loIdx*3+c] = work[c];
+                hi[hiIdx*3+c] = work[hiK*3+c];
+            }
+        }
+    }
+}
+
+// Maximum distance of the control points from the bilinear patch through
+// the four corner control points.
+double ControlNetDeviation(const std::vector<double>& net, int m, int n)
+{
+    const double* p00 = &net[0];
+    const double* p01 = &net[(n-1)*3];
+    const double* p10 = &net[(m-1)*n*3];
+    const double* p11 = &net[((m-1)*n + n-1)*3];
+
+    double deviation = 0;
+    for(int i=0; i<m; i++)
+    {
+        double a = double(i)/double(m-1);
+        for(int j=0; j<n; j++)
+        {
+            double b = double(j)/double(n-1);
+            double d2 = 0;
+            for(int c=0; c<3; c++)
+            {
+                double q = (1-a)*((1-b)*p00[c] + b*p01[c]) + a*((1-b)*p10[c] + b*p11[c]);
+                double d = net[(i*n+j)*3+c] - q;
+                d2 += d*d;
+            }
+            deviation = std::max(deviation, d2);
+        }
+    }
+    return sqrt(deviation);
+}
+
+// Clips the segment p + t*d, t in [tmin, tmax], against an axis aligned
+// box. Returns false when the segment misses the box.
+bool ClipSegmentToBox(const double bounds[6], const double p[3], const double d[3],
+                      double& tmin, double& tmax)
 {
-    int nn, kn, nkn;
-    double blend=1;
+    for(int c=0; c<3; c++)
+    {
+        if(d[c] == 0)
+        {
+            if(p[c] < bounds[2*c] || p[c] > bounds[2*c+1])
+                return false;
+            continue;
+        }
+
+        double t0 = (bounds[2*c] - p[c]) / d[c];
+        double t1 = (bounds[2*c+1] - p[c]) / d[c];
+        if(t0 > t1)
+            std::swap(t0, t1);
+        tmin = std::max(tmin, t0);
+        tmax = std::min(tmax, t1);
+        if(tmin > tmax)
+            return false;
+    }
+    return true;
+}
+
+double BoxDistance2(const double bounds[6], const double x[3])
+{
+    double d2 = 0;
+    for(int c=0; c<3; c++)
+    {
+        double d = 0;
+        if(x[c] < bounds[2*c])
+            d = bounds[2*c] - x[c];
+        else if(x[c] > bounds[2*c+1])
+            d = x[c] - bounds[2*c+1];
+        d2 += d*d;
+    }
+    return d2;
+}
+
+inline double Determinant3(const double a[3], const double b[3], const double c[3])
+{
+    return a[0]*(b[1]*c[2] - b[2]*c[1]) -
+           a[1]*(b[0]*c[2] - b[2]*c[0]) +
+           a[2]*(b[0]*c[1] - b[1]*c[0]);
+}
+}
 
-    nn = n;
-    kn = k;
-    nkn = n - k;
+// Evaluates the surface and its first and second partial derivatives at
+// (u, v).
+void vtkBezierSurfaceSource::EvaluateDerivatives(double u, double v, double s[3], double su[3], double sv[3],
+                                                 double suu[3], double suv[3], double svv[3])
+{
+    int m = this->NumberOfControlPoints[0];
+    int n = this->NumberOfControlPoints[1];
 
-    while (nn >= 1)
+    double stackBuffer[192];
+    std::vector<double> heapBuffer;
+    double* bu = stackBuffer;
+    if(3*(m+n) > 192)
     {
-        blend *= nn;
-        nn--;
-        if (kn > 1)
+        heapBuffer.resize(3*(m+n));
+        bu = &heapBuffer[0];
+    }
+    double* dbu = bu + m;
+    double* ddbu = dbu + m;
+    double* bv = ddbu + m;
+    double* dbv = bv + n;
+    double* ddbv = dbv + n;
+
+    ComputeBernsteinBasis(m-1, u, bu);
+    ComputeBernsteinDerivatives(m-1, u, dbu);
+    ComputeBernsteinSecondDerivatives(m-1, u, ddbu);
+    ComputeBernsteinBasis(n-1, v, bv);
+    ComputeBernsteinDerivatives(n-1, v, dbv);
+    ComputeBernsteinSecondDerivatives(n-1, v, ddbv);
+
+    for(int c=0; c<3; c++)
+        s[c] = su[c] = sv[c] = suu[c] = suv[c] = svv[c] = 0;
+
+    for(int ki=0; ki<m; ki++)
+    {
+        double r[3] = {0, 0, 0};
+        double rv[3] = {0, 0, 0};
+        double rvv[3] = {0, 0, 0};
+        const double* p = this->ControlPoints + ki*n*3;
+        for(int kj=0; kj<n; kj++)
         {
-            blend /= (double)kn;
-            kn--;
+            for(int c=0; c<3; c++)
+            {
+                r[c] += bv[kj] * p[kj*3+c];
+                rv[c] += dbv[kj] * p[kj*3+c];
+                rvv[c] += ddbv[kj] * p[kj*3+c];
+            }
         }
-        if (nkn > 1)
+
+        for(int c=0; c<3; c++)
         {
-            blend /= (double)nkn;
-            nkn--;
+            s[c] += bu[ki] * r[c];
+            su[c] += dbu[ki] * r[c];
+            sv[c] += bu[ki] * rv[c];
+            suu[c] += ddbu[ki] * r[c];
+            suv[c] += dbu[ki] * rv[c];
+            svv[c] += bu[ki] * rvv[c];
         }
     }
+}
 
-    if (k > 0)
-        blend *= pow(mu,(double)k);
+// Builds the query hierarchy by recursively splitting the control net into
+// four sub-nets until each is close to bilinear or the maximum depth is
+// reached.
+void vtkBezierSurfaceSource::BuildQueryTree()
+{
+    int m = this->NumberOfControlPoints[0];
+    int n = this->NumberOfControlPoints[1];
+    std::vector<double> net(this->ControlPoints, this->ControlPoints + m*n*3);
 
-    if (n-k > 0)
-        blend *= pow(1-mu,(double)(n-k));
+    this->QueryTree.clear();
+    this->QueryTree.resize(1);
+    QueryNode& root = this->QueryTree[0];
+    root.Range[0] = 0; root.Range[1] = 1;
+    root.Range[2] = 0; root.Range[3] = 1;
 
-    return blend;
+    double bounds[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX,
+                         -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+    for(int k=0; k<m*n; k++)
+    {
+        for(int c=0; c<3; c++)
+        {
+            bounds[2*c] = std::min(bounds[2*c], net[k*3+c]);
+            bounds[2*c+1] = std::max(bounds[2*c+1], net[k*3+c]);
+        }
+    }
+    this->QueryTreeDiagonal = sqrt((bounds[1]-bounds[0])*(bounds[1]-bounds[0]) +
+                                   (bounds[3]-bounds[2])*(bounds[3]-bounds[2]) +
+                                   (bounds[5]-bounds[4])*(bounds[5]-bounds[4]));
+
+    this->BuildQueryNode(0, net, 0, 1.0e-3 * this->QueryTreeDiagonal);
+    this->QueryTreeValid = 1;
 }
 
-// Evaluates a bezier surface.
-void EvalBezierSurface(const double* controlPoints, int m, int n, int dimx, int dimy, vtkPoints* surfacePoints)
+void vtkBezierSurfaceSource::BuildQueryNode(int node, const std::vector<double>& net, int depth, double flatness)
 {
-    int i, j, ki, kj;
-    double mui, muj, bi, bj;
+    int m = this->NumberOfControlPoints[0];
+    int n = this->NumberOfControlPoints[1];
 
-    int ptIndex = 0;
-    int ctrlPtIndex = 0;
-    double pt[3];
+    // The boxes are padded slightly so that planar nets still have volume.
+    double* bounds = this->QueryTree[node].Bounds;
+    double pad = 1.0e-9 * (this->QueryTreeDiagonal > 0 ? this->QueryTreeDiagonal : 1.0);
+    for(int c=0; c<3; c++)
+    {
+        bounds[2*c] = VTK_DOUBLE_MAX;
+        bounds[2*c+1] = -VTK_DOUBLE_MAX;
+    }
+    for(int k=0; k<m*n; k++)
+    {
+        for(int c=0; c<3; c++)
+        {
+            bounds[2*c] = std::min(bounds[2*c], net[k*3+c] - pad);
+            bounds[2*c+1] = std::max(bounds[2*c+1], net[k*3+c] + pad);
+        }
+    }
 
-    for(i=0; i<dimx; i++)
+    if(depth >= MaxQueryTreeDepth || ControlNetDeviation(net, m, n) <= flatness)
     {
-        mui = i / (double)(dimx-1);
-        for(j=0; j<dimy; j++)
+        this->QueryTree[node].FirstChild = -1;
+        return;
+    }
+
+    double range[4];
+    std::copy(this->QueryTree[node].Range, this->QueryTree[node].Range + 4, range);
+    double um = 0.5 * (range[0] + range[1]);
+    double vm = 0.5 * (range[2] + range[3]);
+
+    // Children are (u lo, v lo), (u lo, v hi), (u hi, v lo), (u hi, v hi).
+    int first = int(this->QueryTree.size());
+    this->QueryTree[node].FirstChild = first;
+    this->QueryTree.resize(first + 4);
+    for(int k=0; k<4; k++)
+    {
+        double* r = this->QueryTree[first+k].Range;
+        r[0] = (k < 2) ? range[0] : um;
+        r[1] = (k < 2) ? um : range[1];
+        r[2] = (k % 2 == 0) ? range[2] : vm;
+        r[3] = (k % 2 == 0) ? vm : range[3];
+    }
+
+    std::vector<double> uLo, uHi, sub[4];
+    SplitControlNet(net, m, n, 1, uLo, uHi);
+    SplitControlNet(uLo, m, n, 0, sub[0], sub[1]);
+    SplitControlNet(uHi, m, n, 0, sub[2], sub[3]);
+    for(int k=0; k<4; k++)
+        this->BuildQueryNode(first+k, sub[k], depth+1, flatness);
+}
+
+// Walks the hierarchy front to back along the segment. In every leaf whose
+// box the segment crosses, Newton's method solves S(u, v) = p1 + t*(p2-p1)
+// starting from the centre of the leaf.
+int vtkBezierSurfaceSource::IntersectWithLine(const double p1[3], const double p2[3], double tol,
+                                              double& t, double x[3], double uv[2])
+{
+    if(!this->QueryTreeValid)
+        this->BuildQueryTree();
+
+    if(tol <= 0)
+        tol = 1.0e-10 * (this->QueryTreeDiagonal > 0 ? this->QueryTreeDiagonal : 1.0);
+
+    double d[3] = { p2[0]-p1[0], p2[1]-p1[1], p2[2]-p1[2] };
+    double dd = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    if(dd == 0)
+        return 0;
+
+    int hit = 0;
+    double bestT = 1.0;
+    std::vector<int> stack(1, 0);
+    while(!stack.empty())
+    {
+        const QueryNode& node = this->QueryTree[stack.back()];
+        stack.pop_back();
+
+        double tmin = 0, tmax = bestT;
+        if(!ClipSegmentToBox(node.Bounds, p1, d, tmin, tmax))
+            continue;
+
+        if(node.FirstChild >= 0)
         {
-            muj = j / (double)(dimy-1);
+            for(int k=0; k<4; k++)
+                stack.push_back(node.FirstChild + k);
+            continue;
+        }
 
-            // Get the surface point and initialize it.
-            surfacePoints->GetPoint(ptIndex, pt);
-            pt[0] = pt[1] = pt[2] = 0;
+        double u = 0.5 * (node.Range[0] + node.Range[1]);
+        double v = 0.5 * (node.Range[2] + node.Range[3]);
+        double s[3], su[3], sv[3];
+        this->EvaluatePoint(u, v, s, 0, 0);
+        double tt = ((s[0]-p1[0])*d[0] + (s[1]-p1[1])*d[1] + (s[2]-p1[2])*d[2]) / dd;
 
-            // Loop through all control points and compute its effect on the
-            // surface point
-            ctrlPtIndex = 0;
-            for (ki=0; ki<m; ki++)
+        int converged = 0;
+        for(int iter=0; iter<20; iter++)
+        {
+            this->EvaluatePoint(u, v, s, su, sv);
+            double f[3];
+            for(int c=0; c<3; c++)
+                f[c] = s[c] - p1[c] - tt*d[c];
+            if(f[0]*f[0] + f[1]*f[1] + f[2]*f[2] <= tol*tol)
             {
-                bi = BezierBlend(ki,mui,m-1);
+                converged = 1;
+                break;
+            }
+
+            // [Su Sv -d] * (du, dv, dt) = -f, solved with Cramer's rule.
+            double nd[3] = { -d[0], -d[1], -d[2] };
+            double nf[3] = { -f[0], -f[1], -f[2] };
+            double det = Determinant3(su, sv, nd);
+            if(fabs(det) < 1.0e-300)
+                break;
+            u += Determinant3(nf, sv, nd) / det;
+            v += Determinant3(su, nf, nd) / det;
+            tt += Determinant3(su, sv, nf) / det;
+            if(u < -0.5 || u > 1.5 || v < -0.5 || v > 1.5)
+                break;
+        }
 
-                for (kj=0; kj<n; kj++)
+        const double eps = 1.0e-9;
+        if(!converged || u < -eps || u > 1+eps || v < -eps || v > 1+eps || tt < 0 || tt > bestT)
+            continue;
+
+        hit = 1;
+        bestT = tt;
+        t = tt;
+        uv[0] = std::min(1.0, std::max(0.0, u));
+        uv[1] = std::min(1.0, std::max(0.0, v));
+        x[0] = s[0]; x[1] = s[1]; x[2] = s[2];
+    }
+
+    return hit;
+}
+
+// Visits the leaves of the hierarchy nearest box first and skips every box
+// farther away than the best point so far. In each remaining leaf Newton's
+// method minimises |S(u, v) - x|^2 over the (u, v) range of the leaf,
+// starting from its centre.
+void vtkBezierSurfaceSource::FindClosestPoint(const double x[3], double closest[3], double uv[2], double& dist2)
+{
+    if(!this->QueryTreeValid)
+        this->BuildQueryTree();
+
+    dist2 = VTK_DOUBLE_MAX;
+    std::vector<std::pair<double, int> > queue;
+    queue.push_back(std::make_pair(BoxDistance2(this->QueryTree[0].Bounds, x), 0));
+    while(!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<std::pair<double, int> >());
+        std::pair<double, int> entry = queue.back();
+        queue.pop_back();
+        if(entry.first >= dist2)
+            break;
+
+        const QueryNode& node = this->QueryTree[entry.second];
+        if(node.FirstChild >= 0)
+        {
+            for(int k=0; k<4; k++)
+            {
+                int child = node.FirstChild + k;
+                double d2 = BoxDistance2(this->QueryTree[child].Bounds, x);
+                if(d2 < dist2)
+                {
+                    queue.push_back(std::make_pair(d2, child));
+                    std::push_heap(queue.begin(), queue.end(), std::greater<std::pair<double, int> >());
+                }
+            }
+            continue;
+        }
+
+        double u = 0.5 * (node.Range[0] + node.Range[1]);
+        double v = 0.5 * (node.Range[2] + node.Range[3]);
+        double s[3], su[3], sv[3], suu[3], suv[3], svv[3];
+        for(int iter=0; iter<30; iter++)
+        {
+            this->EvaluateDerivatives(u, v, s, su, sv, suu, suv, svv);
+            double r[3] = { s[0]-x[0], s[1]-x[1], s[2]-x[2] };
+            double g0 = vtkMath::Dot(r, su);
+            double g1 = vtkMath::Dot(r, sv);
+            double h00 = vtkMath::Dot(su, su) + vtkMath::Dot(r, suu);
+            double h01 = vtkMath::Dot(su, sv) + vtkMath::Dot(r, suv);
+            double h11 = vtkMath::Dot(sv, sv) + vtkMath::Dot(r, svv);
+            double det = h00*h11 - h01*h01;
+
+            // A parameter sitting on the border of the leaf whose gradient
+            // points outwards stays fixed and the other one is minimised
+            // alone; the neighbouring leaf covers the other side.
+            int fixU = (u <= node.Range[0] && g0 > 0) || (u >= node.Range[1] && g0 < 0);
+            int fixV = (v <= node.Range[2] && g1 > 0) || (v >= node.Range[3] && g1 < 0);
+            if(fixU && fixV)
+                break;
+
+            // Fall back to Gauss-Newton where the Hessian is not positive
+            // definite.
+            double du, dv;
+            if(fixU)
+            {
+                du = 0;
+                dv = -g1 / (h11 > 0 ? h11 : vtkMath::Dot(sv, sv));
+            }
+            else if(fixV)
+            {
+                du = -g0 / (h00 > 0 ? h00 : vtkMath::Dot(su, su));
+                dv = 0;
+            }
+            else
+            {
+                if(h00 <= 0 || det <= 0)
                 {
-                    bj = BezierBlend(kj,muj,n-1);
+                    h00 = vtkMath::Dot(su, su);
+                    h01 = vtkMath::Dot(su, sv);
+                    h11 = vtkMath::Dot(sv, sv);
+                    det = h00*h11 - h01*h01;
+                    if(det <= 0)
+                        break;
+                }
+                du = -( h11*g0 - h01*g1) / det;
+                dv = -(-h01*g0 + h00*g1) / det;
+            }
+
+            double nu = std::min(node.Range[1], std::max(node.Range[0], u + du));
+            double nv = std::min(node.Range[3], std::max(node.Range[2], v + dv));
+            double step = fabs(nu - u) + fabs(nv - v);
+            u = nu;
+            v = nv;
+            if(step < 1.0e-12)
+                break;
+        }
+
+        this->EvaluatePoint(u, v, s, 0, 0);
+        double d2 = vtkMath::Distance2BetweenPoints(s, x);
+        if(d2 < dist2)
+        {
+            dist2 = d2;
+            closest[0] = s[0]; closest[1] = s[1]; closest[2] = s[2];
+            uv[0] = u;
+            uv[1] = v;
+        }
+    }
+}
+
+vtkMTimeType vtkBezierSurfaceSource::GetMTime()
+{
+    vtkMTimeType mTime = this->Superclass::GetMTime();
 
-                    const double* ctrlPt = controlPoints + (ctrlPtIndex*3);
-                    ++ctrlPtIndex;
+    // A screen-space tolerance depends on the view, so camera changes have
+    // to re-tessellate the surface.
+    if(this->TessellationMode == ADAPTIVE_TESSELLATION && this->ScreenSpaceError > 0 &&
+       this->Renderer && this->Renderer->IsActiveCameraCreated())
+    {
+        vtkMTimeType cameraMTime = this->Renderer->GetActiveCamera()->GetMTime();
+        if(cameraMTime > mTime)
+            mTime = cameraMTime;
+    }
+
+    return mTime;
+}
+
+void vtkBezierSurfaceSource::SetRenderer(vtkRenderer* renderer)
+{
+    if(this->Renderer == renderer)
+        return;
+
+    this->Renderer = renderer;
+    this->Modified();
+}
+
+vtkRenderer* vtkBezierSurfaceSource::GetRenderer()
+{
+    return this->Renderer;
+}
+
+namespace
+{
+// A rectangle of the adaptive quadtree, in lattice units of the finest
+// possible subdivision.
+struct AdaptiveCell
+{
+    int U0, V0, U1, V1;
+};
+
+// Converts the screen-space error bound into a world-space tolerance at a
+// given position, using the active camera of a renderer.
+class ScreenSpaceTolerance
+{
+public:
+    int Valid;
+    int Parallel;
+    double Position[3];
+    double Direction[3];
+    double PixelScale;
+
+    ScreenSpaceTolerance() : Valid(0), Parallel(0), PixelScale(0) { }
+
+    void Initialize(vtkRenderer* ren, double pixels)
+    {
+        this->Valid = 0;
+        if(!ren || pixels <= 0)
+            return;
+
+        int height = ren->GetSize()[1];
+        if(height <= 0)
+            return;
+
+        vtkCamera* cam = ren->GetActiveCamera();
+        cam->GetPosition(this->Position);
+        cam->GetDirectionOfProjection(this->Direction);
+        this->Parallel = cam->GetParallelProjection();
+        if(this->Parallel)
+            this->PixelScale = pixels * 2.0 * cam->GetParallelScale() / height;
+        else
+            this->PixelScale = pixels * 2.0 * tan(vtkMath::RadiansFromDegrees(cam->GetViewAngle()) / 2.0) / height;
+        this->Valid = 1;
+    }
+
+    double Evaluate(const double x[3], double fallback) const
+    {
+        if(!this->Valid)
+            return fallback;
+        if(this->Parallel)
+            return this->PixelScale;
+
+        double d = (x[0]-this->Position[0])*this->Direction[0] +
+                   (x[1]-this->Position[1])*this->Direction[1] +
+                   (x[2]-this->Position[2])*this->Direction[2];
+        if(d <= 0)
+            return VTK_DOUBLE_MAX; // behind the camera, keep it coarse
+        return d * this->PixelScale;
+    }
+};
+
+inline double MidpointDeviation(const double a[3], const double mid[3], const double b[3])
+{
+    double d[3] = { mid[0] - 0.5*(a[0]+b[0]), mid[1] - 0.5*(a[1]+b[1]), mid[2] - 0.5*(a[2]+b[2]) };
+    return sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+}
+
+// Evaluates points (and optionally normals/tangents) of the adaptive
+// tessellation for range [begin, end) of its (u, v) samples.
+class EvaluateAdaptivePoints
+{
+public:
+    vtkBezierSurfaceSource* Source;
+    const double* UV;
+    double* Points;
+    float* Normals;
+    float* Tangents;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+        for(vtkIdType p=begin; p<end; p++)
+        {
+            double su[3], sv[3];
+            this->Source->EvaluatePoint(this->UV[p*2], this->UV[p*2+1], this->Points + p*3, su, sv);
+
+            if(this->Normals)
+            {
+                double nrm[3];
+                vtkMath::Cross(su, sv, nrm);
+                vtkMath::Normalize(nrm);
+                for(int c=0; c<3; c++)
+                    this->Normals[p*3+c] = float(nrm[c]);
+            }
+            if(this->Tangents)
+            {
+                vtkMath::Normalize(su);
+                for(int c=0; c<3; c++)
+                    this->Tangents[p*3+c] = float(su[c]);
+            }
+        }
+    }
+};
+}
 
-                    pt[0] += (ctrlPt[0] * bi * bj);
-                    pt[1] += (ctrlPt[1] * bi * bj);
-                    pt[2] += (ctrlPt[2] * bi * bj);
+// Tessellates the surface with a quadtree over (u, v). A cell is split
+// along a direction while the surface deviates from the chord through the
+// cell by more than the tolerance, so flat areas get few large triangles
+// and curved areas more. Cells are triangulated as fans over all vertices
+// on their boundary (including those of finer neighbours), which keeps the
+// mesh free of cracks at T-junctions.
+void vtkBezierSurfaceSource::UpdateAdaptiveSurfacePolyData(vtkPolyData* pd)
+{
+    int m = this->NumberOfControlPoints[0];
+    int n = this->NumberOfControlPoints[1];
+    const int maxLevel = this->MaximumSubdivisionLevel;
+    const int L = 1 << maxLevel;
+    const double invL = 1.0 / L;
+
+    // Without a minimum depth a wavy high-degree patch could look flat at its
+    // few first samples; one cell per polynomial degree is always enough.
+    int minLevel = 0;
+    while(minLevel < maxLevel && (1 << minLevel) < std::max(m, n) - 1)
+        ++minLevel;
+
+    ScreenSpaceTolerance screenTolerance;
+    screenTolerance.Initialize(this->Renderer, this->ScreenSpaceError);
+
+    // Pass 1: refine the quadtree.
+    std::vector<AdaptiveCell> stack;
+    std::vector<AdaptiveCell> leaves;
+    AdaptiveCell root = { 0, 0, L, L };
+    stack.push_back(root);
+    while(!stack.empty())
+    {
+        AdaptiveCell cell = stack.back();
+        stack.pop_back();
+
+        int sizeU = cell.U1 - cell.U0;
+        int sizeV = cell.V1 - cell.V0;
+        int um = (cell.U0 + cell.U1) / 2;
+        int vm = (cell.V0 + cell.V1) / 2;
+
+        // 3x3 samples of the cell: s[a][b] at u = (U0, um, U1)[a], v = (V0, vm, V1)[b]
+        double s[3][3][3];
+        int us[3] = { cell.U0, um, cell.U1 };
+        int vs[3] = { cell.V0, vm, cell.V1 };
+        for(int a=0; a<3; a++)
+            for(int b=0; b<3; b++)
+                this->EvaluatePoint(us[a]*invL, vs[b]*invL, s[a][b], 0, 0);
+
+        double errorU = 0, errorV = 0;
+        for(int k=0; k<3; k++)
+        {
+            errorU = std::max(errorU, MidpointDeviation(s[0][k], s[1][k], s[2][k]));
+            errorV = std::max(errorV, MidpointDeviation(s[k][0], s[k][1], s[k][2]));
+        }
+
+        // Twist: the two triangles of a bilinear cell miss its centre by this much.
+        double twist[3];
+        for(int c=0; c<3; c++)
+            twist[c] = 0.25 * (s[0][0][c] + s[2][2][c] - s[0][2][c] - s[2][0][c]);
+        double errorTwist = sqrt(twist[0]*twist[0] + twist[1]*twist[1] + twist[2]*twist[2]);
+
+        double tolerance = screenTolerance.Evaluate(s[1][1], this->FlatnessTolerance);
+        int forceU = sizeU > (L >> minLevel);
+        int forceV = sizeV > (L >> minLevel);
+        int splitU = sizeU > 1 && (forceU || errorU > tolerance || errorTwist > tolerance);
+        int splitV = sizeV > 1 && (forceV || errorV > tolerance || errorTwist > tolerance);
+
+        if(!splitU && !splitV)
+        {
+            leaves.push_back(cell);
+            continue;
+        }
+
+        int uCuts[3] = { cell.U0, splitU ? um : cell.U1, cell.U1 };
+        int vCuts[3] = { cell.V0, splitV ? vm : cell.V1, cell.V1 };
+        for(int a=0; a<(splitU ? 2 : 1); a++)
+        {
+            for(int b=0; b<(splitV ? 2 : 1); b++)
+            {
+                AdaptiveCell child = { uCuts[a], vCuts[b], uCuts[a+1], vCuts[b+1] };
+                stack.push_back(child);
+            }
+        }
+    }
+
+    // Pass 2: number the cell corners. Vertices are indexed both by row
+    // (v, u) and by column (u, v) so edge neighbours can be found by range.
+    typedef std::map<std::pair<int, int>, vtkIdType> VertexMap;
+    VertexMap rows, columns;
+    std::vector<double> uv;
+    for(size_t k=0; k<leaves.size(); k++)
+    {
+        const AdaptiveCell& cell = leaves[k];
+        int us[2] = { cell.U0, cell.U1 };
+        int vs[2] = { cell.V0, cell.V1 };
+        for(int a=0; a<2; a++)
+        {
+            for(int b=0; b<2; b++)
+            {
+                std::pair<VertexMap::iterator, bool> ins =
+                    rows.insert(std::make_pair(std::make_pair(vs[b], us[a]), vtkIdType(uv.size()/2)));
+                if(ins.second)
+                {
+                    columns[std::make_pair(us[a], vs[b])] = ins.first->second;
+                    uv.push_back(us[a]*invL);
+                    uv.push_back(vs[b]*invL);
                 }
             }
+        }
+    }
 
-            surfacePoints->SetPoint(ptIndex, pt);
-            ++ptIndex;
+    // Pass 3: triangulate each leaf counter-clockwise in (u, v), which
+    // gives the same orientation (Su x Sv) as the uniform grid.
+    std::vector<vtkIdType> connectivity;
+    std::vector<vtkIdType> boundary;
+    vtkIdType nrCells = 0;
+    for(size_t k=0; k<leaves.size(); k++)
+    {
+        const AdaptiveCell& cell = leaves[k];
+        boundary.clear();
+
+        // bottom edge, v = V0, u increasing
+        VertexMap::iterator it = rows.find(std::make_pair(cell.V0, cell.U0));
+        VertexMap::iterator last = rows.find(std::make_pair(cell.V0, cell.U1));
+        for(; it != last; ++it)
+            boundary.push_back(it->second);
+
+        // right edge, u = U1, v increasing
+        it = columns.find(std::make_pair(cell.U1, cell.V0));
+        last = columns.find(std::make_pair(cell.U1, cell.V1));
+        for(; it != last; ++it)
+            boundary.push_back(it->second);
+
+        // top edge, v = V1, u decreasing
+        it = rows.find(std::make_pair(cell.V1, cell.U1));
+        last = rows.find(std::make_pair(cell.V1, cell.U0));
+        for(; it != last; --it)
+            boundary.push_back(it->second);
+
+        // left edge, u = U0, v decreasing
+        it = columns.find(std::make_pair(cell.U0, cell.V1));
+        last = columns.find(std::make_pair(cell.U0, cell.V0));
+        for(; it != last; --it)
+            boundary.push_back(it->second);
+
+        if(boundary.size() == 4)
+        {
+            vtkIdType tri[8] = { 3, boundary[0], boundary[1], boundary[2],
+                                 3, boundary[0], boundary[2], boundary[3] };
+            connectivity.insert(connectivity.end(), tri, tri+8);
+            nrCells += 2;
+            continue;
         }
+
+        // T-junctions on the boundary: fan around the cell centre.
+        vtkIdType center = vtkIdType(uv.size()/2);
+        uv.push_back(0.5*(cell.U0 + cell.U1)*invL);
+        uv.push_back(0.5*(cell.V0 + cell.V1)*invL);
+        for(size_t b=0; b<boundary.size(); b++)
+        {
+            connectivity.push_back(3);
+            connectivity.push_back(center);
+            connectivity.push_back(boundary[b]);
+            connectivity.push_back(boundary[(b+1) % boundary.size()]);
+            ++nrCells;
+        }
+    }
+
+    // Pass 4: evaluate all vertices in parallel.
+    vtkIdType nrPoints = vtkIdType(uv.size()/2);
+    vtkPoints* points = vtkPoints::New(VTK_DOUBLE);
+    points->SetNumberOfPoints(nrPoints);
+
+    vtkDoubleArray* tcoords = vtkDoubleArray::New();
+    tcoords->SetNumberOfComponents(2);
+    tcoords->SetNumberOfTuples(nrPoints);
+    double* tc = tcoords->GetPointer(0);
+    for(vtkIdType p=0; p<nrPoints; p++)
+    {
+        // Same orientation as the uniform grid: s runs along v, t along u.
+        tc[p*2] = uv[p*2+1];
+        tc[p*2+1] = uv[p*2];
+    }
+
+    vtkFloatArray* normals = 0;
+    vtkFloatArray* tangents = 0;
+    if(this->GenerateNormals)
+    {
+        normals = vtkFloatArray::New();
+        normals->SetName("Normals");
+        normals->SetNumberOfComponents(3);
+        normals->SetNumberOfTuples(nrPoints);
+    }
+    if(this->GenerateTangents)
+    {
+        tangents = vtkFloatArray::New();
+        tangents->SetName("Tangents");
+        tangents->SetNumberOfComponents(3);
+        tangents->SetNumberOfTuples(nrPoints);
     }
+
+    EvaluateAdaptivePoints evaluate;
+    evaluate.Source = this;
+    evaluate.UV = &uv[0];
+    evaluate.Points = vtkDoubleArray::SafeDownCast(points->GetData())->GetPointer(0);
+    evaluate.Normals = normals ? normals->GetPointer(0) : 0;
+    evaluate.Tangents = tangents ? tangents->GetPointer(0) : 0;
+    vtkSMPTools::For(0, nrPoints, evaluate);
+
+    vtkCellArray* cells = vtkCellArray::New();
+    std::copy(connectivity.begin(), connectivity.end(),
+              cells->WritePointer(nrCells, vtkIdType(connectivity.size())));
+
+    pd->SetPoints(points);
+    points->Delete();
+    pd->GetPointData()->SetTCoords(tcoords);
+    tcoords->Delete();
+    pd->SetStrips(0);
+    pd->SetPolys(cells);
+    cells->Delete();
+
+    pd->GetPointData()->SetNormals(normals);
+    if(normals)
+        normals->Delete();
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+    pd->GetPointData()->SetTangents(tangents);
+#else
+    pd->GetPointData()->RemoveArray("Tangents");
+    if(tangents)
+        pd->GetPointData()->AddArray(tangents);
+#endif
+    if(tangents)
+        tangents->Delete();
+}
+
+// Computes all degree+1 Bernstein polynomials of the given degree at mu
+// using the triangular recurrence B(k,j) = (1-mu)*B(k,j-1) + mu*B(k-1,j-1).
+// Unlike the closed form this needs no binomial coefficients or pow() calls.
+void vtkBezierSurfaceSource::ComputeBernsteinBasis(int degree, double mu, double* basis)
+{
+    double mu1 = 1.0 - mu;
+
+    basis[0] = 1.0;
+    for(int j=1; j<=degree; j++)
+    {
+        double saved = 0.0;
+        for(int k=0; k<j; k++)
+        {
+            double temp = basis[k];
+            basis[k] = saved + mu1*temp;
+            saved = mu*temp;
+        }
+        basis[j] = saved;
+    }
+}
+
+// Computes the first derivatives of all degree+1 Bernstein polynomials at
+// mu: B'(k,p) = p * (B(k-1,p-1) - B(k,p-1)).
+void vtkBezierSurfaceSource::ComputeBernsteinDerivatives(int degree, double mu, double* derivs)
+{
+    if(degree < 1)
+    {
+        derivs[0] = 0;
+        return;
+    }
+
+    // The lower degree basis fits into the tail of the output array.
+    double* lower = derivs + 1;
+    ComputeBernsteinBasis(degree-1, mu, lower);
+
+    derivs[0] = -degree * lower[0];
+    for(int k=1; k<degree; k++)
+        derivs[k] = degree * (lower[k-1] - lower[k]);
+    derivs[degree] = degree * lower[degree-1];
 }
@@ -33,8 +33,15 @@ Credits:
 #define VTK_BEZIER_SURFACE_SOURCE_H
 
 #include "vtkPolyDataAlgorithm.h"
+#include "vtkWeakPointer.h"
+#include <vector>
 
 class vtkImageData;
+class vtkRenderer;
+class vtkPoints;
+class vtkDoubleArray;
+class vtkCellArray;
+class vtkStructuredGrid;
 class vtkBezierSurfaceSource : public vtkPolyDataAlgorithm
 {
 public:
@@ -45,21 +52,109 @@ public:
     vtkPolyData* GetControlPointsOutput();
     vtkPolyData* GetBezierSurfaceOutput(); // same as GetOutput()
 
+    // The uniformly tessellated surface as a Dimensions[1] x Dimensions[0]
+    // structured grid on output port 2. Its topology is implicit and it
+    // shares the points and point data of the polydata output, so only the
+    // point coordinates change between updates. Empty in adaptive mode.
+    vtkStructuredGrid* GetStructuredGridOutput();
+
+    // Store explicit triangle connectivity in the polydata output. On by
+    // default; turn it off when only the structured grid output is used to
+    // save the memory of the cell array.
+    vtkSetMacro(GenerateSurfaceCells, int);
+    vtkGetMacro(GenerateSurfaceCells, int);
+    vtkBooleanMacro(GenerateSurfaceCells, int);
+
     void SetNumberOfControlPoints(int m, int n);
     int* GetNumberOfControlPoints() { return this->NumberOfControlPoints; }
 
+    // Control points are only changed through SetControlPoint(), which
+    // records them for the incremental update, so the pointer returned by
+    // GetControlPoint() is read only.
     void SetControlPoint(int m, int n, double pt[3]);
     void GetControlPoint(int m, int n, double pt[3]);
-    double* GetControlPoint(int m, int n);
+    const double* GetControlPoint(int m, int n);
     void ResetControlPoints();
 
     void SetDimensions(int x, int y);
     int* GetDimensions() { return this->Dimensions; }
 
+    // When on (the default), moving a few control points updates the
+    // previously evaluated surface in place instead of re-evaluating it.
+    vtkSetMacro(IncrementalUpdate, int);
+    vtkGetMacro(IncrementalUpdate, int);
+    vtkBooleanMacro(IncrementalUpdate, int);
+
+    // Generate exact point normals (Su x Sv) from the partial derivatives
+    // of the surface. Off by default.
+    vtkSetMacro(GenerateNormals, int);
+    vtkGetMacro(GenerateNormals, int);
+    vtkBooleanMacro(GenerateNormals, int);
+
+    // Generate unit tangents along the u direction. Off by default.
+    vtkSetMacro(GenerateTangents, int);
+    vtkGetMacro(GenerateTangents, int);
+    vtkBooleanMacro(GenerateTangents, int);
+
+    // Evaluates the surface at (u, v) in [0,1]x[0,1]. du and dv receive the
+    // partial derivatives when they are non-null.
+    void EvaluatePoint(double u, double v, double pt[3], double du[3], double dv[3]);
+
+    // Intersects the segment p1-p2 with the exact surface. Returns 1 on a
+    // hit and sets t in [0,1] along the segment, the point x and the surface
+    // parameters uv of the hit closest to p1. tol is the allowed distance
+    // between x and the segment; 0 picks a tolerance relative to the size
+    // of the control net.
+    int IntersectWithLine(const double p1[3], const double p2[3], double tol,
+                          double& t, double x[3], double uv[2]);
+
+    // Projects x onto the exact surface and returns the closest point, its
+    // (u, v) parameters and the squared distance to x.
+    void FindClosestPoint(const double x[3], double closest[3], double uv[2], double& dist2);
+
+    // Computes all degree+1 Bernstein polynomials (or their derivatives)
+    // of the given degree at mu.
+    static void ComputeBernsteinBasis(int degree, double mu, double* basis);
+    static void ComputeBernsteinDerivatives(int degree, double mu, double* derivs);
+
+    // Uniform tessellation samples a Dimensions[0] x Dimensions[1] grid.
+    // Adaptive tessellation refines a quadtree over (u, v) until every cell
+    // is flat to within a tolerance, see FlatnessTolerance and
+    // ScreenSpaceError.
+    enum TessellationModes
+    {
+        UNIFORM_TESSELLATION = 0,
+        ADAPTIVE_TESSELLATION = 1
+    };
+    vtkSetClampMacro(TessellationMode, int, UNIFORM_TESSELLATION, ADAPTIVE_TESSELLATION);
+    vtkGetMacro(TessellationMode, int);
+    void SetTessellationModeToUniform() { this->SetTessellationMode(UNIFORM_TESSELLATION); }
+    void SetTessellationModeToAdaptive() { this->SetTessellationMode(ADAPTIVE_TESSELLATION); }
+
+    // Maximum distance, in world units, between the adaptive tessellation
+    // and the surface. Used when no renderer is set.
+    vtkSetMacro(FlatnessTolerance, double);
+    vtkGetMacro(FlatnessTolerance, double);
+
+    // When a renderer is set, the adaptive tolerance is instead derived from
+    // its active camera so that the error stays below ScreenSpaceError
+    // pixels. The surface is then re-tessellated when the camera changes.
+    void SetRenderer(vtkRenderer* renderer);
+    vtkRenderer* GetRenderer();
+    vtkSetMacro(ScreenSpaceError, double);
+    vtkGetMacro(ScreenSpaceError, double);
+
+    // Number of times the parameter range may be halved in each direction.
+    vtkSetClampMacro(MaximumSubdivisionLevel, int, 1, 12);
+    vtkGetMacro(MaximumSubdivisionLevel, int);
+
+    vtkMTimeType GetMTime();
+
 protected:
     vtkBezierSurfaceSource();
     ~vtkBezierSurfaceSource();
     int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+    int FillOutputPortInformation(int port, vtkInformation* info);
 
 private:
     vtkBezierSurfaceSource(const vtkBezierSurfaceSource&);  // Not implemented.
@@ -67,11 +162,73 @@ private:
 
     void UpdateControlPointsPolyData(vtkPolyData* pd);
     void UpdateBezierSurfacePolyData(vtkPolyData* pd);
+    void UpdateAdaptiveSurfacePolyData(vtkPolyData* pd);
+    void UpdateStructuredGrid(vtkStructuredGrid* sg, vtkPolyData* pd);
+    void BuildSurfaceGrid();
+    void BuildSurfaceCells();
+    void UpdateBasisTables();
+    void EvaluateSurfacePoints(double* surfacePoints);
+    void ApplyControlPointDeltas(double* surfacePoints);
+    void EvaluateDerivatives(double u, double v, double s[3], double su[3], double sv[3],
+                             double suu[3], double suv[3], double svv[3]);
+    void BuildQueryTree();
+    void BuildQueryNode(int node, const std::vector<double>& net, int depth, double flatness);
 
 private:
     int NumberOfControlPoints[2];
     int Dimensions[2];
     double* ControlPoints;
+
+    // Bernstein basis tables and their derivatives, rebuilt only when
+    // Dimensions or NumberOfControlPoints change. BasisU is
+    // Dimensions[0] x m, BasisV is n x Dimensions[1] (transposed).
+    std::vector<double> BasisU;
+    std::vector<double> BasisV;
+    std::vector<double> DBasisU;
+    std::vector<double> DBasisV;
+    std::vector<double> PartialSums;
+    int BasisTableSize[4];
+
+    // Cached surface output and the control points it was evaluated from.
+    int IncrementalUpdate;
+    int SurfaceValid;
+    int IncrementalUpdateCount;
+    vtkPoints* SurfacePoints;
+    vtkDoubleArray* SurfaceTCoords;
+    vtkCellArray* SurfaceCells;
+    int GenerateSurfaceCells;
+    int SurfaceGridSize[2];
+    std::vector<double> EvaluatedControlPoints;
+    std::vector<int> DirtyControlPoints;
+
+    // Cached partial derivatives Su and Sv, kept while normals or tangents
+    // are generated.
+    int GenerateNormals;
+    int GenerateTangents;
+    int DerivativesValid;
+    std::vector<double> DerivativesU;
+    std::vector<double> DerivativesV;
+
+    int TessellationMode;
+    double FlatnessTolerance;
+    double ScreenSpaceError;
+    int MaximumSubdivisionLevel;
+    vtkWeakPointer<vtkRenderer> Renderer;
+
+    // Hierarchy of subdivided control nets used by IntersectWithLine() and
+    // FindClosestPoint(). Every node bounds the surface over its (u, v)
+    // range by the bounding box of its control net (convex hull property).
+    // Built on the first query after the control points change, so that
+    // first query must not run concurrently with others.
+    struct QueryNode
+    {
+        double Bounds[6];
+        double Range[4]; // u0, u1, v0, v1
+        int FirstChild;  // four consecutive children, or -1 for a leaf
+    };
+    std::vector<QueryNode> QueryTree;
+    int QueryTreeValid;
+    double QueryTreeDiagonal;
 };
 
 #endif
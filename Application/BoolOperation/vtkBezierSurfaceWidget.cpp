@@ -26,118 +26,85 @@ Authors:
 
 #include "vtkOutputWindow.h"
 #include "vtkRenderer.h"
+#include "vtkCamera.h"
 #include "vtkBezierSurfaceSource.h"
 #include "vtkActor.h"
 #include "vtkProperty.h"
 #include "vtkSphereSource.h"
 #include "vtkPolyDataMapper.h"
+#include "vtkGlyph3DMapper.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkPointData.h"
+#include "vtkBitArray.h"
+#include "vtkIdList.h"
+#include "vtkPointLocator.h"
 #include "vtkRenderWindowInteractor.h"
 #include "vtkRenderWindow.h"
 #include "vtkCallbackCommand.h"
-#include "vtkPropPicker.h"
 #include "vtkSTLWriter.h"
+#include "vtkTimerLog.h"
 
-typedef unsigned int uint;
+#include <algorithm>
 
 vtkStandardNewMacro(vtkBezierSurfaceWidget);
 
-struct HandleInfo
-{
-    vtkSphereSource* Source;
-    vtkPolyDataMapper* Mapper;
-    vtkActor* Actor;
-
-    // Control point indexes
-    int xCPIndex;
-    int yCPIndex;
-
-    HandleInfo()
-    {
-        this->Source = 0;
-        this->Mapper = 0;
-
-        this->xCPIndex = -1;
-        this->yCPIndex = -1;
-    }
-
-    void Init()
-    {
-        if(this->Source)
-            return;
-
-        this->Source = vtkSphereSource::New();
-        this->Mapper = vtkPolyDataMapper::New();
-        this->Actor = vtkActor::New();
-
-        this->Source->SetThetaResolution(16);
-        this->Source->SetPhiResolution(16);
-
-
-        this->Mapper->SetInputConnection(this->Source->GetOutputPort());
-        this->Actor->SetMapper(this->Mapper);
-    }
-
-    void SetRadius(double r)
-    {
-        if(this->Source)
-            this->Source->SetRadius(r);
-    }
-
-    void SetPosition(double x, double y, double z)
-    {
-        if(this->Source)
-            this->Source->SetCenter(x, y, z);
-    }
-
-    void SetPosition(double* pt) { SetPosition(pt[0], pt[1], pt[2]); }
-
-    double* GetPosition()
-    {
-        return this->Source->GetCenter();
-    }
-
-    void GetPosition(double p[3])
-    {
-        double* pt = GetPosition();
-        p[0] = pt[0];
-        p[1] = pt[1];
-        p[2] = pt[2];
-    }
-
-    void SetVisibility(int val)
-    {
-        if(this->Actor)
-            this->Actor->SetVisibility(val);
-    }
-
-    void SetProperty(vtkProperty* prop)
-    {
-        if(this->Actor)
-            this->Actor->SetProperty(prop);
-    }
-
-    void Finish()
-    {
-        this->Source->Delete();
-        this->Mapper->Delete();
-        this->Actor->Delete();
-        delete this;
-    }
-};
-
 vtkBezierSurfaceWidget::vtkBezierSurfaceWidget()
 {
     this->Source = 0;
     this->Property = vtkProperty::New();
     this->Property->Register(this);
 
-    this->Picker = vtkPropPicker::New();
-    this->Picker->Register(this);
-
     this->CPGridMapper = 0;
     this->CPGridActor = 0;
 
     this->CurrHandleIndex = -1;
+    this->PickTolerance = 10.0;
+
+    this->MaximumUpdateRate = 30.0;
+    this->DragResolutionFactor = 4;
+    this->PendingUpdate = 0;
+    this->TimerId = -1;
+    this->LastUpdateTime = 0.0;
+    this->SavedDimensions[0] = this->SavedDimensions[1] = 0;
+
+    // Handles: one point set, glyphed with a sphere.
+    this->HandlePoints = vtkPoints::New(VTK_DOUBLE);
+    this->HandleMask = vtkBitArray::New();
+    this->HandleMask->SetName("HandleMask");
+    this->HandlePolyData = vtkPolyData::New();
+    this->HandlePolyData->SetPoints(this->HandlePoints);
+    this->HandlePolyData->GetPointData()->AddArray(this->HandleMask);
+
+    this->HandleGlyph = vtkSphereSource::New();
+    this->HandleGlyph->SetThetaResolution(16);
+    this->HandleGlyph->SetPhiResolution(16);
+
+    this->HandleMapper = vtkGlyph3DMapper::New();
+    this->HandleMapper->SetInputData(this->HandlePolyData);
+    this->HandleMapper->SetSourceConnection(this->HandleGlyph->GetOutputPort());
+    this->HandleMapper->ScalingOff();
+    this->HandleMapper->OrientOff();
+    this->HandleMapper->SetMaskArray("HandleMask");
+    this->HandleMapper->MaskingOn();
+    this->HandleMapper->ScalarVisibilityOff();
+
+    this->HandleActor = vtkActor::New();
+    this->HandleActor->SetMapper(this->HandleMapper);
+    this->HandleActor->SetProperty(this->Property);
+
+    this->SelectedHandleSource = vtkSphereSource::New();
+    this->SelectedHandleSource->SetThetaResolution(16);
+    this->SelectedHandleSource->SetPhiResolution(16);
+    vtkPolyDataMapper* selectedMapper = vtkPolyDataMapper::New();
+    selectedMapper->SetInputConnection(this->SelectedHandleSource->GetOutputPort());
+    this->SelectedHandleActor = vtkActor::New();
+    this->SelectedHandleActor->SetMapper(selectedMapper);
+    this->SelectedHandleActor->VisibilityOff();
+    selectedMapper->Delete();
+
+    this->DisplayPoints = vtkPolyData::New();
+    this->DisplayLocator = vtkPointLocator::New();
 
     this->EventCallbackCommand->SetCallback(vtkBezierSurfaceWidget::ProcessEvents);
 }
@@ -148,16 +115,29 @@ vtkBezierSurfaceWidget::~vtkBezierSurfaceWidget()
     if(this->Property)
         this->Property->UnRegister(this);
     if(this->Source)
-        this->Property->UnRegister(this);
-    if(this->Picker)
-        this->Picker->UnRegister(this);
+        this->Source->UnRegister(this);
     if(this->CPGridActor)
         this->CPGridActor->Delete();
+
+    this->HandlePoints->Delete();
+    this->HandleMask->Delete();
+    this->HandlePolyData->Delete();
+    this->HandleGlyph->Delete();
+    this->HandleMapper->Delete();
+    this->HandleActor->Delete();
+    this->SelectedHandleSource->Delete();
+    this->SelectedHandleActor->Delete();
+    this->DisplayPoints->Delete();
+    this->DisplayLocator->Delete();
 }
 
 void vtkBezierSurfaceWidget::PrintSelf(ostream& os, vtkIndent indent)
 {
     vtk3DWidget::PrintSelf(os, indent);
+
+    os << indent << "Pick Tolerance: " << this->PickTolerance << "\n";
+    os << indent << "Maximum Update Rate: " << this->MaximumUpdateRate << "\n";
+    os << indent << "Drag Resolution Factor: " << this->DragResolutionFactor << "\n";
 }
 
 void vtkBezierSurfaceWidget::SetSource(vtkBezierSurfaceSource* source)
@@ -204,20 +184,15 @@ void vtkBezierSurfaceWidget::SetProperty(vtkProperty* property)
         return;
 
     if(this->Property)
-    {
         this->Property->UnRegister(this);
-        for(uint i=0; i<this->HandleInfoList.size(); i++)
-            this->HandleInfoList[i]->SetProperty(0);
-    }
 
     this->Property = property;
 
     if(this->Property)
-    {
         this->Property->Register(this);
-        for(uint i=0; i<this->HandleInfoList.size(); i++)
-            this->HandleInfoList[i]->SetProperty(this->Property);
-    }
+
+    // All handles share one actor, so this is a single assignment.
+    this->HandleActor->SetProperty(this->Property);
 }
 
 vtkProperty* vtkBezierSurfaceWidget::GetProperty()
@@ -271,10 +246,11 @@ void vtkBezierSurfaceWidget::SetEnabled(int enabled)
                    this->EventCallbackCommand, this->Priority);
         i->AddObserver(vtkCommand::LeftButtonReleaseEvent,
                    this->EventCallbackCommand, this->Priority);
+        i->AddObserver(vtkCommand::TimerEvent,
+                   this->EventCallbackCommand, this->Priority);
 
         // Enable handle visibility
-        for(uint i=0; i<this->HandleInfoList.size(); i++)
-            this->HandleInfoList[i]->SetVisibility(1);
+        this->HandleActor->VisibilityOn();
         if(this->CPGridActor)
         {
             vtkRenderer* ren = this->GetRenderer();
@@ -288,8 +264,8 @@ void vtkBezierSurfaceWidget::SetEnabled(int enabled)
     if(!enabled)
     {
         // Disable handle visibility
-        for(uint i=0; i<this->HandleInfoList.size(); i++)
-            this->HandleInfoList[i]->SetVisibility(0);
+        this->HandleActor->VisibilityOff();
+        this->SelectedHandleActor->VisibilityOff();
         if(this->CPGridActor)
         {
             vtkRenderer* ren = this->GetRenderer();
@@ -344,27 +320,30 @@ vtkRenderer* vtkBezierSurfaceWidget::GetRenderer()
 
 void vtkBezierSurfaceWidget::DestroyHandles()
 {
-    vtkRenderer* ren = this->GetRenderer();
+    vtkRenderer* ren = this->Interactor ? this->GetRenderer() : 0;
 
     // Remove old actors first
-    for(uint i=0; i<this->HandleInfoList.size(); i++)
+    if(ren)
     {
-        HandleInfo* info = this->HandleInfoList[i];
-        if(ren)
-            ren->RemoveActor(info->Actor);
-        info->Finish();
+        ren->RemoveActor(this->HandleActor);
+        ren->RemoveActor(this->SelectedHandleActor);
     }
-    this->HandleInfoList.clear();
+
+    this->CurrHandleIndex = -1;
+    this->HandlePoints->SetNumberOfPoints(0);
+    this->HandleMask->SetNumberOfTuples(0);
+    this->HandlePolyData->Modified();
+    this->DisplayLocatorBuildTime = vtkTimeStamp();
 }
 
 void vtkBezierSurfaceWidget::SizeHandles()
 {
     //double radius = this->vtk3DWidget::SizeHandles(1.5);
     double radius = 0.1;
-    for(uint i=0; i<this->HandleInfoList.size(); i++)
+    if(this->HandleGlyph->GetRadius() != radius)
     {
-        HandleInfo* info = this->HandleInfoList[i];
-        info->SetRadius(radius);
+        this->HandleGlyph->SetRadius(radius);
+        this->SelectedHandleSource->SetRadius(radius);
     }
 }
 
@@ -375,55 +354,59 @@ void vtkBezierSurfaceWidget::ConstructHandles()
     if(!this->Source || !ren)
         return;
 
-    // Construct as many mappers and actors as control points
+    // One handle point per control point, all drawn by the same glyph
+    // mapper.
     int* vec = this->Source->GetNumberOfControlPoints();
     int nrControlPts = vec[0] * vec[1];
     int index = 0;
-    this->HandleInfoList.resize(nrControlPts, (HandleInfo*)0);
+    this->HandlePoints->SetNumberOfPoints(nrControlPts);
+    this->HandleMask->SetNumberOfComponents(1);
+    this->HandleMask->SetNumberOfTuples(nrControlPts);
     for(int i=0; i<vec[0]; i++)
     {
         for(int j=0; j<vec[1]; j++)
         {
-            double* pt = this->Source->GetControlPoint(i, j);
-
-            HandleInfo* info = new HandleInfo;
-            info->Init();
-            info->SetPosition(pt);
-            info->SetProperty(this->Property);
-            info->SetVisibility(this->GetEnabled());
-
-            // Store the control point indexes too to retrieve them later
-            info->xCPIndex = i;
-            info->yCPIndex = j;
-
-            this->HandleInfoList[index++] = info;
-
-            ren->AddActor(info->Actor);
-
-            // Add the actor to pick list
-            this->Picker->AddPickList(info->Actor);
+            this->HandlePoints->SetPoint(index, this->Source->GetControlPoint(i, j));
+            this->HandleMask->SetValue(index, 1);
+            ++index;
         }
     }
+    this->HandlePoints->Modified();
+    this->HandleMask->Modified();
+    this->HandlePolyData->Modified();
+
+    this->HandleActor->SetVisibility(this->GetEnabled());
+    ren->AddActor(this->HandleActor);
+    ren->AddActor(this->SelectedHandleActor);
 
-    this->Picker->PickFromListOn();
+    this->CurrHandleIndex = -1;
+    this->SelectedHandleActor->VisibilityOff();
     this->SizeHandles();
 }
 
 void vtkBezierSurfaceWidget::SelectHandle(int index)
 {
-    if(index < 0 || index >= (int)this->HandleInfoList.size())
+    if(index < 0 || index >= this->HandlePoints->GetNumberOfPoints())
         return;
 
-    HandleInfo *info = this->HandleInfoList[index];
+    if(this->CurrHandleIndex >= 0)
+        this->UnSelectCurrentHandle();
 
     // Cannot modify this->Property; because that will alter everything.
     vtkProperty *p = vtkProperty::New();
     p->DeepCopy(this->Property); // base the new property on the current one.
     p->SetColor(1.0, 0.0, 0.0);
-    info->SetProperty(p);
+    this->SelectedHandleActor->SetProperty(p);
     p->Delete();
 
-    // Update the current index value from the HandleInfoList
+    // Hide the glyph of this handle and draw the highlighted sphere in its
+    // place.
+    this->HandleMask->SetValue(index, 0);
+    this->HandleMask->Modified();
+    this->SelectedHandleSource->SetCenter(this->HandlePoints->GetPoint(index));
+    this->SelectedHandleActor->VisibilityOn();
+
+    // Update the current index value
     this->CurrHandleIndex = index;
 }
 
@@ -432,12 +415,82 @@ void vtkBezierSurfaceWidget::UnSelectCurrentHandle()
     if(this->CurrHandleIndex < 0)
         return;
 
-    HandleInfo *info = this->HandleInfoList[this->CurrHandleIndex];
-    info->SetProperty(this->Property);
+    this->HandleMask->SetValue(this->CurrHandleIndex, 1);
+    this->HandleMask->Modified();
+    this->SelectedHandleActor->VisibilityOff();
     this->CurrHandleIndex = -1;
 }
 
-void vtkBezierSurfaceWidget::ProcessEvents(vtkObject*, unsigned long event, void* clientdata, void*)
+// Projects all handles to display coordinates and rebuilds the point locator
+// over them. The projection only changes with the camera, the viewport or
+// the handles, so repeated clicks reuse the same locator.
+void vtkBezierSurfaceWidget::BuildDisplayLocator(vtkRenderer* ren)
+{
+    vtkIdType nrHandles = this->HandlePoints->GetNumberOfPoints();
+    vtkMTimeType mtime = this->HandlePoints->GetMTime();
+    mtime = std::max(mtime, ren->GetActiveCamera()->GetMTime());
+    mtime = std::max(mtime, ren->GetMTime());
+    if(ren->GetRenderWindow())
+        mtime = std::max(mtime, ren->GetRenderWindow()->GetMTime());
+    if(this->DisplayLocatorBuildTime.GetMTime() > mtime &&
+       this->DisplayPoints->GetNumberOfPoints() == nrHandles)
+        return;
+
+    vtkPoints* displayPts = vtkPoints::New(VTK_DOUBLE);
+    displayPts->SetNumberOfPoints(nrHandles);
+    this->DisplayDepths.resize(nrHandles);
+    for(vtkIdType k=0; k<nrHandles; k++)
+    {
+        double world[3], display[3];
+        this->HandlePoints->GetPoint(k, world);
+        ren->SetWorldPoint(world[0], world[1], world[2], 1.0);
+        ren->WorldToDisplay();
+        ren->GetDisplayPoint(display);
+
+        displayPts->SetPoint(k, display[0], display[1], 0.0);
+        this->DisplayDepths[k] = display[2];
+    }
+
+    this->DisplayPoints->SetPoints(displayPts);
+    displayPts->Delete();
+
+    this->DisplayLocator->Initialize();
+    this->DisplayLocator->SetDataSet(this->DisplayPoints);
+    this->DisplayLocator->BuildLocator();
+    this->DisplayLocatorBuildTime.Modified();
+}
+
+// Returns the handle under display position (x, y), or -1. Among the handles
+// within PickTolerance pixels the one closest to the viewer wins.
+int vtkBezierSurfaceWidget::PickHandle(double x, double y, vtkRenderer* ren)
+{
+    if(this->HandlePoints->GetNumberOfPoints() == 0)
+        return -1;
+
+    this->BuildDisplayLocator(ren);
+
+    double pos[3] = {x, y, 0.0};
+    vtkIdList* ids = vtkIdList::New();
+    this->DisplayLocator->FindPointsWithinRadius(this->PickTolerance, pos, ids);
+
+    int picked = -1;
+    double depth = VTK_DOUBLE_MAX;
+    for(vtkIdType k=0; k<ids->GetNumberOfIds(); k++)
+    {
+        vtkIdType id = ids->GetId(k);
+        double d = this->DisplayDepths[id];
+        if(d >= 0.0 && d <= 1.0 && d < depth)
+        {
+            depth = d;
+            picked = int(id);
+        }
+    }
+    ids->Delete();
+
+    return picked;
+}
+
+void vtkBezierSurfaceWidget::ProcessEvents(vtkObject*, unsigned long event, void* clientdata, void* calldata)
 {
     vtkBezierSurfaceWidget* self = reinterpret_cast<vtkBezierSurfaceWidget *>(clientdata);
 
@@ -452,6 +505,10 @@ void vtkBezierSurfaceWidget::ProcessEvents(vtkObject*, unsigned long event, void
         case vtkCommand::MouseMoveEvent:
             self->OnMouseMove();
             break;
+        case vtkCommand::TimerEvent:
+            if(calldata)
+                self->OnTimer(*reinterpret_cast<int*>(calldata));
+            break;
         default:
             break;
     }
@@ -469,34 +526,28 @@ void vtkBezierSurfaceWidget::OnLeftButtonDown()
     if(!ren)
         return;
 
-    // Pick from the renderer
-    this->Picker->Pick(double(x), double(y), 0.0, ren);
-
-    // Store the current pick position in an array
-    this->Picker->GetPickPosition(this->LastPickPosition);
-
-    vtkActor *pickedActor = this->Picker->GetActor();
-    if(!pickedActor)
+    // Pick the nearest handle in display space
+    int index = this->PickHandle(double(x), double(y), ren);
+    if(index < 0)
     {
         UnSelectCurrentHandle();
         return;
     }
 
-    // Highlight the picked handle
-    this->CurrHandleIndex = -1;
-    for(uint i=0; i<this->HandleInfoList.size(); i++)
-    {
-        HandleInfo *info = this->HandleInfoList[i];
-        if(pickedActor == info->Actor)
-        {
-            this->SelectHandle(i);
-            break;
-        }
-    }
-
-    // Handle Index not found
-    if(this->CurrHandleIndex < 0)
-        return;
+    // Highlight the picked handle and drag relative to its centre
+    this->SelectHandle(index);
+    this->HandlePoints->GetPoint(index, this->LastPickPosition);
+
+    // Tessellate coarsely while dragging; OnLeftButtonUp() restores the
+    // full resolution.
+    int* dims = this->Source->GetDimensions();
+    this->SavedDimensions[0] = dims[0];
+    this->SavedDimensions[1] = dims[1];
+    if(this->DragResolutionFactor > 1)
+        this->Source->SetDimensions(std::max(2, dims[0] / this->DragResolutionFactor),
+                                    std::max(2, dims[1] / this->DragResolutionFactor));
+    this->PendingUpdate = 0;
+    this->LastUpdateTime = 0.0;
 
     this->EventCallbackCommand->SetAbortFlag(1);
     this->StartInteraction();
@@ -525,26 +576,66 @@ void vtkBezierSurfaceWidget::OnMouseMove()
                                 focalPoint[2], prevPickPoint);
     this->ComputeDisplayToWorld(double(x), double(y), focalPoint[2], pickPoint);
 
-    // Get the handle info of the current handle
-    HandleInfo *info = this->HandleInfoList[this->CurrHandleIndex];
     double p[3];
 
     // Get the current position of the handle
-    info->GetPosition(currPos);
+    this->HandlePoints->GetPoint(this->CurrHandleIndex, currPos);
 
     // Current handle centre + motion vector
     p[0] = currPos[0] + ( pickPoint[0] - prevPickPoint[0] );
     p[1] = currPos[1] + ( pickPoint[1] - prevPickPoint[1] );
     p[2] = currPos[2] + ( pickPoint[2] - prevPickPoint[2] );
 
-    // Modify the handle position and the control point position
-    info->SetPosition(p[0], p[1], p[2]);
+    // Only the handle point is moved here. The control point and the
+    // render follow in ApplyPendingUpdate(), at most MaximumUpdateRate
+    // times per second; moves in between are coalesced into the latest
+    // handle position.
+    this->HandlePoints->SetPoint(this->CurrHandleIndex, p);
+    this->HandlePoints->Modified();
+    this->PendingUpdate = 1;
+    this->EventCallbackCommand->SetAbortFlag(1);
 
-    // Dont modify the control point yet, modify it upon mouse release
+    double interval = (this->MaximumUpdateRate > 0) ? 1.0 / this->MaximumUpdateRate : 0.0;
+    double elapsed = vtkTimerLog::GetUniversalTime() - this->LastUpdateTime;
+    if(elapsed >= interval)
+    {
+        this->ApplyPendingUpdate();
+    }
+    else if(this->TimerId < 0)
+    {
+        unsigned long wait = static_cast<unsigned long>((interval - elapsed) * 1000.0) + 1;
+        this->TimerId = this->Interactor->CreateOneShotTimer(wait);
+    }
+}
 
+void vtkBezierSurfaceWidget::OnTimer(int timerId)
+{
+    if(timerId != this->TimerId)
+        return;
+
+    this->TimerId = -1;
     this->EventCallbackCommand->SetAbortFlag(1);
+    this->ApplyPendingUpdate();
+}
+
+// Moves the control point of the current handle to the handle position and
+// renders. The source only re-evaluates the contribution of this control
+// point, so the surface can follow the handle while it is dragged.
+void vtkBezierSurfaceWidget::ApplyPendingUpdate()
+{
+    if(!this->PendingUpdate || this->CurrHandleIndex < 0)
+        return;
+
+    double p[3];
+    int n = this->Source->GetNumberOfControlPoints()[1];
+    this->HandlePoints->GetPoint(this->CurrHandleIndex, p);
+    this->SelectedHandleSource->SetCenter(p);
+    this->Source->SetControlPoint(this->CurrHandleIndex / n, this->CurrHandleIndex % n, p);
+    this->PendingUpdate = 0;
+
     this->InvokeEvent(vtkCommand::InteractionEvent, NULL);
     this->Interactor->Render();
+    this->LastUpdateTime = vtkTimerLog::GetUniversalTime();
 }
 
 void vtkBezierSurfaceWidget::OnLeftButtonUp()
@@ -555,12 +646,22 @@ void vtkBezierSurfaceWidget::OnLeftButtonUp()
     if(this->CurrHandleIndex < 0)
         return;
 
-    // Get the handle info of the current handle
-    HandleInfo *info = this->HandleInfoList[this->CurrHandleIndex];
+    // Get the position of the current handle
     double p[3];
-    info->GetPosition(p);
+    int n = this->Source->GetNumberOfControlPoints()[1];
+    this->HandlePoints->GetPoint(this->CurrHandleIndex, p);
+
+    this->Source->SetControlPoint(this->CurrHandleIndex / n, this->CurrHandleIndex % n, p);
+    this->PendingUpdate = 0;
+    if(this->TimerId >= 0)
+    {
+        this->Interactor->DestroyTimer(this->TimerId);
+        this->TimerId = -1;
+    }
 
-    this->Source->SetControlPoint(info->xCPIndex, info->yCPIndex, p);
+    // Snap back to the full tessellation.
+    if(this->DragResolutionFactor > 1)
+        this->Source->SetDimensions(this->SavedDimensions[0], this->SavedDimensions[1]);
 
     this->UnSelectCurrentHandle();
     this->EventCallbackCommand->SetAbortFlag(1);
@@ -33,10 +33,14 @@ class vtkActor;
 class vtkProp3D;
 class vtkDataSet;
 class vtkProperty;
-class vtkPropPicker;
+class vtkPoints;
+class vtkPolyData;
+class vtkBitArray;
+class vtkSphereSource;
+class vtkGlyph3DMapper;
+class vtkPointLocator;
 class vtkPolyDataMapper;
 class vtkBezierSurfaceSource;
-struct HandleInfo;
 
 class vtkBezierSurfaceWidget : public vtk3DWidget
 {
@@ -61,6 +65,22 @@ public:
     void SetPlaceFactor(double val);
     void SetHandleSize(double size);
 
+    // Maximum distance in pixels between the cursor and the centre of a
+    // handle for the handle to be picked.
+    vtkSetMacro(PickTolerance, double);
+    vtkGetMacro(PickTolerance, double);
+
+    // Maximum number of source updates and renders per second while a
+    // handle is dragged. Mouse moves that arrive faster are coalesced and
+    // only the latest handle position is applied. 0 means unlimited.
+    vtkSetClampMacro(MaximumUpdateRate, double, 0.0, VTK_DOUBLE_MAX);
+    vtkGetMacro(MaximumUpdateRate, double);
+
+    // While dragging, the source dimensions are divided by this factor;
+    // full resolution is restored on button release. 1 disables it.
+    vtkSetClampMacro(DragResolutionFactor, int, 1, VTK_INT_MAX);
+    vtkGetMacro(DragResolutionFactor, int);
+
 protected:
     vtkBezierSurfaceWidget();
     ~vtkBezierSurfaceWidget();
@@ -71,8 +91,12 @@ protected:
     void ConstructHandles();
     void SelectHandle(int index);
     void UnSelectCurrentHandle();
+    void BuildDisplayLocator(vtkRenderer* ren);
+    int PickHandle(double x, double y, vtkRenderer* ren);
+    void ApplyPendingUpdate();
 
     static void ProcessEvents(vtkObject* object, unsigned long event, void* clientdata, void* calldata);
+    virtual void OnTimer(int timerId);
 
     // ProcessEvents() dispatches to these methods.
     virtual void OnLeftButtonDown();
@@ -81,13 +105,39 @@ protected:
 
 private:
     vtkBezierSurfaceSource* Source;
-    std::vector<HandleInfo*> HandleInfoList;
     int CurrHandleIndex;
     vtkProperty* Property;
-    vtkPropPicker* Picker;
     vtkPolyDataMapper* CPGridMapper;
     vtkActor* CPGridActor;
 
+    // All handles are one glyphed point set: handle k sits at control point
+    // (k / n, k % n). The selected handle is masked out of the glyphs and
+    // drawn by its own highlighted sphere instead.
+    vtkPoints* HandlePoints;
+    vtkBitArray* HandleMask;
+    vtkPolyData* HandlePolyData;
+    vtkSphereSource* HandleGlyph;
+    vtkGlyph3DMapper* HandleMapper;
+    vtkActor* HandleActor;
+    vtkSphereSource* SelectedHandleSource;
+    vtkActor* SelectedHandleActor;
+
+    // Handles projected to display coordinates (z = 0) and a locator over
+    // them, rebuilt only when the camera or the handles change.
+    vtkPolyData* DisplayPoints;
+    vtkPointLocator* DisplayLocator;
+    std::vector<double> DisplayDepths;
+    vtkTimeStamp DisplayLocatorBuildTime;
+    double PickTolerance;
+
+    // Drag throttling state.
+    double MaximumUpdateRate;
+    int DragResolutionFactor;
+    int PendingUpdate;
+    int TimerId;
+    double LastUpdateTime;
+    int SavedDimensions[2];
+
 private:
     vtkBezierSurfaceWidget(const vtkBezierSurfaceWidget&);  //Not implemented
     void operator=(const vtkBezierSurfaceWidget&);  //Not implemented
@@ -0,0 +1,545 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMultiPatchBezierSurfaceSource.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMultiPatchBezierSurfaceSource.h"
+
+#include "vtkBezierSurfaceSource.h"
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDoubleArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkIntArray.h"
+#include "vtkObjectFactory.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+vtkStandardNewMacro(vtkMultiPatchBezierSurfaceSource);
+
+vtkMultiPatchBezierSurfaceSource::vtkMultiPatchBezierSurfaceSource()
+{
+  this->Dimensions[0] = 10;
+  this->Dimensions[1] = 10;
+  this->MergeBoundaries = 1;
+  this->Tolerance = 1.0e-6;
+
+  this->SetNumberOfInputPorts(0);
+}
+
+int vtkMultiPatchBezierSurfaceSource::AddPatch(int m, int n, const double* controlPoints,
+                                               const double* weights)
+{
+  if (m < 2 || n < 2 || !controlPoints)
+    {
+    vtkErrorMacro(<< "A patch needs at least 2 x 2 control points");
+    return -1;
+    }
+
+  int offset = static_cast<int>(this->X.size());
+  this->PatchOffsets.push_back(offset);
+  this->PatchSizes.push_back(m);
+  this->PatchSizes.push_back(n);
+
+  for (int k = 0; k < m*n; k++)
+    {
+    this->X.push_back(controlPoints[k*3]);
+    this->Y.push_back(controlPoints[k*3+1]);
+    this->Z.push_back(controlPoints[k*3+2]);
+    this->W.push_back(weights ? weights[k] : 1.0);
+    }
+
+  this->Modified();
+  return this->GetNumberOfPatches() - 1;
+}
+
+void vtkMultiPatchBezierSurfaceSource::RemoveAllPatches()
+{
+  this->X.clear();
+  this->Y.clear();
+  this->Z.clear();
+  this->W.clear();
+  this->PatchOffsets.clear();
+  this->PatchSizes.clear();
+  this->Modified();
+}
+
+void vtkMultiPatchBezierSurfaceSource::SetControlPoint(int patch, int i, int j, const double pt[3])
+{
+  if (patch < 0 || patch >= this->GetNumberOfPatches() ||
+      i < 0 || i >= this->PatchSizes[2*patch] || j < 0 || j >= this->PatchSizes[2*patch+1])
+    {
+    return;
+    }
+
+  int k = this->PatchOffsets[patch] + i*this->PatchSizes[2*patch+1] + j;
+  this->X[k] = pt[0];
+  this->Y[k] = pt[1];
+  this->Z[k] = pt[2];
+  this->Modified();
+}
+
+void vtkMultiPatchBezierSurfaceSource::GetControlPoint(int patch, int i, int j, double pt[3])
+{
+  if (patch < 0 || patch >= this->GetNumberOfPatches() ||
+      i < 0 || i >= this->PatchSizes[2*patch] || j < 0 || j >= this->PatchSizes[2*patch+1])
+    {
+    return;
+    }
+
+  int k = this->PatchOffsets[patch] + i*this->PatchSizes[2*patch+1] + j;
+  pt[0] = this->X[k];
+  pt[1] = this->Y[k];
+  pt[2] = this->Z[k];
+}
+
+void vtkMultiPatchBezierSurfaceSource::SetWeight(int patch, int i, int j, double w)
+{
+  if (patch < 0 || patch >= this->GetNumberOfPatches() ||
+      i < 0 || i >= this->PatchSizes[2*patch] || j < 0 || j >= this->PatchSizes[2*patch+1])
+    {
+    return;
+    }
+
+  this->W[this->PatchOffsets[patch] + i*this->PatchSizes[2*patch+1] + j] = w;
+  this->Modified();
+}
+
+double vtkMultiPatchBezierSurfaceSource::GetWeight(int patch, int i, int j)
+{
+  if (patch < 0 || patch >= this->GetNumberOfPatches() ||
+      i < 0 || i >= this->PatchSizes[2*patch] || j < 0 || j >= this->PatchSizes[2*patch+1])
+    {
+    return 0.0;
+    }
+
+  return this->W[this->PatchOffsets[patch] + i*this->PatchSizes[2*patch+1] + j];
+}
+
+// Returns the Bernstein table of the given order sampled at 'samples'
+// parameter values, either as samples x order (u tables) or transposed as
+// order x samples (v tables). Tables are built on first use and shared by
+// every patch of the same degree.
+const double* vtkMultiPatchBezierSurfaceSource::GetBasisTable(int order, int samples, int transposed)
+{
+  std::map<std::pair<int, int>, std::vector<double> >& tables =
+    transposed ? this->BasisTablesV : this->BasisTablesU;
+
+  std::vector<double>& table = tables[std::make_pair(order, samples)];
+  if (table.empty())
+    {
+    std::vector<double> basis(order);
+    table.resize(order*samples);
+    for (int s = 0; s < samples; s++)
+      {
+      double mu = (samples > 1) ? s / static_cast<double>(samples-1) : 0.0;
+      vtkBezierSurfaceSource::ComputeBernsteinBasis(order-1, mu, &basis[0]);
+      for (int k = 0; k < order; k++)
+        {
+        table[transposed ? k*samples + s : s*order + k] = basis[k];
+        }
+      }
+    }
+
+  return &table[0];
+}
+
+namespace
+{
+// Packs the bin coordinates of a boundary sample into one key, 21 bits
+// per axis. Coordinates outside that range wrap around, so distant bins
+// may share a key; they only add candidates to the distance test.
+inline unsigned long long PackBinKey(long long i, long long j, long long k)
+{
+  const unsigned long long mask = (1ULL << 21) - 1;
+  return (static_cast<unsigned long long>(i) & mask) |
+         ((static_cast<unsigned long long>(j) & mask) << 21) |
+         ((static_cast<unsigned long long>(k) & mask) << 42);
+}
+
+struct PatchEvaluation
+{
+  const double* BasisU; // DimX x M
+  const double* BasisV; // N x DimY
+  int Offset;
+  int M;
+  int N;
+};
+
+// Evaluates one u-row of one patch per index in [begin, end); row r belongs
+// to patch r / DimX. Rational patches are evaluated in homogeneous
+// coordinates (wx, wy, wz, w) and projected at the end.
+class EvaluatePatchRows
+{
+public:
+  const PatchEvaluation* Patches;
+  const double* X;
+  const double* Y;
+  const double* Z;
+  const double* W;
+  double* Samples;
+  int DimX;
+  int DimY;
+  int MaxN;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    // q holds the u-combined homogeneous control rows, s the row samples.
+    std::vector<double> q(4*this->MaxN);
+    std::vector<double> s(4*this->DimY);
+
+    for (vtkIdType r = begin; r < end; r++)
+      {
+      const PatchEvaluation& patch = this->Patches[r / this->DimX];
+      const int i = static_cast<int>(r % this->DimX);
+      const int n = patch.N;
+      double* qx = &q[0];
+      double* qy = qx + n;
+      double* qz = qy + n;
+      double* qw = qz + n;
+
+      std::fill(q.begin(), q.begin() + 4*n, 0.0);
+      const double* bu = patch.BasisU + i*patch.M;
+      for (int ki = 0; ki < patch.M; ki++)
+        {
+        const double b = bu[ki];
+        const int row = patch.Offset + ki*n;
+        const double* x = this->X + row;
+        const double* y = this->Y + row;
+        const double* z = this->Z + row;
+        const double* w = this->W + row;
+        for (int kj = 0; kj < n; kj++)
+          {
+          const double bw = b * w[kj];
+          qx[kj] += bw * x[kj];
+          qy[kj] += bw * y[kj];
+          qz[kj] += bw * z[kj];
+          qw[kj] += bw;
+          }
+        }
+
+      double* sx = &s[0];
+      double* sy = sx + this->DimY;
+      double* sz = sy + this->DimY;
+      double* sw = sz + this->DimY;
+      std::fill(s.begin(), s.end(), 0.0);
+      for (int kj = 0; kj < n; kj++)
+        {
+        const double* bv = patch.BasisV + kj*this->DimY;
+        for (int j = 0; j < this->DimY; j++)
+          {
+          sx[j] += bv[j] * qx[kj];
+          sy[j] += bv[j] * qy[kj];
+          sz[j] += bv[j] * qz[kj];
+          sw[j] += bv[j] * qw[kj];
+          }
+        }
+
+      double* out = this->Samples + r*this->DimY*3;
+      for (int j = 0; j < this->DimY; j++)
+        {
+        const double inv = (sw[j] != 0.0) ? 1.0 / sw[j] : 0.0;
+        out[j*3]   = sx[j] * inv;
+        out[j*3+1] = sy[j] * inv;
+        out[j*3+2] = sz[j] * inv;
+        }
+      }
+  }
+};
+
+// Copies every sample that owns its output point.
+class ScatterSamples
+{
+public:
+  const double* Samples;
+  const vtkIdType* PointIds;
+  const char* Owner;
+  double* Points;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType k = begin; k < end; k++)
+      {
+      if (this->Owner[k])
+        {
+        double* p = this->Points + this->PointIds[k]*3;
+        p[0] = this->Samples[k*3];
+        p[1] = this->Samples[k*3+1];
+        p[2] = this->Samples[k*3+2];
+        }
+      }
+  }
+};
+
+// Writes the two triangles of every grid quad for one patch row per index.
+class GeneratePatchTriangles
+{
+public:
+  const vtkIdType* PointIds;
+  vtkIdType* Cells;
+  int* PatchIds;
+  int DimX;
+  int DimY;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const vtkIdType quadsPerPatch = static_cast<vtkIdType>(this->DimX-1)*(this->DimY-1);
+    for (vtkIdType r = begin; r < end; r++)
+      {
+      const vtkIdType patch = r / (this->DimX-1);
+      const vtkIdType i = r % (this->DimX-1);
+      const vtkIdType* ids = this->PointIds + patch*this->DimX*this->DimY;
+      vtkIdType quad = patch*quadsPerPatch + i*(this->DimY-1);
+      vtkIdType* cell = this->Cells + quad*8;
+      for (int j = 0; j < this->DimY-1; j++, quad++)
+        {
+        const vtkIdType a = ids[i*this->DimY + j];
+        const vtkIdType b = ids[(i+1)*this->DimY + j];
+        const vtkIdType c = ids[(i+1)*this->DimY + j+1];
+        const vtkIdType d = ids[i*this->DimY + j+1];
+
+        // Counter-clockwise in (u, v), i.e. oriented along Su x Sv.
+        cell[0] = 3; cell[1] = a; cell[2] = b; cell[3] = c;
+        cell[4] = 3; cell[5] = a; cell[6] = c; cell[7] = d;
+        cell += 8;
+
+        this->PatchIds[quad*2] = static_cast<int>(patch);
+        this->PatchIds[quad*2+1] = static_cast<int>(patch);
+        }
+      }
+  }
+};
+}
+
+// Assigns output point ids to all samples. Interior samples are unique;
+// boundary samples are hashed into a grid of tolerance-sized bins and
+// merged with any earlier boundary sample within the tolerance. Returns
+// the number of output points.
+vtkIdType vtkMultiPatchBezierSurfaceSource::MergeBoundarySamples(
+  const double* samples, std::vector<vtkIdType>& pointIds, std::vector<char>& owner)
+{
+  const int dimx = this->Dimensions[0];
+  const int dimy = this->Dimensions[1];
+  const vtkIdType perPatch = static_cast<vtkIdType>(dimx)*dimy;
+  const vtkIdType nrSamples = perPatch*this->GetNumberOfPatches();
+
+  double bounds[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX,
+                       -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (size_t k = 0; k < this->X.size(); k++)
+    {
+    bounds[0] = std::min(bounds[0], this->X[k]); bounds[1] = std::max(bounds[1], this->X[k]);
+    bounds[2] = std::min(bounds[2], this->Y[k]); bounds[3] = std::max(bounds[3], this->Y[k]);
+    bounds[4] = std::min(bounds[4], this->Z[k]); bounds[5] = std::max(bounds[5], this->Z[k]);
+    }
+  double diagonal = sqrt((bounds[1]-bounds[0])*(bounds[1]-bounds[0]) +
+                         (bounds[3]-bounds[2])*(bounds[3]-bounds[2]) +
+                         (bounds[5]-bounds[4])*(bounds[5]-bounds[4]));
+  double tol = this->Tolerance * diagonal;
+  double binSize = (tol > 0.0) ? tol : 1.0e-12 * (diagonal > 0.0 ? diagonal : 1.0);
+  double tol2 = tol*tol;
+
+  typedef std::unordered_map<unsigned long long, std::vector<vtkIdType> > BinMap;
+  BinMap bins;
+  if (this->MergeBoundaries)
+    {
+    bins.reserve(static_cast<size_t>(2*(dimx + dimy) - 4) * this->GetNumberOfPatches());
+    }
+
+  pointIds.resize(nrSamples);
+  owner.assign(nrSamples, 1);
+  vtkIdType nextId = 0;
+  for (vtkIdType k = 0; k < nrSamples; k++)
+    {
+    const vtkIdType local = k % perPatch;
+    const int i = static_cast<int>(local / dimy);
+    const int j = static_cast<int>(local % dimy);
+    const int onBoundary = (i == 0 || j == 0 || i == dimx-1 || j == dimy-1);
+    if (!this->MergeBoundaries || !onBoundary)
+      {
+      pointIds[k] = nextId++;
+      continue;
+      }
+
+    const double* x = samples + k*3;
+    long long key[3];
+    for (int c = 0; c < 3; c++)
+      {
+      key[c] = static_cast<long long>(floor(x[c] / binSize));
+      }
+
+    // Look for an earlier boundary sample in the 27 neighbouring bins.
+    vtkIdType match = -1;
+    for (int dx = -1; dx <= 1 && match < 0; dx++)
+      {
+      for (int dy = -1; dy <= 1 && match < 0; dy++)
+        {
+        for (int dz = -1; dz <= 1 && match < 0; dz++)
+          {
+          BinMap::iterator bin =
+            bins.find(PackBinKey(key[0]+dx, key[1]+dy, key[2]+dz));
+          if (bin == bins.end())
+            {
+            continue;
+            }
+          for (size_t b = 0; b < bin->second.size(); b++)
+            {
+            const double* y = samples + bin->second[b]*3;
+            double d2 = (x[0]-y[0])*(x[0]-y[0]) + (x[1]-y[1])*(x[1]-y[1]) + (x[2]-y[2])*(x[2]-y[2]);
+            if (d2 <= tol2)
+              {
+              match = bin->second[b];
+              break;
+              }
+            }
+          }
+        }
+      }
+
+    if (match >= 0)
+      {
+      pointIds[k] = pointIds[match];
+      owner[k] = 0;
+      }
+    else
+      {
+      pointIds[k] = nextId++;
+      bins[PackBinKey(key[0], key[1], key[2])].push_back(k);
+      }
+    }
+
+  return nextId;
+}
+
+int vtkMultiPatchBezierSurfaceSource::RequestData(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **vtkNotUsed(inputVector),
+  vtkInformationVector *outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  vtkPolyData *output = vtkPolyData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  const int nrPatches = this->GetNumberOfPatches();
+  const int dimx = this->Dimensions[0];
+  const int dimy = this->Dimensions[1];
+  if (nrPatches == 0 || dimx < 2 || dimy < 2)
+    {
+    return 1;
+    }
+
+  // Basis tables only depend on (degree, samples); drop the ones built for
+  // other dimensions.
+  for (std::map<std::pair<int, int>, std::vector<double> >::iterator it = this->BasisTablesU.begin();
+       it != this->BasisTablesU.end(); )
+    {
+    if (it->first.second != dimx)
+      {
+      this->BasisTablesU.erase(it++);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+  for (std::map<std::pair<int, int>, std::vector<double> >::iterator it = this->BasisTablesV.begin();
+       it != this->BasisTablesV.end(); )
+    {
+    if (it->first.second != dimy)
+      {
+      this->BasisTablesV.erase(it++);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+
+  std::vector<PatchEvaluation> patches(nrPatches);
+  int maxN = 0;
+  for (int p = 0; p < nrPatches; p++)
+    {
+    patches[p].M = this->PatchSizes[2*p];
+    patches[p].N = this->PatchSizes[2*p+1];
+    patches[p].Offset = this->PatchOffsets[p];
+    patches[p].BasisU = this->GetBasisTable(patches[p].M, dimx, 0);
+    patches[p].BasisV = this->GetBasisTable(patches[p].N, dimy, 1);
+    maxN = std::max(maxN, patches[p].N);
+    }
+
+  // Evaluate every row of every patch in one parallel batch.
+  const vtkIdType perPatch = static_cast<vtkIdType>(dimx)*dimy;
+  std::vector<double> samples(perPatch*nrPatches*3);
+  EvaluatePatchRows evaluate;
+  evaluate.Patches = &patches[0];
+  evaluate.X = &this->X[0];
+  evaluate.Y = &this->Y[0];
+  evaluate.Z = &this->Z[0];
+  evaluate.W = &this->W[0];
+  evaluate.Samples = &samples[0];
+  evaluate.DimX = dimx;
+  evaluate.DimY = dimy;
+  evaluate.MaxN = maxN;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(dimx)*nrPatches, evaluate);
+
+  std::vector<vtkIdType> pointIds;
+  std::vector<char> owner;
+  vtkIdType nrPoints = this->MergeBoundarySamples(&samples[0], pointIds, owner);
+
+  vtkPoints* points = vtkPoints::New(VTK_DOUBLE);
+  points->SetNumberOfPoints(nrPoints);
+  ScatterSamples scatter;
+  scatter.Samples = &samples[0];
+  scatter.PointIds = &pointIds[0];
+  scatter.Owner = &owner[0];
+  scatter.Points = vtkDoubleArray::SafeDownCast(points->GetData())->GetPointer(0);
+  vtkSMPTools::For(0, perPatch*nrPatches, scatter);
+
+  const vtkIdType nrCells = static_cast<vtkIdType>(dimx-1)*(dimy-1)*2*nrPatches;
+  vtkCellArray* cells = vtkCellArray::New();
+  vtkIntArray* patchIds = vtkIntArray::New();
+  patchIds->SetName("PatchId");
+  patchIds->SetNumberOfTuples(nrCells);
+
+  GeneratePatchTriangles triangles;
+  triangles.PointIds = &pointIds[0];
+  triangles.Cells = cells->WritePointer(nrCells, nrCells*4);
+  triangles.PatchIds = patchIds->GetPointer(0);
+  triangles.DimX = dimx;
+  triangles.DimY = dimy;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(dimx-1)*nrPatches, triangles);
+
+  output->SetPoints(points);
+  points->Delete();
+  output->SetPolys(cells);
+  cells->Delete();
+  output->GetCellData()->AddArray(patchIds);
+  patchIds->Delete();
+
+  return 1;
+}
+
+void vtkMultiPatchBezierSurfaceSource::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "Number Of Patches: " << this->GetNumberOfPatches() << "\n";
+  os << indent << "Dimensions: (" << this->Dimensions[0] << ", "
+     << this->Dimensions[1] << ")\n";
+  os << indent << "Merge Boundaries: " << (this->MergeBoundaries ? "On\n" : "Off\n");
+  os << indent << "Tolerance: " << this->Tolerance << "\n";
+}
@@ -0,0 +1,110 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMultiPatchBezierSurfaceSource.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMultiPatchBezierSurfaceSource - tessellate many (rational) Bezier patches at once
+// .SECTION Description
+// vtkMultiPatchBezierSurfaceSource holds any number of tensor-product Bezier
+// patches, each with its own m x n control net and optional weights
+// (rational Bezier). All control nets live in one contiguous
+// structure-of-arrays buffer, and all patches are evaluated in a single
+// parallel pass on a Dimensions[0] x Dimensions[1] grid per patch. Patches
+// of equal degree share their basis tables. Samples on patch boundaries
+// that coincide (within Tolerance) are merged, so patches that meet along
+// a common edge are stitched without duplicate vertices.
+//
+// The output is a triangle mesh with a "PatchId" cell array.
+//
+// .SECTION See Also
+// vtkBezierSurfaceSource
+
+#ifndef __vtkMultiPatchBezierSurfaceSource_h
+#define __vtkMultiPatchBezierSurfaceSource_h
+
+#include "vtkPolyDataAlgorithm.h"
+#include <map>
+#include <vector>
+
+class vtkMultiPatchBezierSurfaceSource : public vtkPolyDataAlgorithm
+{
+public:
+  vtkTypeMacro(vtkMultiPatchBezierSurfaceSource,vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+  static vtkMultiPatchBezierSurfaceSource *New();
+
+  // Description:
+  // Add a patch with an m x n control net and return its index. The control
+  // points are given row by row (point (i, j) at index i*n + j) as xyz
+  // triplets; weights are optional and default to 1.
+  int AddPatch(int m, int n, const double* controlPoints, const double* weights = 0);
+  void RemoveAllPatches();
+  int GetNumberOfPatches() { return static_cast<int>(this->PatchSizes.size() / 2); }
+
+  // Description:
+  // Access individual control points and weights of a patch.
+  void SetControlPoint(int patch, int i, int j, const double pt[3]);
+  void GetControlPoint(int patch, int i, int j, double pt[3]);
+  void SetWeight(int patch, int i, int j, double w);
+  double GetWeight(int patch, int i, int j);
+
+  // Description:
+  // Number of samples along u and v for every patch.
+  vtkSetVector2Macro(Dimensions,int);
+  vtkGetVectorMacro(Dimensions,int,2);
+
+  // Description:
+  // Turn on/off merging of coincident boundary samples. On by default.
+  vtkSetMacro(MergeBoundaries,int);
+  vtkGetMacro(MergeBoundaries,int);
+  vtkBooleanMacro(MergeBoundaries,int);
+
+  // Description:
+  // Merge tolerance as a fraction of the diagonal of the control point
+  // bounds, as in vtkCleanPolyData.
+  vtkSetClampMacro(Tolerance,double,0.0,1.0);
+  vtkGetMacro(Tolerance,double);
+
+protected:
+  vtkMultiPatchBezierSurfaceSource();
+  ~vtkMultiPatchBezierSurfaceSource() {}
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+
+  const double* GetBasisTable(int order, int samples, int transposed);
+  vtkIdType MergeBoundarySamples(const double* samples, std::vector<vtkIdType>& pointIds,
+                                 std::vector<char>& owner);
+
+  int Dimensions[2];
+  int MergeBoundaries;
+  double Tolerance;
+
+  // Control nets of all patches, structure of arrays. Patch p starts at
+  // PatchOffsets[p] and is PatchSizes[2p] x PatchSizes[2p+1].
+  std::vector<double> X;
+  std::vector<double> Y;
+  std::vector<double> Z;
+  std::vector<double> W;
+  std::vector<int> PatchOffsets;
+  std::vector<int> PatchSizes;
+
+  // Basis tables keyed by (order, samples), shared between all patches of
+  // the same degree. V tables are stored transposed.
+  std::map<std::pair<int, int>, std::vector<double> > BasisTablesU;
+  std::map<std::pair<int, int>, std::vector<double> > BasisTablesV;
+
+private:
+  vtkMultiPatchBezierSurfaceSource(const vtkMultiPatchBezierSurfaceSource&);  // Not implemented.
+  void operator=(const vtkMultiPatchBezierSurfaceSource&);  // Not implemented.
+};
+
+#endif
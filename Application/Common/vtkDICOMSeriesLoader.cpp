@@ -0,0 +1,917 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkDICOMSeriesLoader.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkDICOMSeriesLoader.h"
+
+#include "vtkDataArray.h"
+#include "vtkDirectory.h"
+#include "vtkErrorCode.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkMappedVolumeCache.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkProgressReporter.h"
+#include "vtkSMPTools.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+vtkStandardNewMacro(vtkDICOMSeriesLoader);
+vtkCxxSetObjectMacro(vtkDICOMSeriesLoader, Cache, vtkMappedVolumeCache);
+
+namespace
+{
+const char ImplicitLittleEndian[] = "1.2.840.10008.1.2";
+const char ExplicitLittleEndian[] = "1.2.840.10008.1.2.1";
+const char ExplicitBigEndian[] = "1.2.840.10008.1.2.2";
+
+const unsigned int UndefinedLength = 0xffffffff;
+
+// Sequential access to the start of a file for the header parser. Bytes
+// are read in chunks as the parser needs them, and skipped elements are
+// seeked over, so large elements before the pixel data are not read.
+class HeaderStream
+{
+public:
+  HeaderStream(FILE *file) : File(file), Base(0), Position(0), BigEndian(false) {}
+
+  // The next n bytes, or NULL at the end of the file.
+  const unsigned char *Read(size_t n)
+  {
+    long end = this->Base + static_cast<long>(this->Data.size());
+    if (this->Position < this->Base || this->Position > end)
+      {
+      if (fseek(this->File, this->Position, SEEK_SET) != 0)
+        {
+        return NULL;
+        }
+      this->Data.clear();
+      this->Base = end = this->Position;
+      }
+    size_t available = static_cast<size_t>(end - this->Position);
+    if (available < n)
+      {
+      size_t size = this->Data.size();
+      size_t chunk = std::max(n - available, static_cast<size_t>(16384));
+      this->Data.resize(size + chunk);
+      size_t got = fread(&this->Data[size], 1, chunk, this->File);
+      this->Data.resize(size + got);
+      if (got < n - available)
+        {
+        return NULL;
+        }
+      }
+    const unsigned char *data = &this->Data[this->Position - this->Base];
+    this->Position += static_cast<long>(n);
+    return data;
+  }
+
+  const unsigned char *Peek(size_t n)
+  {
+    const unsigned char *data = this->Read(n);
+    if (data)
+      {
+      this->Position -= static_cast<long>(n);
+      }
+    return data;
+  }
+
+  void Skip(unsigned long n)
+  {
+    this->Position += static_cast<long>(n);
+  }
+
+  unsigned int UInt16(const unsigned char *p) const
+  {
+    return this->BigEndian ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8);
+  }
+
+  unsigned int UInt32(const unsigned char *p) const
+  {
+    return this->BigEndian
+      ? (static_cast<unsigned int>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+      : p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned int>(p[3]) << 24);
+  }
+
+  FILE *File;
+  std::vector<unsigned char> Data;
+  long Base;
+  long Position;
+  bool BigEndian;
+};
+
+struct Element
+{
+  unsigned int Group;
+  unsigned int Number;
+  unsigned int Length;
+};
+
+// Read an element header. Item and delimiter tags (group FFFE) have no VR
+// in either encoding.
+bool ReadElement(HeaderStream &stream, bool explicitVR, Element &element)
+{
+  const unsigned char *p = stream.Read(4);
+  if (!p)
+    {
+    return false;
+    }
+  element.Group = stream.UInt16(p);
+  element.Number = stream.UInt16(p + 2);
+  if (!explicitVR || element.Group == 0xfffe)
+    {
+    p = stream.Read(4);
+    element.Length = p ? stream.UInt32(p) : 0;
+    return p != NULL;
+    }
+  p = stream.Read(2);
+  if (!p)
+    {
+    return false;
+    }
+  static const char *longVRs[] =
+    { "OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV" };
+  bool longVR = false;
+  for (size_t i = 0; i < sizeof(longVRs) / sizeof(longVRs[0]); i++)
+    {
+    longVR = longVR || (p[0] == longVRs[i][0] && p[1] == longVRs[i][1]);
+    }
+  if (longVR)
+    {
+    p = stream.Read(6);
+    element.Length = p ? stream.UInt32(p + 2) : 0;
+    }
+  else
+    {
+    p = stream.Read(2);
+    element.Length = p ? stream.UInt16(p) : 0;
+    }
+  return p != NULL;
+}
+
+// Skip the items of a sequence of undefined length, up to and including
+// the sequence delimiter.
+bool SkipSequence(HeaderStream &stream, bool explicitVR)
+{
+  Element element;
+  while (ReadElement(stream, explicitVR, element))
+    {
+    if (element.Group == 0xfffe && element.Number == 0xe0dd)
+      {
+      return true;
+      }
+    if (element.Length != UndefinedLength)
+      {
+      stream.Skip(element.Length);
+      continue;
+      }
+    // An item of undefined length: its elements up to the item delimiter.
+    while (ReadElement(stream, explicitVR, element) &&
+           !(element.Group == 0xfffe && element.Number == 0xe00d))
+      {
+      if (element.Length == UndefinedLength)
+        {
+        if (!SkipSequence(stream, explicitVR))
+          {
+          return false;
+          }
+        }
+      else
+        {
+        stream.Skip(element.Length);
+        }
+      }
+    }
+  return false;
+}
+
+std::string ReadString(HeaderStream &stream, unsigned int length)
+{
+  const unsigned char *p = length > 0 ? stream.Read(length) : NULL;
+  if (!p)
+    {
+    return std::string();
+    }
+  std::string value(reinterpret_cast<const char*>(p), length);
+  size_t end = value.find_last_not_of(std::string(" \0", 2));
+  return end == std::string::npos ? std::string() : value.substr(0, end + 1);
+}
+
+// Parse a backslash separated DS or IS value. Returns the number of values.
+int ReadNumbers(HeaderStream &stream, unsigned int length, double *values, int maximum)
+{
+  std::string text = ReadString(stream, length);
+  const char *p = text.c_str();
+  int n = 0;
+  while (n < maximum && *p)
+    {
+    char *end;
+    values[n] = strtod(p, &end);
+    if (end == p)
+      {
+      break;
+      }
+    n++;
+    p = strchr(end, '\\');
+    if (!p)
+      {
+      break;
+      }
+    p++;
+    }
+  return n;
+}
+
+unsigned int ReadUInt16(HeaderStream &stream, unsigned int length)
+{
+  const unsigned char *p = length > 0 ? stream.Read(length) : NULL;
+  return p && length >= 2 ? stream.UInt16(p) : 0;
+}
+
+void SwapBytes(char *data, size_t count, int size)
+{
+  for (size_t i = 0; i < count; i++, data += size)
+    {
+    std::reverse(data, data + size);
+    }
+}
+}
+
+//----------------------------------------------------------------------------
+// Parses the headers of a range of files.
+class vtkDICOMSeriesLoaderScan
+{
+public:
+  const std::vector<std::string> *FileNames;
+  std::vector<vtkDICOMSeriesLoader::Slice> *Slices;
+  vtkProgressReporter *Progress;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    if (this->Progress->GetAbort())
+      {
+      return;
+      }
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      vtkDICOMSeriesLoader::ScanFile((*this->FileNames)[i], (*this->Slices)[i]);
+      }
+    this->Progress->Advance(end - begin);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Reads the pixel data of a range of slices into the output.
+class vtkDICOMSeriesLoaderRead
+{
+public:
+  const std::vector<vtkDICOMSeriesLoader::Slice> *Slices;
+  char *Scalars;
+  size_t SliceSize;
+  vtkProgressReporter *Progress;
+  std::atomic<int> *FailedSlice;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end && !this->Progress->GetAbort(); i++)
+      {
+      if (!vtkDICOMSeriesLoader::ReadSlice((*this->Slices)[i],
+                                           this->Scalars + i * this->SliceSize))
+        {
+        int none = -1;
+        this->FailedSlice->compare_exchange_strong(none, static_cast<int>(i));
+        }
+      this->Progress->Advance(1);
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+vtkDICOMSeriesLoader::vtkDICOMSeriesLoader()
+{
+  this->DirectoryName = NULL;
+  this->SeriesInstanceUID = NULL;
+  this->ScanTime = 0.0;
+  this->ReadTime = 0.0;
+  this->Cache = NULL;
+  this->LoadedFromCache = 0;
+  this->Aborted = 0;
+  this->SetNumberOfInputPorts(0);
+}
+
+//----------------------------------------------------------------------------
+vtkDICOMSeriesLoader::~vtkDICOMSeriesLoader()
+{
+  this->SetDirectoryName(NULL);
+  this->SetSeriesInstanceUID(NULL);
+  this->SetCache(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMSeriesLoader::ScanFile(const std::string &fileName, Slice &slice)
+{
+  slice.FileName = fileName;
+  slice.Valid = false;
+  slice.BigEndian = false;
+  slice.HasPosition = false;
+  slice.InstanceNumber = 0;
+  slice.Rows = slice.Columns = 0;
+  slice.BitsAllocated = 0;
+  slice.PixelRepresentation = 0;
+  slice.SamplesPerPixel = 1;
+  slice.PlanarConfiguration = 0;
+  slice.Position[0] = slice.Position[1] = slice.Position[2] = 0.0;
+  const double orientation[6] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 };
+  std::copy(orientation, orientation + 6, slice.Orientation);
+  slice.PixelSpacing[0] = slice.PixelSpacing[1] = 1.0;
+  slice.SliceThickness = 0.0;
+  slice.RescaleSlope = 1.0;
+  slice.RescaleOffset = 0.0;
+  slice.PixelDataOffset = 0;
+  slice.PixelDataLength = 0;
+
+  FILE *file = fopen(fileName.c_str(), "rb");
+  if (!file)
+    {
+    return;
+    }
+  HeaderStream stream(file);
+
+  // A Part 10 file has a 128 byte preamble, "DICM" and the file meta
+  // information, always explicit little endian. Older files start
+  // directly with an implicit little endian data set.
+  bool explicitVR = false;
+  const unsigned char *p = stream.Read(132);
+  if (p && memcmp(p + 128, "DICM", 4) == 0)
+    {
+    Element element;
+    while ((p = stream.Peek(2)) && stream.UInt16(p) == 0x0002 &&
+           ReadElement(stream, true, element))
+      {
+      if (element.Number == 0x0010)
+        {
+        slice.TransferSyntaxUID = ReadString(stream, element.Length);
+        }
+      else
+        {
+        stream.Skip(element.Length);
+        }
+      }
+    // A missing transfer syntax is taken to be the default one.
+    if (slice.TransferSyntaxUID.empty())
+      {
+      slice.TransferSyntaxUID = ImplicitLittleEndian;
+      }
+    if (slice.TransferSyntaxUID == ExplicitLittleEndian)
+      {
+      explicitVR = true;
+      }
+    else if (slice.TransferSyntaxUID == ExplicitBigEndian)
+      {
+      explicitVR = true;
+      slice.BigEndian = stream.BigEndian = true;
+      }
+    else if (slice.TransferSyntaxUID != ImplicitLittleEndian)
+      {
+      fclose(file);
+      return;
+      }
+    }
+  else
+    {
+    stream.Position = 0;
+    p = stream.Peek(2);
+    if (!p || stream.UInt16(p) != 0x0008)
+      {
+      fclose(file);
+      return;
+      }
+    }
+
+  Element element;
+  while (ReadElement(stream, explicitVR, element))
+    {
+    unsigned int tag = (element.Group << 16) | element.Number;
+    if (tag == 0x7fe00010)
+      {
+      // Encapsulated (compressed) pixel data has an undefined length.
+      if (element.Length != UndefinedLength)
+        {
+        slice.PixelDataOffset = stream.Position;
+        slice.PixelDataLength = element.Length;
+        }
+      break;
+      }
+    if (element.Length == UndefinedLength)
+      {
+      if (!SkipSequence(stream, explicitVR))
+        {
+        break;
+        }
+      continue;
+      }
+
+    double values[6];
+    switch (tag)
+      {
+      case 0x0020000e:
+        slice.SeriesInstanceUID = ReadString(stream, element.Length);
+        break;
+      case 0x00200013:
+        if (ReadNumbers(stream, element.Length, values, 1) == 1)
+          {
+          slice.InstanceNumber = static_cast<int>(values[0]);
+          }
+        break;
+      case 0x00200032:
+        slice.HasPosition = ReadNumbers(stream, element.Length, slice.Position, 3) == 3;
+        break;
+      case 0x00200037:
+        if (ReadNumbers(stream, element.Length, values, 6) == 6)
+          {
+          std::copy(values, values + 6, slice.Orientation);
+          }
+        break;
+      case 0x00180050:
+        ReadNumbers(stream, element.Length, &slice.SliceThickness, 1);
+        break;
+      case 0x00280002:
+        slice.SamplesPerPixel = ReadUInt16(stream, element.Length);
+        break;
+      case 0x00280006:
+        slice.PlanarConfiguration = ReadUInt16(stream, element.Length);
+        break;
+      case 0x00280010:
+        slice.Rows = ReadUInt16(stream, element.Length);
+        break;
+      case 0x00280011:
+        slice.Columns = ReadUInt16(stream, element.Length);
+        break;
+      case 0x00280030:
+        ReadNumbers(stream, element.Length, slice.PixelSpacing, 2);
+        break;
+      case 0x00280100:
+        slice.BitsAllocated = ReadUInt16(stream, element.Length);
+        break;
+      case 0x00280103:
+        slice.PixelRepresentation = ReadUInt16(stream, element.Length);
+        break;
+      case 0x00281052:
+        ReadNumbers(stream, element.Length, &slice.RescaleOffset, 1);
+        break;
+      case 0x00281053:
+        ReadNumbers(stream, element.Length, &slice.RescaleSlope, 1);
+        break;
+      default:
+        stream.Skip(element.Length);
+        break;
+      }
+    }
+  fclose(file);
+
+  unsigned long size = static_cast<unsigned long>(slice.Rows) * slice.Columns *
+    slice.SamplesPerPixel * (slice.BitsAllocated / 8);
+  slice.Valid = slice.PixelDataOffset > 0 && size > 0 &&
+    slice.PixelDataLength >= size &&
+    (slice.BitsAllocated == 8 || slice.BitsAllocated == 16 || slice.BitsAllocated == 32) &&
+    (slice.SamplesPerPixel == 1 ||
+     (slice.SamplesPerPixel == 3 && slice.PlanarConfiguration == 0));
+}
+
+//----------------------------------------------------------------------------
+bool vtkDICOMSeriesLoader::ReadSlice(const Slice &slice, char *buffer)
+{
+  FILE *file = fopen(slice.FileName.c_str(), "rb");
+  if (!file)
+    {
+    return false;
+    }
+  int sampleSize = slice.BitsAllocated / 8;
+  size_t rowSize = static_cast<size_t>(slice.Columns) * slice.SamplesPerPixel * sampleSize;
+  size_t size = rowSize * slice.Rows;
+  bool read = fseek(file, slice.PixelDataOffset, SEEK_SET) == 0 &&
+    fread(buffer, 1, size, file) == size;
+  fclose(file);
+  if (!read)
+    {
+    return false;
+    }
+
+  // DICOM stores the top row first, VTK the bottom one.
+  std::vector<char> row(rowSize);
+  for (int top = 0, bottom = slice.Rows - 1; top < bottom; top++, bottom--)
+    {
+    memcpy(&row[0], buffer + top * rowSize, rowSize);
+    memcpy(buffer + top * rowSize, buffer + bottom * rowSize, rowSize);
+    memcpy(buffer + bottom * rowSize, &row[0], rowSize);
+    }
+  if (slice.BigEndian && sampleSize > 1)
+    {
+    SwapBytes(buffer, size / sampleSize, sampleSize);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMSeriesLoader::ComputePipelineMTime(vtkInformation *request,
+                                               vtkInformationVector **inInfoVec,
+                                               vtkInformationVector *outInfoVec,
+                                               int requestFromOutputPort,
+                                               vtkMTimeType *mtime)
+{
+  // The executive stamps the information and the output after the pass
+  // that was cancelled, so a Modified() made during it would be seen as
+  // up to date. The MTime is bumped here instead, before the executive
+  // compares it, so that the update after a cancelled one loads again.
+  if (this->Aborted)
+    {
+    this->Aborted = 0;
+    this->Modified();
+    }
+  return this->Superclass::ComputePipelineMTime(request, inInfoVec, outInfoVec,
+                                                requestFromOutputPort, mtime);
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMSeriesLoader::RequestInformation(vtkInformation *vtkNotUsed(request),
+                                             vtkInformationVector **vtkNotUsed(inputVector),
+                                             vtkInformationVector *outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  double startTime = vtkTimerLog::GetUniversalTime();
+  this->Slices.clear();
+  this->SetErrorCode(vtkErrorCode::NoError);
+  this->AbortExecute = 0;
+  this->CacheKey.clear();
+  this->LoadedFromCache = 0;
+  this->CachedScalars = NULL;
+
+  if (!this->DirectoryName)
+    {
+    vtkErrorMacro(<< "A DirectoryName must be specified.");
+    this->SetErrorCode(vtkErrorCode::NoFileNameError);
+    return 0;
+    }
+  vtkDirectory *directory = vtkDirectory::New();
+  if (!directory->Open(this->DirectoryName))
+    {
+    vtkErrorMacro(<< "Cannot open directory " << this->DirectoryName);
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    directory->Delete();
+    return 0;
+    }
+  std::vector<std::string> fileNames;
+  for (vtkIdType i = 0; i < directory->GetNumberOfFiles(); i++)
+    {
+    const char *name = directory->GetFile(i);
+    if (!directory->FileIsDirectory(name))
+      {
+      fileNames.push_back(std::string(this->DirectoryName) + "/" + name);
+      }
+    }
+  directory->Delete();
+  std::sort(fileNames.begin(), fileNames.end());
+
+  // Files unchanged since a cached load are not parsed again: the cached
+  // volume is mapped, and RequestData() only hands it to the output.
+  if (this->Cache)
+    {
+    this->CacheKey = vtkMappedVolumeCache::ComputeKey(this->SeriesInstanceUID, fileNames);
+    vtkMappedVolumeCache::Metadata metadata;
+    this->CachedScalars = this->Cache->Load(this->CacheKey, metadata);
+    if (this->CachedScalars)
+      {
+      Slice slice = Slice();
+      slice.Valid = true;
+      slice.SeriesInstanceUID = metadata.SeriesInstanceUID;
+      slice.RescaleSlope = metadata.RescaleSlope;
+      slice.RescaleOffset = metadata.RescaleOffset;
+      std::copy(metadata.Position, metadata.Position + 3, slice.Position);
+      std::copy(metadata.Orientation, metadata.Orientation + 6, slice.Orientation);
+      for (size_t i = 0; i < metadata.FileNames.size(); i++)
+        {
+        slice.FileName = metadata.FileNames[i];
+        this->Slices.push_back(slice);
+        }
+      outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), metadata.Extent, 6);
+      outInfo->Set(vtkDataObject::SPACING(), metadata.Spacing, 3);
+      outInfo->Set(vtkDataObject::ORIGIN(), metadata.Origin, 3);
+      vtkDataObject::SetPointDataActiveScalarInfo(outInfo, metadata.ScalarType,
+                                                  metadata.NumberOfComponents);
+      this->LoadedFromCache = 1;
+      this->ScanTime = vtkTimerLog::GetUniversalTime() - startTime;
+      return 1;
+      }
+    }
+
+  // Headers make up the first half of the progress.
+  vtkIdType numberOfFiles = static_cast<vtkIdType>(fileNames.size());
+  std::vector<Slice> slices(fileNames.size());
+  this->SetProgressText("Reading DICOM headers");
+  vtkProgressReporter progress(this, 2 * numberOfFiles);
+  vtkDICOMSeriesLoaderScan scan;
+  scan.FileNames = &fileNames;
+  scan.Slices = &slices;
+  scan.Progress = &progress;
+  vtkSMPTools::For(0, numberOfFiles, 1, scan);
+
+  int extent[6] = { 0, -1, 0, -1, 0, -1 };
+  if (progress.GetAbort())
+    {
+    // Cancelled: produce nothing, and load again on the next update.
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+    this->Aborted = 1;
+    return 1;
+    }
+
+  // Pick the series, and keep its slices that match the first one.
+  std::map<std::string, int> series;
+  int unsupported = 0;
+  for (size_t i = 0; i < slices.size(); i++)
+    {
+    if (slices[i].Valid)
+      {
+      series[slices[i].SeriesInstanceUID]++;
+      }
+    else if (!slices[i].TransferSyntaxUID.empty() &&
+             slices[i].TransferSyntaxUID != ImplicitLittleEndian &&
+             slices[i].TransferSyntaxUID != ExplicitLittleEndian &&
+             slices[i].TransferSyntaxUID != ExplicitBigEndian)
+      {
+      unsupported++;
+      }
+    }
+  std::string uid;
+  if (this->SeriesInstanceUID && *this->SeriesInstanceUID)
+    {
+    uid = this->SeriesInstanceUID;
+    }
+  else
+    {
+    int count = 0;
+    for (std::map<std::string, int>::iterator s = series.begin(); s != series.end(); ++s)
+      {
+      if (s->second > count)
+        {
+        uid = s->first;
+        count = s->second;
+        }
+      }
+    }
+  if (series.find(uid) == series.end())
+    {
+    vtkErrorMacro(<< "No readable DICOM series in " << this->DirectoryName
+                  << (unsupported ? " (compressed transfer syntaxes are not supported)" : ""));
+    this->SetErrorCode(vtkErrorCode::FileFormatError);
+    return 0;
+    }
+  for (size_t i = 0; i < slices.size(); i++)
+    {
+    if (!slices[i].Valid || slices[i].SeriesInstanceUID != uid)
+      {
+      continue;
+      }
+    const Slice &first = this->Slices.empty() ? slices[i] : this->Slices[0];
+    if (slices[i].Rows != first.Rows || slices[i].Columns != first.Columns ||
+        slices[i].BitsAllocated != first.BitsAllocated ||
+        slices[i].PixelRepresentation != first.PixelRepresentation ||
+        slices[i].SamplesPerPixel != first.SamplesPerPixel)
+      {
+      vtkWarningMacro(<< "Skipping " << slices[i].FileName
+                      << ": its image format differs from the rest of the series");
+      continue;
+      }
+    this->Slices.push_back(slices[i]);
+    }
+
+  // Sort along the slice normal when every slice has a position.
+  bool positions = true;
+  for (size_t i = 0; i < this->Slices.size(); i++)
+    {
+    positions = positions && this->Slices[i].HasPosition;
+    }
+  double normal[3];
+  vtkMath::Cross(this->Slices[0].Orientation, this->Slices[0].Orientation + 3, normal);
+  std::vector<std::pair<double, int> > keys(this->Slices.size());
+  for (size_t i = 0; i < this->Slices.size(); i++)
+    {
+    keys[i].first = positions ? vtkMath::Dot(this->Slices[i].Position, normal)
+                              : this->Slices[i].InstanceNumber;
+    keys[i].second = static_cast<int>(i);
+    }
+  std::sort(keys.begin(), keys.end());
+  std::vector<Slice> sorted(this->Slices.size());
+  for (size_t i = 0; i < keys.size(); i++)
+    {
+    sorted[i] = this->Slices[keys[i].second];
+    }
+  this->Slices.swap(sorted);
+
+  const Slice &first = this->Slices[0];
+  int numberOfSlices = static_cast<int>(this->Slices.size());
+  double spacing[3] = { first.PixelSpacing[1], first.PixelSpacing[0], 0.0 };
+  if (positions && numberOfSlices > 1)
+    {
+    spacing[2] = (keys.back().first - keys.front().first) / (numberOfSlices - 1);
+    }
+  if (spacing[2] <= 0.0)
+    {
+    spacing[2] = first.SliceThickness > 0.0 ? first.SliceThickness : 1.0;
+    }
+  int scalarType;
+  switch (first.BitsAllocated)
+    {
+    case 8:
+      scalarType = first.PixelRepresentation ? VTK_SIGNED_CHAR : VTK_UNSIGNED_CHAR;
+      break;
+    case 16:
+      scalarType = first.PixelRepresentation ? VTK_SHORT : VTK_UNSIGNED_SHORT;
+      break;
+    default:
+      scalarType = first.PixelRepresentation ? VTK_INT : VTK_UNSIGNED_INT;
+      break;
+    }
+
+  extent[1] = first.Columns - 1;
+  extent[3] = first.Rows - 1;
+  extent[5] = numberOfSlices - 1;
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+  outInfo->Set(vtkDataObject::ORIGIN(), first.Position, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, scalarType, first.SamplesPerPixel);
+
+  this->ScanTime = vtkTimerLog::GetUniversalTime() - startTime;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMSeriesLoader::RequestData(vtkInformation *vtkNotUsed(request),
+                                      vtkInformationVector **vtkNotUsed(inputVector),
+                                      vtkInformationVector *outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  vtkImageData *output = vtkImageData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  if (this->Slices.empty())
+    {
+    output->Initialize();
+    return 1;
+    }
+  double startTime = vtkTimerLog::GetUniversalTime();
+  this->AbortExecute = 0;
+
+  // The whole series is read whatever the update extent.
+  int extent[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent);
+  output->SetExtent(extent);
+  if (this->LoadedFromCache)
+    {
+    this->CachedScalars->SetName("DICOMImage");
+    output->GetPointData()->SetScalars(this->CachedScalars);
+    this->ReadTime = vtkTimerLog::GetUniversalTime() - startTime;
+    return 1;
+    }
+  output->AllocateScalars(outInfo);
+  vtkDataArray *scalars = output->GetPointData()->GetScalars();
+  scalars->SetName("DICOMImage");
+
+  // Continue the progress where the header scan left it.
+  vtkIdType numberOfSlices = static_cast<vtkIdType>(this->Slices.size());
+  this->SetProgressText("Reading DICOM pixel data");
+  vtkProgressReporter progress(this, 2 * numberOfSlices);
+  progress.Advance(numberOfSlices);
+  std::atomic<int> failedSlice(-1);
+  vtkDICOMSeriesLoaderRead read;
+  read.Slices = &this->Slices;
+  read.Scalars = static_cast<char*>(scalars->GetVoidPointer(0));
+  read.SliceSize = static_cast<size_t>(this->Slices[0].Rows) * this->Slices[0].Columns *
+    this->Slices[0].SamplesPerPixel * (this->Slices[0].BitsAllocated / 8);
+  read.Progress = &progress;
+  read.FailedSlice = &failedSlice;
+  vtkSMPTools::For(0, numberOfSlices, 1, read);
+
+  if (failedSlice >= 0)
+    {
+    vtkErrorMacro(<< "Cannot read the pixel data of "
+                  << this->Slices[failedSlice].FileName);
+    this->SetErrorCode(vtkErrorCode::PrematureEndOfFileError);
+    output->Initialize();
+    return 0;
+    }
+  if (progress.GetAbort())
+    {
+    output->Initialize();
+    this->Aborted = 1;
+    return 1;
+    }
+  progress.Finish();
+  this->ReadTime = vtkTimerLog::GetUniversalTime() - startTime;
+
+  if (this->Cache && !this->CacheKey.empty())
+    {
+    const Slice &first = this->Slices[0];
+    vtkMappedVolumeCache::Metadata metadata;
+    std::copy(extent, extent + 6, metadata.Extent);
+    outInfo->Get(vtkDataObject::SPACING(), metadata.Spacing);
+    outInfo->Get(vtkDataObject::ORIGIN(), metadata.Origin);
+    metadata.ScalarType = scalars->GetDataType();
+    metadata.NumberOfComponents = scalars->GetNumberOfComponents();
+    metadata.SeriesInstanceUID = first.SeriesInstanceUID;
+    metadata.RescaleSlope = first.RescaleSlope;
+    metadata.RescaleOffset = first.RescaleOffset;
+    std::copy(first.Position, first.Position + 3, metadata.Position);
+    std::copy(first.Orientation, first.Orientation + 6, metadata.Orientation);
+    for (size_t i = 0; i < this->Slices.size(); i++)
+      {
+      metadata.FileNames.push_back(this->Slices[i].FileName);
+      }
+    this->Cache->Store(this->CacheKey, output, metadata);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkDICOMSeriesLoader::GetNumberOfSlices()
+{
+  return static_cast<int>(this->Slices.size());
+}
+
+//----------------------------------------------------------------------------
+const char *vtkDICOMSeriesLoader::GetFileName(int slice)
+{
+  if (slice < 0 || slice >= this->GetNumberOfSlices())
+    {
+    return NULL;
+    }
+  return this->Slices[slice].FileName.c_str();
+}
+
+//----------------------------------------------------------------------------
+const char *vtkDICOMSeriesLoader::GetLoadedSeriesInstanceUID()
+{
+  return this->Slices.empty() ? NULL : this->Slices[0].SeriesInstanceUID.c_str();
+}
+
+//----------------------------------------------------------------------------
+double vtkDICOMSeriesLoader::GetRescaleSlope()
+{
+  return this->Slices.empty() ? 1.0 : this->Slices[0].RescaleSlope;
+}
+
+//----------------------------------------------------------------------------
+double vtkDICOMSeriesLoader::GetRescaleOffset()
+{
+  return this->Slices.empty() ? 0.0 : this->Slices[0].RescaleOffset;
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMSeriesLoader::GetImagePositionPatient(double position[3])
+{
+  for (int a = 0; a < 3; a++)
+    {
+    position[a] = this->Slices.empty() ? 0.0 : this->Slices[0].Position[a];
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMSeriesLoader::GetImageOrientationPatient(double orientation[6])
+{
+  const double identity[6] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 };
+  const double *source = this->Slices.empty() ? identity : this->Slices[0].Orientation;
+  std::copy(source, source + 6, orientation);
+}
+
+//----------------------------------------------------------------------------
+void vtkDICOMSeriesLoader::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Directory Name: "
+     << (this->DirectoryName ? this->DirectoryName : "(none)") << "\n";
+  os << indent << "Series Instance UID: "
+     << (this->SeriesInstanceUID ? this->SeriesInstanceUID : "(none)") << "\n";
+  os << indent << "Number Of Slices: " << this->Slices.size() << "\n";
+  os << indent << "Scan Time: " << this->ScanTime << "\n";
+  os << indent << "Read Time: " << this->ReadTime << "\n";
+  os << indent << "Cache: " << this->Cache << "\n";
+  os << indent << "Loaded From Cache: " << this->LoadedFromCache << "\n";
+}
@@ -0,0 +1,178 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkDICOMSeriesLoader.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkDICOMSeriesLoader - read a DICOM series with parallel parsing and decoding
+// .SECTION Description
+// vtkDICOMSeriesLoader reads the slices of a DICOM series in a directory
+// into one vtkImageData, as vtkDICOMImageReader::SetDirectoryName() does,
+// but using all cores:
+//
+// 1. RequestInformation() parses the headers of all files in parallel.
+//    Parsing stops at the pixel data element, whose file offset is kept, so
+//    only the first few KiB of each file are read.
+// 2. The series with the most slices is kept (or the one named by
+//    SeriesInstanceUID), and its slices are sorted by their position along
+//    the slice normal, falling back to the instance number.
+// 3. RequestData() allocates the output once, and the slices are read in
+//    parallel straight into their place in it.
+//
+// The output matches vtkDICOMImageReader: the stored pixel values (the
+// rescale is reported by GetRescaleSlope() and GetRescaleOffset(), not
+// applied), rows flipped so that the first row is at the bottom, the
+// origin at the position of the first slice, and the orientation of the
+// slices not applied to the geometry. Uncompressed little endian (implicit
+// or explicit VR) and explicit big endian transfer syntaxes are supported,
+// with 8, 16 or 32 bit samples and one or three interleaved components.
+//
+// Progress is reported through ProgressEvent, on the thread that called
+// Update(), so an observer may process GUI events; headers count for the
+// first half. Setting AbortExecute from an observer cancels the load and
+// leaves the output empty. A cancelled load is not taken as up to date:
+// the next Update() loads the series again, even if nothing was changed.
+//
+// With a vtkMappedVolumeCache set, a decoded series is stored in the cache
+// and opening the same unchanged files again maps the stored volume
+// instead of parsing and decoding them: only the directory is listed.
+//
+// .SECTION See Also
+// vtkDICOMImageReader vtkMappedVolumeCache
+
+#ifndef __vtkDICOMSeriesLoader_h
+#define __vtkDICOMSeriesLoader_h
+
+#include "vtkImageAlgorithm.h"
+#include "vtkSmartPointer.h"
+
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkMappedVolumeCache;
+
+class vtkDICOMSeriesLoader : public vtkImageAlgorithm
+{
+public:
+  static vtkDICOMSeriesLoader *New();
+  vtkTypeMacro(vtkDICOMSeriesLoader, vtkImageAlgorithm);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // The directory holding the series. Subdirectories are not searched.
+  vtkSetStringMacro(DirectoryName);
+  vtkGetStringMacro(DirectoryName);
+
+  // Description:
+  // The series to read when the directory holds more than one. If NULL or
+  // empty (the default), the series with the most slices is read.
+  vtkSetStringMacro(SeriesInstanceUID);
+  vtkGetStringMacro(SeriesInstanceUID);
+
+  // Description:
+  // The cache of decoded volumes to use, if any. Default is NULL.
+  virtual void SetCache(vtkMappedVolumeCache *cache);
+  vtkGetObjectMacro(Cache, vtkMappedVolumeCache);
+
+  // Description:
+  // Whether the last load was mapped from the cache.
+  vtkGetMacro(LoadedFromCache, int);
+
+  // Description:
+  // Information about the series, valid after UpdateInformation().
+  int GetNumberOfSlices();
+  const char *GetFileName(int slice);
+  const char *GetLoadedSeriesInstanceUID();
+  double GetRescaleSlope();
+  double GetRescaleOffset();
+  void GetImagePositionPatient(double position[3]);
+  void GetImageOrientationPatient(double orientation[6]);
+
+  // Description:
+  // Seconds taken by the last header scan and the last pixel read.
+  vtkGetMacro(ScanTime, double);
+  vtkGetMacro(ReadTime, double);
+
+protected:
+  vtkDICOMSeriesLoader();
+  ~vtkDICOMSeriesLoader();
+
+  // Forces re-execution after a cancelled load.
+  int ComputePipelineMTime(vtkInformation *request,
+                           vtkInformationVector **inInfoVec,
+                           vtkInformationVector *outInfoVec,
+                           int requestFromOutputPort,
+                           vtkMTimeType *mtime);
+
+  int RequestInformation(vtkInformation *request,
+                         vtkInformationVector **inputVector,
+                         vtkInformationVector *outputVector);
+  int RequestData(vtkInformation *request,
+                  vtkInformationVector **inputVector,
+                  vtkInformationVector *outputVector);
+
+  // What the header scan keeps of each file.
+  struct Slice
+  {
+    std::string FileName;
+    std::string SeriesInstanceUID;
+    std::string TransferSyntaxUID;
+    bool Valid;
+    bool BigEndian;
+    bool HasPosition;
+    int InstanceNumber;
+    int Rows;
+    int Columns;
+    int BitsAllocated;
+    int PixelRepresentation;
+    int SamplesPerPixel;
+    int PlanarConfiguration;
+    double Position[3];
+    double Orientation[6];
+    double PixelSpacing[2];
+    double SliceThickness;
+    double RescaleSlope;
+    double RescaleOffset;
+    long PixelDataOffset;
+    unsigned long PixelDataLength;
+  };
+
+  // Parse the header of a file; Valid is false if it is not a readable
+  // DICOM image.
+  static void ScanFile(const std::string &fileName, Slice &slice);
+  // Read the pixel data of slice into buffer, rows flipped. Returns false
+  // on a read error.
+  static bool ReadSlice(const Slice &slice, char *buffer);
+
+  char *DirectoryName;
+  char *SeriesInstanceUID;
+  std::vector<Slice> Slices;
+  double ScanTime;
+  double ReadTime;
+
+  vtkMappedVolumeCache *Cache;
+  std::string CacheKey;
+  int LoadedFromCache;
+  // Set when a load is cancelled, until the next pipeline update.
+  int Aborted;
+  vtkSmartPointer<vtkDataArray> CachedScalars;
+
+  // The vtkSMPTools functors of the two passes.
+  friend class vtkDICOMSeriesLoaderScan;
+  friend class vtkDICOMSeriesLoaderRead;
+
+private:
+  vtkDICOMSeriesLoader(const vtkDICOMSeriesLoader&);  // Not implemented.
+  void operator=(const vtkDICOMSeriesLoader&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,448 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImplicitTCoordsArray.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkImplicitTCoordsArray.h"
+
+#include "vtkDataSet.h"
+#include "vtkIdList.h"
+#include "vtkObjectFactory.h"
+#include "vtkVariant.h"
+#include "vtkVariantCast.h"
+
+vtkStandardNewMacro(vtkImplicitTCoordsArray);
+
+//----------------------------------------------------------------------------
+vtkImplicitTCoordsArray::vtkImplicitTCoordsArray()
+{
+  this->Geometry = NULL;
+  this->Function = NULL;
+  this->TempDoubleTuple[0] = this->TempDoubleTuple[1] = 0.0;
+  this->TempValue = 0.0f;
+  this->NumberOfComponents = 2;
+}
+
+//----------------------------------------------------------------------------
+vtkImplicitTCoordsArray::~vtkImplicitTCoordsArray()
+{
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Geometry: " << this->Geometry << "\n";
+  os << indent << "Function: " << this->Function << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetGeometry(vtkDataSet *geometry,
+                                          vtkTCoordsFunction *function)
+{
+  this->Initialize();
+  if (!geometry || !function)
+    {
+    delete function;
+    return;
+    }
+
+  // Only the points are needed, but a structure copy shares them (and the
+  // cells) by reference, so it costs no per-point memory.
+  this->Geometry = geometry->NewInstance();
+  this->Geometry->CopyStructure(geometry);
+  this->Function = function;
+
+  this->Size = this->NumberOfComponents * geometry->GetNumberOfPoints();
+  this->MaxId = this->Size - 1;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::Initialize()
+{
+  if (this->Geometry)
+    {
+    this->Geometry->Delete();
+    this->Geometry = NULL;
+    }
+  delete this->Function;
+  this->Function = NULL;
+
+  this->MaxId = -1;
+  this->Size = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::GetTuples(vtkIdList *ptIds,
+                                        vtkAbstractArray *output)
+{
+  vtkDataArray *outArray = vtkDataArray::SafeDownCast(output);
+  if (!outArray)
+    {
+    vtkWarningMacro(<<"Input is not a vtkDataArray");
+    return;
+    }
+
+  vtkIdType numTuples = ptIds->GetNumberOfIds();
+  outArray->SetNumberOfComponents(this->NumberOfComponents);
+  outArray->SetNumberOfTuples(numTuples);
+
+  double tuple[2];
+  for (vtkIdType i = 0; i < numTuples; ++i)
+    {
+    this->GetTuple(ptIds->GetId(i), tuple);
+    outArray->SetTuple(i, tuple);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::GetTuples(vtkIdType p1, vtkIdType p2,
+                                        vtkAbstractArray *output)
+{
+  vtkDataArray *outArray = vtkDataArray::SafeDownCast(output);
+  if (!outArray)
+    {
+    vtkWarningMacro(<<"Input is not a vtkDataArray");
+    return;
+    }
+
+  vtkIdType numTuples = p2 - p1 + 1;
+  outArray->SetNumberOfComponents(this->NumberOfComponents);
+  outArray->SetNumberOfTuples(numTuples);
+
+  double tuple[2];
+  for (vtkIdType i = 0; i < numTuples; ++i)
+    {
+    this->GetTuple(p1 + i, tuple);
+    outArray->SetTuple(i, tuple);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::Squeeze()
+{
+  // noop
+}
+
+//----------------------------------------------------------------------------
+vtkArrayIterator *vtkImplicitTCoordsArray::NewIterator()
+{
+  vtkErrorMacro(<<"Not implemented.");
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::LookupValue(vtkVariant value)
+{
+  bool valid = true;
+  float val = vtkVariantCast<float>(value, &valid);
+  if (valid)
+    {
+    return this->Lookup(val, 0);
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::LookupValue(vtkVariant value, vtkIdList *ids)
+{
+  bool valid = true;
+  float val = vtkVariantCast<float>(value, &valid);
+  ids->Reset();
+  if (valid)
+    {
+    vtkIdType index = 0;
+    while ((index = this->Lookup(val, index)) >= 0)
+      {
+      ids->InsertNextId(index);
+      ++index;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkVariant vtkImplicitTCoordsArray::GetVariantValue(vtkIdType idx)
+{
+  return vtkVariant(this->GetValue(idx));
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::ClearLookup()
+{
+  // no-op, no fast lookup implemented.
+}
+
+//----------------------------------------------------------------------------
+double *vtkImplicitTCoordsArray::GetTuple(vtkIdType i)
+{
+  this->GetTuple(i, this->TempDoubleTuple);
+  return this->TempDoubleTuple;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::GetTuple(vtkIdType i, double *tuple)
+{
+  float tc[2];
+  this->GetTypedTuple(i, tc);
+  tuple[0] = tc[0];
+  tuple[1] = tc[1];
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::LookupTypedValue(float value)
+{
+  return this->Lookup(value, 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::LookupTypedValue(float value, vtkIdList *ids)
+{
+  ids->Reset();
+  vtkIdType index = 0;
+  while ((index = this->Lookup(value, index)) >= 0)
+    {
+    ids->InsertNextId(index);
+    ++index;
+    }
+}
+
+//----------------------------------------------------------------------------
+float vtkImplicitTCoordsArray::GetValue(vtkIdType idx) const
+{
+  float tc[2];
+  this->GetTypedTuple(idx / 2, tc);
+  return tc[idx % 2];
+}
+
+//----------------------------------------------------------------------------
+float &vtkImplicitTCoordsArray::GetValueReference(vtkIdType idx)
+{
+  this->TempValue = this->GetValue(idx);
+  return this->TempValue;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::GetTypedTuple(vtkIdType idx, float *t) const
+{
+  double x[3];
+  this->Geometry->GetPoint(idx, x);
+  this->Function->Evaluate(x, t);
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImplicitTCoordsArray::GetActualMemorySize()
+{
+  // The coordinates are never stored; the geometry is shared with the
+  // dataset the array belongs to.
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImplicitTCoordsArray::Allocate(vtkIdType, vtkIdType)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkImplicitTCoordsArray::Resize(vtkIdType)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetNumberOfTuples(vtkIdType)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetTuple(vtkIdType, vtkIdType, vtkAbstractArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetTuple(vtkIdType, const float *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetTuple(vtkIdType, const double *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertTuple(vtkIdType, vtkIdType, vtkAbstractArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertTuple(vtkIdType, const float *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertTuple(vtkIdType, const double *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertTuples(vtkIdList *, vtkIdList *,
+                                           vtkAbstractArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertTuples(vtkIdType, vtkIdType, vtkIdType,
+                                           vtkAbstractArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::InsertNextTuple(vtkIdType, vtkAbstractArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::InsertNextTuple(const float *)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::InsertNextTuple(const double *)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::DeepCopy(vtkAbstractArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::DeepCopy(vtkDataArray *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InterpolateTuple(vtkIdType, vtkIdList *,
+                                               vtkAbstractArray *, double *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InterpolateTuple(vtkIdType, vtkIdType,
+                                               vtkAbstractArray *, vtkIdType,
+                                               vtkAbstractArray *, double)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetVariantValue(vtkIdType, vtkVariant)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertVariantValue(vtkIdType, vtkVariant)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::RemoveTuple(vtkIdType)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::RemoveFirstTuple()
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::RemoveLastTuple()
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetTypedTuple(vtkIdType, const float *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertTypedTuple(vtkIdType, const float *)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::InsertNextTypedTuple(const float *)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::SetValue(vtkIdType, float)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::InsertNextValue(float)
+{
+  vtkErrorMacro(<<"Read only container.");
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImplicitTCoordsArray::InsertValue(vtkIdType, float)
+{
+  vtkErrorMacro(<<"Read only container.");
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImplicitTCoordsArray::Lookup(float value, vtkIdType index)
+{
+  for (vtkIdType numValues = this->MaxId + 1; index < numValues; ++index)
+    {
+    if (this->GetValue(index) == value)
+      {
+      return index;
+      }
+    }
+  return -1;
+}
@@ -0,0 +1,135 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkImplicitTCoordsArray.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkImplicitTCoordsArray - texture coordinates computed on access
+// .SECTION Description
+// vtkImplicitTCoordsArray is a read-only, 2-component float array whose
+// tuples are never stored. Each access looks up the point position in the
+// geometry it was given and maps it through a vtkTCoordsFunction, so a
+// projection mapper can attach texture coordinates to a huge mesh without
+// doubling its per-point memory.
+//
+// The array behaves like any other vtkDataArray for reading. NewInstance()
+// returns a plain vtkFloatArray, so filters that copy or interpolate point
+// data downstream materialize the coordinates they keep. GetTuple(i) and
+// GetValueReference() return pointers to per-array scratch storage and,
+// as for every VTK array, must not be used from several threads at once;
+// GetTypedTuple() and GetTuple(i, tuple) are safe to call concurrently.
+//
+// .SECTION See Also
+// vtkTextureMapToSurface vtkTextureMapToIrregularity
+
+#ifndef __vtkImplicitTCoordsArray_h
+#define __vtkImplicitTCoordsArray_h
+
+#include "vtkMappedDataArray.h"
+
+class vtkDataSet;
+
+// Maps a point position to its (s, t) texture coordinate pair.
+class vtkTCoordsFunction
+{
+public:
+  virtual ~vtkTCoordsFunction() {}
+  virtual void Evaluate(const double x[3], float tc[2]) const = 0;
+};
+
+class vtkImplicitTCoordsArray : public vtkMappedDataArray<float>
+{
+public:
+  vtkMappedDataArrayTypeMacro(vtkImplicitTCoordsArray, vtkMappedDataArray<float>);
+  static vtkImplicitTCoordsArray *New();
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set the geometry whose points are mapped and the mapping itself. The
+  // array keeps a shallow structure copy of the geometry and takes ownership
+  // of the function. The number of tuples follows the number of points.
+  void SetGeometry(vtkDataSet *geometry, vtkTCoordsFunction *function);
+
+  // Reimplemented virtuals -- see superclasses for descriptions:
+  void Initialize();
+  void GetTuples(vtkIdList *ptIds, vtkAbstractArray *output);
+  void GetTuples(vtkIdType p1, vtkIdType p2, vtkAbstractArray *output);
+  void Squeeze();
+  vtkArrayIterator *NewIterator();
+  vtkIdType LookupValue(vtkVariant value);
+  void LookupValue(vtkVariant value, vtkIdList *ids);
+  vtkVariant GetVariantValue(vtkIdType idx);
+  void ClearLookup();
+  double *GetTuple(vtkIdType i);
+  void GetTuple(vtkIdType i, double *tuple);
+  vtkIdType LookupTypedValue(float value);
+  void LookupTypedValue(float value, vtkIdList *ids);
+  float GetValue(vtkIdType idx) const;
+  float &GetValueReference(vtkIdType idx);
+  void GetTypedTuple(vtkIdType idx, float *t) const;
+  unsigned long GetActualMemorySize();
+
+  // Description:
+  // This container is read only -- these methods do nothing but print an
+  // error.
+  int Allocate(vtkIdType sz, vtkIdType ext);
+  int Resize(vtkIdType numTuples);
+  void SetNumberOfTuples(vtkIdType number);
+  void SetTuple(vtkIdType i, vtkIdType j, vtkAbstractArray *source);
+  void SetTuple(vtkIdType i, const float *source);
+  void SetTuple(vtkIdType i, const double *source);
+  void InsertTuple(vtkIdType i, vtkIdType j, vtkAbstractArray *source);
+  void InsertTuple(vtkIdType i, const float *source);
+  void InsertTuple(vtkIdType i, const double *source);
+  void InsertTuples(vtkIdList *dstIds, vtkIdList *srcIds,
+                    vtkAbstractArray *source);
+  void InsertTuples(vtkIdType dstStart, vtkIdType n, vtkIdType srcStart,
+                    vtkAbstractArray *source);
+  vtkIdType InsertNextTuple(vtkIdType j, vtkAbstractArray *source);
+  vtkIdType InsertNextTuple(const float *source);
+  vtkIdType InsertNextTuple(const double *source);
+  void DeepCopy(vtkAbstractArray *aa);
+  void DeepCopy(vtkDataArray *da);
+  void InterpolateTuple(vtkIdType i, vtkIdList *ptIndices,
+                        vtkAbstractArray *source, double *weights);
+  void InterpolateTuple(vtkIdType i, vtkIdType id1,
+                        vtkAbstractArray *source1, vtkIdType id2,
+                        vtkAbstractArray *source2, double t);
+  void SetVariantValue(vtkIdType idx, vtkVariant value);
+  void InsertVariantValue(vtkIdType idx, vtkVariant value);
+  void RemoveTuple(vtkIdType id);
+  void RemoveFirstTuple();
+  void RemoveLastTuple();
+  void SetTypedTuple(vtkIdType i, const float *t);
+  void InsertTypedTuple(vtkIdType i, const float *t);
+  vtkIdType InsertNextTypedTuple(const float *t);
+  void SetValue(vtkIdType idx, float value);
+  vtkIdType InsertNextValue(float v);
+  void InsertValue(vtkIdType idx, float v);
+
+protected:
+  vtkImplicitTCoordsArray();
+  ~vtkImplicitTCoordsArray();
+
+  vtkDataSet *Geometry;
+  vtkTCoordsFunction *Function;
+
+private:
+  vtkImplicitTCoordsArray(const vtkImplicitTCoordsArray&);  // Not implemented.
+  void operator=(const vtkImplicitTCoordsArray&);  // Not implemented.
+
+  vtkIdType Lookup(float value, vtkIdType startIndex);
+
+  double TempDoubleTuple[2];
+  float TempValue;
+};
+
+#endif
@@ -0,0 +1,437 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMappedVolumeCache.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkMappedVolumeCache.h"
+
+#include "vtkDataArray.h"
+#include "vtkDirectory.h"
+#include "vtkImageData.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkTimerLog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/utime.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+vtkStandardNewMacro(vtkMappedVolumeCache);
+
+namespace
+{
+const char Magic[8] = { 'V', 'T', 'K', 'V', 'O', 'L', 'C', '\0' };
+const vtkTypeUInt32 Version = 1;
+const vtkTypeUInt32 ByteOrderMark = 0x01020304;
+const char Extension[] = ".vtkvol";
+
+// The voxels start one page into the file, so they are page aligned in
+// the mapping.
+const size_t HeaderSize = 4096;
+
+struct Header
+{
+  char Magic[8];
+  vtkTypeUInt32 Version;
+  vtkTypeUInt32 ByteOrder;
+  vtkTypeUInt64 FileSize;
+  vtkTypeUInt64 DataOffset;
+  vtkTypeUInt64 DataSize;
+  vtkTypeUInt64 NamesOffset;
+  vtkTypeUInt64 NamesSize;
+  vtkTypeInt32 NumberOfNames;
+  vtkTypeInt32 ScalarType;
+  vtkTypeInt32 NumberOfComponents;
+  vtkTypeInt32 Extent[6];
+  vtkTypeInt32 Reserved;
+  double Spacing[3];
+  double Origin[3];
+  double RescaleSlope;
+  double RescaleOffset;
+  double Position[3];
+  double Orientation[6];
+  char Key[32];
+  char SeriesInstanceUID[72];
+};
+static_assert(sizeof(Header) <= HeaderSize, "the header must fit before the voxels");
+
+bool GetFileInfo(const std::string &fileName, vtkTypeUInt64 &size, vtkTypeInt64 &time)
+{
+#ifdef _WIN32
+  struct _stat64 info;
+  if (_stat64(fileName.c_str(), &info) != 0)
+    {
+    return false;
+    }
+#else
+  struct stat info;
+  if (stat(fileName.c_str(), &info) != 0)
+    {
+    return false;
+    }
+#endif
+  size = static_cast<vtkTypeUInt64>(info.st_size);
+  time = static_cast<vtkTypeInt64>(info.st_mtime);
+  return true;
+}
+
+// 64 bit FNV-1a.
+void Hash(vtkTypeUInt64 &hash, const void *data, size_t size)
+{
+  const unsigned char *bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++)
+    {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+}
+
+// Map a whole file copy-on-write. Returns NULL on failure.
+char *MapFile(const std::string &fileName, vtkTypeUInt64 &size)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    {
+    return NULL;
+    }
+  LARGE_INTEGER fileSize;
+  char *data = NULL;
+  if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= static_cast<LONGLONG>(HeaderSize))
+    {
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping)
+      {
+      data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+      CloseHandle(mapping);
+      }
+    size = static_cast<vtkTypeUInt64>(fileSize.QuadPart);
+    }
+  CloseHandle(file);
+  return data;
+#else
+  int file = open(fileName.c_str(), O_RDONLY);
+  if (file < 0)
+    {
+    return NULL;
+    }
+  struct stat info;
+  char *data = NULL;
+  if (fstat(file, &info) == 0 && info.st_size >= static_cast<off_t>(HeaderSize))
+    {
+    void *mapping = mmap(NULL, static_cast<size_t>(info.st_size),
+                         PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    if (mapping != MAP_FAILED)
+      {
+      data = static_cast<char*>(mapping);
+      size = static_cast<vtkTypeUInt64>(info.st_size);
+      }
+    }
+  close(file);
+  return data;
+#endif
+}
+
+void UnmapFile(char *data)
+{
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+#else
+  munmap(data, static_cast<size_t>(reinterpret_cast<Header*>(data)->FileSize));
+#endif
+}
+
+// The free function of a mapped array, which points at the voxels.
+void UnmapVoxels(void *voxels)
+{
+  UnmapFile(static_cast<char*>(voxels) - HeaderSize);
+}
+
+bool IsValid(const Header &header, const std::string &key, vtkTypeUInt64 fileSize)
+{
+  if (memcmp(header.Magic, Magic, sizeof(Magic)) != 0 ||
+      header.Version != Version || header.ByteOrder != ByteOrderMark ||
+      header.FileSize != fileSize || header.DataOffset != HeaderSize ||
+      strncmp(header.Key, key.c_str(), sizeof(header.Key)) != 0 ||
+      header.NumberOfComponents < 1)
+    {
+    return false;
+    }
+  if (header.ScalarType < VTK_CHAR || header.ScalarType > VTK_DOUBLE)
+    {
+    return false;
+    }
+  vtkTypeUInt64 voxels = 1;
+  for (int a = 0; a < 3; a++)
+    {
+    if (header.Extent[2 * a + 1] < header.Extent[2 * a])
+      {
+      return false;
+      }
+    voxels *= header.Extent[2 * a + 1] - header.Extent[2 * a] + 1;
+    }
+  return header.DataSize == voxels * header.NumberOfComponents *
+           vtkAbstractArray::GetDataTypeSize(header.ScalarType) &&
+         header.NamesOffset == header.DataOffset + header.DataSize &&
+         header.NamesOffset + header.NamesSize == header.FileSize;
+}
+}
+
+//----------------------------------------------------------------------------
+vtkMappedVolumeCache::vtkMappedVolumeCache()
+{
+  this->Directory = NULL;
+  this->MaximumSize = 8192;
+}
+
+//----------------------------------------------------------------------------
+vtkMappedVolumeCache::~vtkMappedVolumeCache()
+{
+  this->SetDirectory(NULL);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkMappedVolumeCache::ComputeKey(const char *seriesInstanceUID,
+                                             const std::vector<std::string> &fileNames)
+{
+  vtkTypeUInt64 hash = 0xcbf29ce484222325ULL;
+  std::string uid = seriesInstanceUID ? seriesInstanceUID : "";
+  Hash(hash, uid.c_str(), uid.size() + 1);
+  for (size_t i = 0; i < fileNames.size(); i++)
+    {
+    vtkTypeUInt64 size = 0;
+    vtkTypeInt64 time = 0;
+    GetFileInfo(fileNames[i], size, time);
+    Hash(hash, fileNames[i].c_str(), fileNames[i].size() + 1);
+    Hash(hash, &size, sizeof(size));
+    Hash(hash, &time, sizeof(time));
+    }
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+  return key;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkMappedVolumeCache::GetFileName(const std::string &key)
+{
+  return std::string(this->Directory) + "/" + key + Extension;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray> vtkMappedVolumeCache::Load(const std::string &key,
+                                                         Metadata &metadata)
+{
+  if (!this->Directory)
+    {
+    return NULL;
+    }
+  std::string fileName = this->GetFileName(key);
+  vtkTypeUInt64 fileSize = 0;
+  char *data = MapFile(fileName, fileSize);
+  if (!data)
+    {
+    return NULL;
+    }
+  const Header &header = *reinterpret_cast<const Header*>(data);
+  if (!IsValid(header, key, fileSize))
+    {
+    vtkDebugMacro(<< "Dropping invalid cache file " << fileName);
+    UnmapFile(data);
+    remove(fileName.c_str());
+    return NULL;
+    }
+
+  std::copy(header.Extent, header.Extent + 6, metadata.Extent);
+  std::copy(header.Spacing, header.Spacing + 3, metadata.Spacing);
+  std::copy(header.Origin, header.Origin + 3, metadata.Origin);
+  metadata.ScalarType = header.ScalarType;
+  metadata.NumberOfComponents = header.NumberOfComponents;
+  metadata.SeriesInstanceUID.assign(header.SeriesInstanceUID,
+    strnlen(header.SeriesInstanceUID, sizeof(header.SeriesInstanceUID)));
+  metadata.RescaleSlope = header.RescaleSlope;
+  metadata.RescaleOffset = header.RescaleOffset;
+  std::copy(header.Position, header.Position + 3, metadata.Position);
+  std::copy(header.Orientation, header.Orientation + 6, metadata.Orientation);
+  metadata.FileNames.clear();
+  const char *name = data + header.NamesOffset;
+  const char *end = name + header.NamesSize;
+  while (name < end && static_cast<int>(metadata.FileNames.size()) < header.NumberOfNames)
+    {
+    size_t length = strnlen(name, end - name);
+    metadata.FileNames.push_back(std::string(name, length));
+    name += length + 1;
+    }
+
+  vtkSmartPointer<vtkDataArray> scalars;
+  scalars.TakeReference(vtkDataArray::CreateDataArray(header.ScalarType));
+  scalars->SetNumberOfComponents(header.NumberOfComponents);
+  scalars->SetVoidArray(data + header.DataOffset,
+                        static_cast<vtkIdType>(header.DataSize /
+                          vtkAbstractArray::GetDataTypeSize(header.ScalarType)),
+                        0, vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+  scalars->SetArrayFreeFunction(UnmapVoxels);
+
+  // The modification time orders the files for eviction.
+  utime(fileName.c_str(), NULL);
+  return scalars;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMappedVolumeCache::Store(const std::string &key, vtkImageData *image,
+                                 const Metadata &metadata)
+{
+  vtkDataArray *scalars = image ? image->GetPointData()->GetScalars() : NULL;
+  if (!this->Directory || !scalars || key.size() >= sizeof(Header().Key) ||
+      metadata.SeriesInstanceUID.size() >= sizeof(Header().SeriesInstanceUID))
+    {
+    return false;
+    }
+  vtkDirectory::MakeDirectory(this->Directory);
+
+  std::string names;
+  for (size_t i = 0; i < metadata.FileNames.size(); i++)
+    {
+    names.append(metadata.FileNames[i].c_str(), metadata.FileNames[i].size() + 1);
+    }
+  std::vector<char> buffer(HeaderSize, 0);
+  Header &header = *reinterpret_cast<Header*>(&buffer[0]);
+  memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.ByteOrder = ByteOrderMark;
+  header.DataOffset = HeaderSize;
+  header.DataSize = static_cast<vtkTypeUInt64>(scalars->GetNumberOfValues()) *
+                    scalars->GetDataTypeSize();
+  header.NamesOffset = header.DataOffset + header.DataSize;
+  header.NamesSize = names.size();
+  header.FileSize = header.NamesOffset + header.NamesSize;
+  header.NumberOfNames = static_cast<vtkTypeInt32>(metadata.FileNames.size());
+  header.ScalarType = scalars->GetDataType();
+  header.NumberOfComponents = scalars->GetNumberOfComponents();
+  std::copy(metadata.Extent, metadata.Extent + 6, header.Extent);
+  std::copy(metadata.Spacing, metadata.Spacing + 3, header.Spacing);
+  std::copy(metadata.Origin, metadata.Origin + 3, header.Origin);
+  header.RescaleSlope = metadata.RescaleSlope;
+  header.RescaleOffset = metadata.RescaleOffset;
+  std::copy(metadata.Position, metadata.Position + 3, header.Position);
+  std::copy(metadata.Orientation, metadata.Orientation + 6, header.Orientation);
+  memcpy(header.Key, key.c_str(), key.size());
+  memcpy(header.SeriesInstanceUID, metadata.SeriesInstanceUID.c_str(),
+         metadata.SeriesInstanceUID.size());
+  if (!IsValid(header, key, header.FileSize))
+    {
+    vtkWarningMacro(<< "Not caching a volume whose metadata does not match its scalars");
+    return false;
+    }
+
+  // Written under a temporary name and renamed, so that a reader never
+  // sees a partial file.
+  std::string fileName = this->GetFileName(key);
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".%p.%.0f", static_cast<void*>(this),
+           vtkTimerLog::GetUniversalTime() * 1e6);
+  std::string temporaryName = fileName + suffix;
+  FILE *file = fopen(temporaryName.c_str(), "wb");
+  if (!file)
+    {
+    vtkWarningMacro(<< "Cannot create cache file " << temporaryName);
+    return false;
+    }
+  bool written =
+    fwrite(&buffer[0], 1, HeaderSize, file) == HeaderSize &&
+    fwrite(scalars->GetVoidPointer(0), 1, header.DataSize, file) == header.DataSize &&
+    fwrite(names.data(), 1, names.size(), file) == names.size();
+  written = fclose(file) == 0 && written;
+#ifdef _WIN32
+  // rename() does not replace an existing file on Windows. Elsewhere it
+  // does so atomically, and readers keep seeing the old file until then.
+  if (written)
+    {
+    remove(fileName.c_str());
+    }
+#endif
+  if (!written || rename(temporaryName.c_str(), fileName.c_str()) != 0)
+    {
+    vtkWarningMacro(<< "Cannot write cache file " << fileName);
+    remove(temporaryName.c_str());
+    return false;
+    }
+
+  this->Evict(fileName);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMappedVolumeCache::Evict(const std::string &keep)
+{
+  vtkDirectory *directory = vtkDirectory::New();
+  if (!directory->Open(this->Directory))
+    {
+    directory->Delete();
+    return;
+    }
+  // (modification time, size, name) of each cache file.
+  std::vector<std::pair<std::pair<vtkTypeInt64, vtkTypeUInt64>, std::string> > files;
+  vtkTypeUInt64 total = 0;
+  size_t extensionLength = strlen(Extension);
+  for (vtkIdType i = 0; i < directory->GetNumberOfFiles(); i++)
+    {
+    std::string name = directory->GetFile(i);
+    if (name.size() <= extensionLength ||
+        name.compare(name.size() - extensionLength, extensionLength, Extension) != 0)
+      {
+      continue;
+      }
+    name = std::string(this->Directory) + "/" + name;
+    vtkTypeUInt64 size;
+    vtkTypeInt64 time;
+    if (GetFileInfo(name, size, time))
+      {
+      files.push_back(std::make_pair(std::make_pair(time, size), name));
+      total += size;
+      }
+    }
+  directory->Delete();
+
+  std::sort(files.begin(), files.end());
+  vtkTypeUInt64 maximum = static_cast<vtkTypeUInt64>(this->MaximumSize) << 20;
+  for (size_t i = 0; i < files.size() && total > maximum; i++)
+    {
+    // A file still mapped on Windows cannot be deleted; it is skipped.
+    if (files[i].second != keep && remove(files[i].second.c_str()) == 0)
+      {
+      total -= files[i].first.second;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMappedVolumeCache::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Directory: "
+     << (this->Directory ? this->Directory : "(none)") << "\n";
+  os << indent << "Maximum Size: " << this->MaximumSize << " MiB\n";
+}
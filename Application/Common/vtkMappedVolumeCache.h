@@ -0,0 +1,122 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkMappedVolumeCache.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkMappedVolumeCache - on-disk cache of decoded volumes, memory mapped on load
+// .SECTION Description
+// vtkMappedVolumeCache keeps decoded volumes in a directory, one file per
+// volume, so that a study opened again is not parsed and decoded again.
+// A cache file holds a fixed size header with the geometry and metadata,
+// the voxels exactly as they are laid out in the vtkImageData, and the
+// names of the source files. Load() maps the file into memory and wraps
+// the voxels in a data array without copying them: the pages are read by
+// the operating system when they are first touched, and the mapping is
+// released with the array. The mapping is copy-on-write, so filters that
+// modify the scalars in place do not change the file.
+//
+// Volumes are keyed by ComputeKey(), a hash of the series UID and of the
+// name, size and modification time of every source file; the file
+// contents are not read, so computing a key costs one stat() per file.
+// Any change to the files gives a new key, and the stale volume is
+// dropped when the cache outgrows MaximumSize.
+//
+// Files are written in the byte order of the machine and are rejected on
+// a machine of the other byte order.
+//
+// .SECTION See Also
+// vtkDICOMSeriesLoader
+
+#ifndef __vtkMappedVolumeCache_h
+#define __vtkMappedVolumeCache_h
+
+#include "vtkObject.h"
+#include "vtkSmartPointer.h"
+
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkImageData;
+
+class vtkMappedVolumeCache : public vtkObject
+{
+public:
+  static vtkMappedVolumeCache *New();
+  vtkTypeMacro(vtkMappedVolumeCache, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // The directory holding the cache files, created on the first store.
+  // Nothing is cached while it is NULL (the default).
+  vtkSetStringMacro(Directory);
+  vtkGetStringMacro(Directory);
+
+  // Description:
+  // Size in MiB that the cache files may take before the least recently
+  // used ones are deleted. Applied when a volume is stored. Default is
+  // 8 GiB.
+  vtkSetMacro(MaximumSize, unsigned long);
+  vtkGetMacro(MaximumSize, unsigned long);
+
+  // What is stored with the voxels of a volume.
+  struct Metadata
+  {
+    int Extent[6];
+    double Spacing[3];
+    double Origin[3];
+    int ScalarType;
+    int NumberOfComponents;
+    std::string SeriesInstanceUID;
+    double RescaleSlope;
+    double RescaleOffset;
+    double Position[3];
+    double Orientation[6];
+    std::vector<std::string> FileNames;
+  };
+
+  // Description:
+  // The key of the volume read from fileNames for the given series UID,
+  // which may be NULL.
+  static std::string ComputeKey(const char *seriesInstanceUID,
+                                const std::vector<std::string> &fileNames);
+
+  // Description:
+  // Map the volume stored under key. Returns its scalars and fills
+  // metadata, or returns NULL if the volume is not cached or its file is
+  // not valid.
+  vtkSmartPointer<vtkDataArray> Load(const std::string &key, Metadata &metadata);
+
+  // Description:
+  // Store the point scalars of image with metadata under key, replacing
+  // any volume stored under it. Returns false on failure.
+  bool Store(const std::string &key, vtkImageData *image, const Metadata &metadata);
+
+protected:
+  vtkMappedVolumeCache();
+  ~vtkMappedVolumeCache();
+
+  std::string GetFileName(const std::string &key);
+
+  // Delete the least recently used files until the cache fits in
+  // MaximumSize, sparing the file named keep.
+  void Evict(const std::string &keep);
+
+  char *Directory;
+  unsigned long MaximumSize;
+
+private:
+  vtkMappedVolumeCache(const vtkMappedVolumeCache&);  // Not implemented.
+  void operator=(const vtkMappedVolumeCache&);  // Not implemented.
+};
+
+#endif
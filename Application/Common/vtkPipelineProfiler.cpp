@@ -0,0 +1,695 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkPipelineProfiler.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkPipelineProfiler.h"
+
+#include "vtkAlgorithm.h"
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkCompositeDataPipeline.h"
+#include "vtkDataArray.h"
+#include "vtkDataObject.h"
+#include "vtkDataSet.h"
+#include "vtkDemandDrivenPipeline.h"
+#include "vtkFieldData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPointSet.h"
+#include "vtkPolyData.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTimerLog.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "psapi.lib")
+#endif
+#endif
+
+#ifdef PIPELINE_PROFILER_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+thread_local long ThreadAllocations = 0;
+}
+
+void *operator new(size_t size)
+{
+  ++ThreadAllocations;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    {
+    throw std::bad_alloc();
+    }
+  return p;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  free(p);
+}
+#endif
+
+namespace
+{
+long GetThreadAllocations()
+{
+#ifdef PIPELINE_PROFILER_COUNT_ALLOCATIONS
+  return ThreadAllocations;
+#else
+  return -1;
+#endif
+}
+
+const char *GetRequestName(vtkInformation *request)
+{
+  if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA()))
+    {
+    return "RequestData";
+    }
+  if (request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_UPDATE_EXTENT()))
+    {
+    return "RequestUpdateExtent";
+    }
+  if (request->Has(vtkDemandDrivenPipeline::REQUEST_INFORMATION()))
+    {
+    return "RequestInformation";
+    }
+  if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_OBJECT()))
+    {
+    return "RequestDataObject";
+    }
+  if (request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_UPDATE_TIME()))
+    {
+    return "RequestUpdateTime";
+    }
+  if (request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_TIME_DEPENDENT_INFORMATION()))
+    {
+    return "RequestTimeDependentInformation";
+    }
+  return "Request";
+}
+
+// Accumulates memory size and point/cell counts of the data objects held
+// by an information vector.
+void AddSizes(vtkInformationVector *infoVector, unsigned long &kib,
+              long long &points, long long &cells)
+{
+  if (!infoVector)
+    {
+    return;
+    }
+  for (int i = 0; i < infoVector->GetNumberOfInformationObjects(); i++)
+    {
+    vtkDataObject *data = vtkDataObject::SafeDownCast(
+      infoVector->GetInformationObject(i)->Get(vtkDataObject::DATA_OBJECT()));
+    if (!data)
+      {
+      continue;
+      }
+    kib += data->GetActualMemorySize();
+    if (vtkDataSet *dataSet = vtkDataSet::SafeDownCast(data))
+      {
+      points += dataSet->GetNumberOfPoints();
+      cells += dataSet->GetNumberOfCells();
+      }
+    }
+}
+
+// Resident set size and its high-water mark in bytes, or -1 when the
+// platform does not report them.
+void GetResidentMemory(long long &current, long long &peak)
+{
+  current = peak = -1;
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+    current = static_cast<long long>(counters.WorkingSetSize);
+    peak = static_cast<long long>(counters.PeakWorkingSetSize);
+    }
+#elif defined(__linux__)
+  FILE *status = fopen("/proc/self/status", "r");
+  if (status)
+    {
+    char line[256];
+    long long kib;
+    while (fgets(line, sizeof(line), status))
+      {
+      if (sscanf(line, "VmRSS: %lld", &kib) == 1)
+        {
+        current = kib * 1024;
+        }
+      else if (sscanf(line, "VmHWM: %lld", &kib) == 1)
+        {
+        peak = kib * 1024;
+        }
+      }
+    fclose(status);
+    }
+#endif
+}
+
+// Resets the resident high-water mark to the current resident size, so the
+// next reading covers only what follows. Returns false where unsupported.
+bool ResetPeakResidentMemory()
+{
+#if defined(__linux__)
+  FILE *clearRefs = fopen("/proc/self/clear_refs", "w");
+  if (clearRefs)
+    {
+    bool written = fputs("5", clearRefs) >= 0;
+    return fclose(clearRefs) == 0 && written;
+    }
+#endif
+  return false;
+}
+
+void InsertArray(vtkAbstractArray *array, std::set<vtkAbstractArray*> &arrays)
+{
+  if (array)
+    {
+    arrays.insert(array);
+    }
+}
+
+void InsertCells(vtkCellArray *cells, std::set<vtkAbstractArray*> &arrays)
+{
+  if (cells)
+    {
+    InsertArray(cells->GetData(), arrays);
+    }
+}
+
+// Collects every array that holds the data of a data object: attributes,
+// field data, points and cell connectivity.
+void CollectArrays(vtkDataObject *data, std::set<vtkAbstractArray*> &arrays)
+{
+  vtkFieldData *fields[3] = { data->GetFieldData(), NULL, NULL };
+  if (vtkDataSet *dataSet = vtkDataSet::SafeDownCast(data))
+    {
+    fields[1] = dataSet->GetPointData();
+    fields[2] = dataSet->GetCellData();
+    }
+  for (int f = 0; f < 3; f++)
+    {
+    for (int i = 0; fields[f] && i < fields[f]->GetNumberOfArrays(); i++)
+      {
+      InsertArray(fields[f]->GetAbstractArray(i), arrays);
+      }
+    }
+
+  if (vtkPointSet *pointSet = vtkPointSet::SafeDownCast(data))
+    {
+    if (pointSet->GetPoints())
+      {
+      InsertArray(pointSet->GetPoints()->GetData(), arrays);
+      }
+    }
+  if (vtkPolyData *polyData = vtkPolyData::SafeDownCast(data))
+    {
+    InsertCells(polyData->GetVerts(), arrays);
+    InsertCells(polyData->GetLines(), arrays);
+    InsertCells(polyData->GetPolys(), arrays);
+    InsertCells(polyData->GetStrips(), arrays);
+    }
+  else if (vtkUnstructuredGrid *grid = vtkUnstructuredGrid::SafeDownCast(data))
+    {
+    InsertCells(grid->GetCells(), arrays);
+    InsertArray(grid->GetCellTypesArray(), arrays);
+    InsertArray(grid->GetCellLocationsArray(), arrays);
+    }
+}
+
+void CollectArrays(vtkInformationVector *infoVector,
+                   std::set<vtkAbstractArray*> &arrays)
+{
+  for (int i = 0; infoVector && i < infoVector->GetNumberOfInformationObjects(); i++)
+    {
+    vtkDataObject *data = vtkDataObject::SafeDownCast(
+      infoVector->GetInformationObject(i)->Get(vtkDataObject::DATA_OBJECT()));
+    if (data)
+      {
+      CollectArrays(data, arrays);
+      }
+    }
+}
+
+double ToMiB(long long bytes)
+{
+  return bytes < 0 ? -1.0 : bytes / (1024.0 * 1024.0);
+}
+
+// Escapes a string for a JSON string literal.
+std::string EscapeJSON(const std::string &text)
+{
+  std::string escaped;
+  for (size_t i = 0; i < text.size(); i++)
+    {
+    char c = text[i];
+    if (c == '"' || c == '\\')
+      {
+      escaped += '\\';
+      escaped += c;
+      }
+    else if (static_cast<unsigned char>(c) < 0x20)
+      {
+      escaped += ' ';
+      }
+    else
+      {
+      escaped += c;
+      }
+    }
+  return escaped;
+}
+}
+
+//----------------------------------------------------------------------------
+// Executive that times each pass it forwards to its algorithm. Instances
+// are created from the default executive prototype, so the installed
+// profiler is looked up at call time rather than stored.
+class vtkProfilingExecutive : public vtkCompositeDataPipeline
+{
+public:
+  static vtkProfilingExecutive *New();
+  vtkTypeMacro(vtkProfilingExecutive, vtkCompositeDataPipeline);
+
+protected:
+  vtkProfilingExecutive() {}
+  ~vtkProfilingExecutive() {}
+
+  int CallAlgorithm(vtkInformation *request, int direction,
+                    vtkInformationVector **inInfo, vtkInformationVector *outInfo)
+  {
+    vtkPipelineProfiler *profiler = vtkPipelineProfiler::GetInstalledProfiler();
+    if (!profiler)
+      {
+      return this->Superclass::CallAlgorithm(request, direction, inInfo, outInfo);
+      }
+
+    bool measureMemory = profiler->GetMemoryAccounting() &&
+      request->Has(vtkDemandDrivenPipeline::REQUEST_DATA());
+    long long residentBefore = -1, peakBefore = -1;
+    bool peakReset = false;
+    if (measureMemory)
+      {
+      peakReset = ResetPeakResidentMemory();
+      GetResidentMemory(residentBefore, peakBefore);
+      }
+
+    long allocations = GetThreadAllocations();
+    double start = vtkTimerLog::GetUniversalTime();
+    int result = this->Superclass::CallAlgorithm(request, direction, inInfo, outInfo);
+    double end = vtkTimerLog::GetUniversalTime();
+    if (allocations >= 0)
+      {
+      allocations = GetThreadAllocations() - allocations;
+      }
+
+    long long peakDelta = -1;
+    if (measureMemory && residentBefore >= 0)
+      {
+      long long residentAfter, peakAfter;
+      GetResidentMemory(residentAfter, peakAfter);
+      // Without a reset the peak is only known to have been reached during
+      // this execution if it grew.
+      if (peakReset || peakAfter > peakBefore)
+        {
+        peakDelta = peakAfter > residentBefore ? peakAfter - residentBefore : 0;
+        }
+      else
+        {
+        peakDelta = 0;
+        }
+      }
+
+    profiler->RecordRequest(this->GetAlgorithm(), GetRequestName(request),
+                            start, end, allocations, peakDelta, inInfo, outInfo);
+    return result;
+  }
+
+private:
+  vtkProfilingExecutive(const vtkProfilingExecutive&);  // Not implemented.
+  void operator=(const vtkProfilingExecutive&);  // Not implemented.
+};
+
+vtkStandardNewMacro(vtkProfilingExecutive);
+
+//----------------------------------------------------------------------------
+vtkPipelineProfiler *vtkPipelineProfiler::Installed = NULL;
+
+vtkStandardNewMacro(vtkPipelineProfiler);
+
+//----------------------------------------------------------------------------
+vtkPipelineProfiler::vtkPipelineProfiler()
+{
+  this->StartTime = vtkTimerLog::GetUniversalTime();
+  this->MemoryAccounting = 1;
+  this->PrintMemorySummaryOnExit = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkPipelineProfiler::~vtkPipelineProfiler()
+{
+  this->Uninstall();
+  if (this->PrintMemorySummaryOnExit)
+    {
+    this->PrintMemorySummary(cout);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkPipelineProfiler *vtkPipelineProfiler::GetInstalledProfiler()
+{
+  return vtkPipelineProfiler::Installed;
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::Install()
+{
+  if (vtkPipelineProfiler::Installed == this)
+    {
+    return;
+    }
+  if (vtkPipelineProfiler::Installed)
+    {
+    vtkPipelineProfiler::Installed->Uninstall();
+    }
+
+  vtkProfilingExecutive *prototype = vtkProfilingExecutive::New();
+  vtkAlgorithm::SetDefaultExecutivePrototype(prototype);
+  prototype->Delete();
+
+  this->StartTime = vtkTimerLog::GetUniversalTime();
+  vtkPipelineProfiler::Installed = this;
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::Uninstall()
+{
+  if (vtkPipelineProfiler::Installed != this)
+    {
+    return;
+    }
+  vtkPipelineProfiler::Installed = NULL;
+  vtkAlgorithm::SetDefaultExecutivePrototype(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::Clear()
+{
+  std::lock_guard<std::mutex> guard(this->Lock);
+  this->Events.clear();
+}
+
+//----------------------------------------------------------------------------
+size_t vtkPipelineProfiler::GetNumberOfEvents()
+{
+  std::lock_guard<std::mutex> guard(this->Lock);
+  return this->Events.size();
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::RecordRequest(vtkAlgorithm *algorithm,
+  const char *request, double startTime, double endTime, long allocations,
+  long long peakDelta,
+  vtkInformationVector **inInfo, vtkInformationVector *outInfo)
+{
+  Event event;
+  event.Name = algorithm ? algorithm->GetClassName() : "vtkExecutive";
+  event.Request = request;
+  event.Algorithm = algorithm;
+  event.Start = startTime;
+  event.Duration = endTime - startTime;
+  event.Allocations = allocations;
+  event.HasSizes = false;
+  event.InputKiB = event.OutputKiB = 0;
+  event.InputPoints = event.InputCells = 0;
+  event.OutputPoints = event.OutputCells = 0;
+
+  // Sizes are only meaningful once the data has been produced.
+  if (algorithm && event.Request == "RequestData")
+    {
+    event.HasSizes = true;
+    for (int i = 0; i < algorithm->GetNumberOfInputPorts(); i++)
+      {
+      AddSizes(inInfo ? inInfo[i] : NULL, event.InputKiB,
+               event.InputPoints, event.InputCells);
+      }
+    AddSizes(outInfo, event.OutputKiB, event.OutputPoints, event.OutputCells);
+    }
+
+  event.HasMemory = event.HasSizes && this->MemoryAccounting;
+  if (event.HasMemory)
+    {
+    MemoryUsage &memory = event.Memory;
+    memory.Algorithm = event.Name;
+    memory.Instance = algorithm;
+    memory.Time = startTime - this->StartTime;
+    memory.OutputBytes = static_cast<long long>(event.OutputKiB) * 1024;
+    memory.NewArrayBytes = memory.SharedArrayBytes = 0;
+    memory.NewArrays = memory.SharedArrays = 0;
+    memory.PeakDelta = peakDelta;
+
+    // An output array that is also held by an input was passed through by
+    // reference; everything else was allocated by this execution.
+    std::set<vtkAbstractArray*> inputArrays, outputArrays;
+    for (int i = 0; i < algorithm->GetNumberOfInputPorts(); i++)
+      {
+      CollectArrays(inInfo ? inInfo[i] : NULL, inputArrays);
+      }
+    CollectArrays(outInfo, outputArrays);
+    for (std::set<vtkAbstractArray*>::iterator it = outputArrays.begin();
+         it != outputArrays.end(); ++it)
+      {
+      long long bytes = static_cast<long long>((*it)->GetActualMemorySize()) * 1024;
+      if (inputArrays.count(*it))
+        {
+        memory.SharedArrayBytes += bytes;
+        memory.SharedArrays++;
+        }
+      else
+        {
+        memory.NewArrayBytes += bytes;
+        memory.NewArrays++;
+        }
+      }
+    }
+
+  std::ostringstream threadId;
+  threadId << std::this_thread::get_id();
+
+  std::lock_guard<std::mutex> guard(this->Lock);
+  event.ThreadIndex = -1;
+  for (size_t i = 0; i < this->ThreadIds.size(); i++)
+    {
+    if (this->ThreadIds[i] == threadId.str())
+      {
+      event.ThreadIndex = static_cast<int>(i);
+      break;
+      }
+    }
+  if (event.ThreadIndex < 0)
+    {
+    event.ThreadIndex = static_cast<int>(this->ThreadIds.size());
+    this->ThreadIds.push_back(threadId.str());
+    }
+  this->Events.push_back(event);
+}
+
+//----------------------------------------------------------------------------
+int vtkPipelineProfiler::WriteChromeTrace(const char *fileName)
+{
+  if (!fileName)
+    {
+    vtkErrorMacro(<< "No file name specified");
+    return 0;
+    }
+  std::ofstream file(fileName);
+  if (!file)
+    {
+    vtkErrorMacro(<< "Cannot open " << fileName);
+    return 0;
+    }
+
+  std::lock_guard<std::mutex> guard(this->Lock);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  for (size_t i = 0; i < this->ThreadIds.size(); i++)
+    {
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+         << ",\"args\":{\"name\":\"thread "
+         << EscapeJSON(this->ThreadIds[i]) << "\"}},\n";
+    }
+  file.setf(std::ios::fixed);
+  file.precision(3);
+  for (size_t i = 0; i < this->Events.size(); i++)
+    {
+    const Event &e = this->Events[i];
+    file << "{\"name\":\"" << EscapeJSON(e.Name) << "::" << e.Request
+         << "\",\"cat\":\"" << e.Request << "\",\"ph\":\"X\",\"pid\":1"
+         << ",\"tid\":" << e.ThreadIndex
+         << ",\"ts\":" << (e.Start - this->StartTime) * 1.0e6
+         << ",\"dur\":" << e.Duration * 1.0e6
+         << ",\"args\":{\"algorithm\":\"" << e.Algorithm << "\"";
+    if (e.Allocations >= 0)
+      {
+      file << ",\"allocations\":" << e.Allocations;
+      }
+    if (e.HasSizes)
+      {
+      file << ",\"inputKiB\":" << e.InputKiB
+           << ",\"inputPoints\":" << e.InputPoints
+           << ",\"inputCells\":" << e.InputCells
+           << ",\"outputKiB\":" << e.OutputKiB
+           << ",\"outputPoints\":" << e.OutputPoints
+           << ",\"outputCells\":" << e.OutputCells;
+      }
+    if (e.HasMemory)
+      {
+      file << ",\"newArrayBytes\":" << e.Memory.NewArrayBytes
+           << ",\"newArrays\":" << e.Memory.NewArrays
+           << ",\"sharedArrayBytes\":" << e.Memory.SharedArrayBytes
+           << ",\"sharedArrays\":" << e.Memory.SharedArrays
+           << ",\"peakDeltaBytes\":" << e.Memory.PeakDelta;
+      }
+    file << "}}" << (i + 1 < this->Events.size() ? ",\n" : "\n");
+    }
+  file << "]}\n";
+
+  return file.good() ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+std::vector<vtkPipelineProfiler::MemoryUsage> vtkPipelineProfiler::GetMemoryUsage()
+{
+  std::lock_guard<std::mutex> guard(this->Lock);
+  std::vector<MemoryUsage> usage;
+  for (size_t i = 0; i < this->Events.size(); i++)
+    {
+    if (this->Events[i].HasMemory)
+      {
+      usage.push_back(this->Events[i].Memory);
+      }
+    }
+  return usage;
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::PrintMemorySummary(ostream &os)
+{
+  struct Row
+  {
+    std::string Algorithm;
+    int Runs;
+    MemoryUsage Max;
+  };
+  std::vector<MemoryUsage> usage = this->GetMemoryUsage();
+  std::vector<Row> rows;
+  std::map<const void*, size_t> rowIndex;
+  for (size_t i = 0; i < usage.size(); i++)
+    {
+    const MemoryUsage &u = usage[i];
+    std::map<const void*, size_t>::iterator found = rowIndex.find(u.Instance);
+    if (found == rowIndex.end())
+      {
+      Row row;
+      row.Algorithm = u.Algorithm;
+      row.Runs = 0;
+      row.Max = u;
+      rowIndex[u.Instance] = rows.size();
+      rows.push_back(row);
+      found = rowIndex.find(u.Instance);
+      }
+    Row &row = rows[found->second];
+    row.Runs++;
+    row.Max.OutputBytes = std::max(row.Max.OutputBytes, u.OutputBytes);
+    row.Max.NewArrayBytes = std::max(row.Max.NewArrayBytes, u.NewArrayBytes);
+    row.Max.SharedArrayBytes = std::max(row.Max.SharedArrayBytes, u.SharedArrayBytes);
+    row.Max.NewArrays = std::max(row.Max.NewArrays, u.NewArrays);
+    row.Max.SharedArrays = std::max(row.Max.SharedArrays, u.SharedArrays);
+    row.Max.PeakDelta = std::max(row.Max.PeakDelta, u.PeakDelta);
+    }
+
+  os << "Pipeline memory (MiB, maximum over executions; arrays new/shared)\n";
+  os << std::left << std::setw(32) << "Algorithm" << std::right
+     << std::setw(6) << "Runs" << std::setw(12) << "Output"
+     << std::setw(12) << "New" << std::setw(12) << "Shared"
+     << std::setw(10) << "Arrays" << std::setw(12) << "Peak" << "\n";
+  std::ios::fmtflags flags = os.flags();
+  os.setf(std::ios::fixed);
+  std::streamsize precision = os.precision(2);
+  for (size_t i = 0; i < rows.size(); i++)
+    {
+    const Row &row = rows[i];
+    std::ostringstream arrays;
+    arrays << row.Max.NewArrays << "/" << row.Max.SharedArrays;
+    os << std::left << std::setw(32) << row.Algorithm << std::right
+       << std::setw(6) << row.Runs
+       << std::setw(12) << ToMiB(row.Max.OutputBytes)
+       << std::setw(12) << ToMiB(row.Max.NewArrayBytes)
+       << std::setw(12) << ToMiB(row.Max.SharedArrayBytes)
+       << std::setw(10) << arrays.str();
+    if (row.Max.PeakDelta < 0)
+      {
+      os << std::setw(12) << "n/a";
+      }
+    else
+      {
+      os << std::setw(12) << ToMiB(row.Max.PeakDelta);
+      }
+    os << "\n";
+    }
+  os.precision(precision);
+  os.flags(flags);
+}
+
+//----------------------------------------------------------------------------
+void vtkPipelineProfiler::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Installed: "
+     << (vtkPipelineProfiler::Installed == this ? "Yes\n" : "No\n");
+  os << indent << "Number Of Events: " << this->Events.size() << "\n";
+  os << indent << "Memory Accounting: "
+     << (this->MemoryAccounting ? "On\n" : "Off\n");
+  os << indent << "Print Memory Summary On Exit: "
+     << (this->PrintMemorySummaryOnExit ? "On\n" : "Off\n");
+}
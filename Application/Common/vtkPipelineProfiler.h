@@ -0,0 +1,178 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkPipelineProfiler.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkPipelineProfiler - record pipeline requests and export a Chrome trace
+// .SECTION Description
+// vtkPipelineProfiler times every pipeline pass (RequestDataObject,
+// RequestInformation, RequestUpdateExtent, RequestData, ...) of every
+// algorithm and writes them as Chrome trace JSON, viewable in
+// chrome://tracing or https://ui.perfetto.dev.
+//
+// Install() makes a profiling executive the default executive prototype,
+// so every algorithm constructed afterwards is instrumented without any
+// change to the filters themselves. Call it first thing in main():
+//
+//   vtkSmartPointer<vtkPipelineProfiler> profiler =
+//     vtkSmartPointer<vtkPipelineProfiler>::New();
+//   profiler->Install();
+//   ... build and run the pipeline ...
+//   profiler->WriteChromeTrace("trace.json");
+//
+// Each event records the calling thread, and for RequestData the memory
+// size (KiB) and point/cell counts of the inputs and outputs. When the
+// profiler source is compiled with PIPELINE_PROFILER_COUNT_ALLOCATIONS
+// defined, it also replaces the global operator new and records the number
+// of heap allocations made by the requesting thread during each pass
+// (allocations in vtkSMPTools worker threads are not attributed).
+//
+// With MemoryAccounting on (the default), each RequestData also records
+// what its outputs cost: the bytes held by output arrays that are new, as
+// opposed to shared with an input (a shallow pass-through), and the peak
+// resident memory reached during the execution relative to the resident
+// size before it, which captures transient buffers such as locators and
+// scratch arrays. On Linux the high-water mark is reset before each
+// execution, so the peak is exact; on Windows it is a lower bound that is
+// only seen when the process-wide peak grows. Resident memory is process
+// wide, so concurrent executions are not separated. GetMemoryUsage()
+// returns the records and PrintMemorySummary() a per-algorithm table, which
+// is also printed to cout when the profiler is destroyed if
+// PrintMemorySummaryOnExit is on.
+//
+// Only one profiler can be installed at a time.
+
+#ifndef __vtkPipelineProfiler_h
+#define __vtkPipelineProfiler_h
+
+#include "vtkObject.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+class vtkAlgorithm;
+class vtkInformationVector;
+
+class vtkPipelineProfiler : public vtkObject
+{
+public:
+  static vtkPipelineProfiler *New();
+  vtkTypeMacro(vtkPipelineProfiler, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Instrument every algorithm created from now on, and start the clock.
+  // Uninstall() resets the default executive prototype; algorithms created
+  // while installed keep their executive but stop recording.
+  void Install();
+  void Uninstall();
+
+  // Description:
+  // Drop all recorded events.
+  void Clear();
+
+  // Description:
+  // Number of recorded events.
+  size_t GetNumberOfEvents();
+
+  // Description:
+  // Write the recorded events as Chrome trace JSON. Returns 1 on success.
+  int WriteChromeTrace(const char *fileName);
+
+  // Description:
+  // Record output array and peak memory sizes for each RequestData.
+  vtkSetMacro(MemoryAccounting, int);
+  vtkGetMacro(MemoryAccounting, int);
+  vtkBooleanMacro(MemoryAccounting, int);
+
+  // Description:
+  // Print the memory summary table to cout when the profiler is destroyed.
+  vtkSetMacro(PrintMemorySummaryOnExit, int);
+  vtkGetMacro(PrintMemorySummaryOnExit, int);
+  vtkBooleanMacro(PrintMemorySummaryOnExit, int);
+
+  // Memory cost of one RequestData. Byte counts are -1 when unknown.
+  struct MemoryUsage
+  {
+    std::string Algorithm;
+    const void *Instance;
+    double Time;
+    long long OutputBytes;
+    long long NewArrayBytes;
+    long long SharedArrayBytes;
+    int NewArrays;
+    int SharedArrays;
+    long long PeakDelta;
+  };
+
+  // Description:
+  // The memory records of all RequestData passes so far, in order.
+  std::vector<MemoryUsage> GetMemoryUsage();
+
+  // Description:
+  // Print one row per algorithm instance with its number of executions and
+  // the largest output, new-array and peak figures over those executions.
+  void PrintMemorySummary(ostream &os);
+
+  // Description:
+  // The installed profiler, or NULL. Used by the profiling executive.
+  static vtkPipelineProfiler *GetInstalledProfiler();
+
+  // Description:
+  // Record one request. Called by the profiling executive; the times are
+  // vtkTimerLog::GetUniversalTime() values.
+  // peakDelta is the peak resident growth in bytes, or -1 when not measured.
+  void RecordRequest(vtkAlgorithm *algorithm, const char *request,
+                     double startTime, double endTime, long allocations,
+                     long long peakDelta,
+                     vtkInformationVector **inInfo, vtkInformationVector *outInfo);
+
+protected:
+  vtkPipelineProfiler();
+  ~vtkPipelineProfiler();
+
+  struct Event
+  {
+    std::string Name;
+    std::string Request;
+    const void *Algorithm;
+    double Start;
+    double Duration;
+    int ThreadIndex;
+    long Allocations;
+    bool HasSizes;
+    unsigned long InputKiB;
+    unsigned long OutputKiB;
+    long long InputPoints;
+    long long InputCells;
+    long long OutputPoints;
+    long long OutputCells;
+    bool HasMemory;
+    MemoryUsage Memory;
+  };
+
+  std::vector<Event> Events;
+  std::vector<std::string> ThreadIds;
+  std::mutex Lock;
+  double StartTime;
+  int MemoryAccounting;
+  int PrintMemorySummaryOnExit;
+
+private:
+  vtkPipelineProfiler(const vtkPipelineProfiler&);  // Not implemented.
+  void operator=(const vtkPipelineProfiler&);  // Not implemented.
+
+  static vtkPipelineProfiler *Installed;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkProgressReporter.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkProgressReporter - throttled, thread-safe progress for filter loops
+// .SECTION Description
+// vtkAlgorithm::UpdateProgress() fires ProgressEvent and runs every observer
+// on each call, so calling it once per element makes reporting dominate the
+// loop. vtkProgressReporter counts finished elements and forwards progress
+// to the algorithm only when it has grown by at least ProgressDelta and at
+// least MinimumInterval seconds have passed since the last report (either
+// can be 0 to disable that limit).
+//
+// Serial loops pass their index to Update(), which costs two compares per
+// element until a reporting step is reached. vtkSMPTools workers call
+// Advance() once per chunk instead: the counts are summed in one atomic.
+// Use one of the two styles per reporter.
+//
+// Whichever worker reaches a reporting step samples the abort flag, so an
+// abort requested from another thread stops every worker. Only the thread
+// that constructed the reporter calls UpdateProgress(), so that observers
+// run on the thread that started the update. vtkSMPTools does not promise
+// that this thread runs any chunk (with the STDThread backend it waits
+// for pool threads), so a parallel loop may report no intermediate
+// progress; call Finish() after the loop. The abort flag is cached, so
+// GetAbort() and the values returned by Update() and Advance() cost one
+// relaxed load.
+//
+//   vtkProgressReporter progress(this, numPts);
+//   for (vtkIdType i = 0; i < numPts && progress.Update(i); i++)
+//     {
+//     ...
+//     }
+//   progress.Finish();
+//
+//   void operator()(vtkIdType begin, vtkIdType end)   // in a functor
+//   {
+//     if (this->Progress->GetAbort()) return;
+//     ...
+//     this->Progress->Advance(end - begin);
+//   }
+
+#ifndef __vtkProgressReporter_h
+#define __vtkProgressReporter_h
+
+#include "vtkAlgorithm.h"
+#include "vtkTimerLog.h"
+
+#include <atomic>
+#include <thread>
+
+class vtkProgressReporter
+{
+public:
+  vtkProgressReporter(vtkAlgorithm *algorithm, vtkIdType total,
+                      double progressDelta = 0.01, double minimumInterval = 0.1)
+    : Algorithm(algorithm), Total(total > 0 ? total : 1),
+      MinimumInterval(minimumInterval), LastReportTime(0.0),
+      Owner(std::this_thread::get_id()), Done(0), Aborted(false)
+  {
+    vtkIdType step = static_cast<vtkIdType>(progressDelta * this->Total);
+    this->Step = step > 0 ? step : 1;
+    this->NextCheck.store(this->Step, std::memory_order_relaxed);
+    this->NextReport = this->Step;
+    this->Aborted.store(algorithm->GetAbortExecute() != 0,
+                        std::memory_order_relaxed);
+  }
+
+  // Description:
+  // Serial loops: done elements are finished. Call from the constructing
+  // thread. Returns false once the algorithm has been asked to abort, so it
+  // can be used directly as a loop condition.
+  bool Update(vtkIdType done)
+  {
+    if (done >= this->NextCheck.load(std::memory_order_relaxed))
+      {
+      this->NextCheck.store(done + this->Step, std::memory_order_relaxed);
+      this->CheckAbort();
+      this->Report(done);
+      }
+    return !this->Aborted.load(std::memory_order_relaxed);
+  }
+
+  // Description:
+  // Parallel loops: n more elements are finished. Thread safe; meant to be
+  // called once per chunk. Returns false once an abort was seen.
+  bool Advance(vtkIdType n)
+  {
+    vtkIdType done = this->Done.fetch_add(n, std::memory_order_relaxed) + n;
+    // One thread per step samples the abort flag, whichever it is.
+    vtkIdType check = this->NextCheck.load(std::memory_order_relaxed);
+    if (done >= check &&
+        this->NextCheck.compare_exchange_strong(check, done + this->Step,
+                                                std::memory_order_relaxed))
+      {
+      this->CheckAbort();
+      }
+    if (std::this_thread::get_id() == this->Owner && done >= this->NextReport)
+      {
+      this->NextReport = done + this->Step;
+      this->Report(done);
+      this->CheckAbort();
+      }
+    return !this->Aborted.load(std::memory_order_relaxed);
+  }
+
+  // Description:
+  // True once an abort was seen at a reporting step, by any thread.
+  bool GetAbort() const
+  {
+    return this->Aborted.load(std::memory_order_relaxed);
+  }
+
+  // Description:
+  // Report completion unconditionally. Call from the constructing thread.
+  void Finish()
+  {
+    this->Algorithm->UpdateProgress(1.0);
+  }
+
+private:
+  vtkProgressReporter(const vtkProgressReporter&);  // Not implemented.
+  void operator=(const vtkProgressReporter&);  // Not implemented.
+
+  void CheckAbort()
+  {
+    if (this->Algorithm->GetAbortExecute())
+      {
+      this->Aborted.store(true, std::memory_order_relaxed);
+      }
+  }
+
+  // Owner thread only; the clock is read at most once per Step elements.
+  void Report(vtkIdType done)
+  {
+    double now = vtkTimerLog::GetUniversalTime();
+    if (now - this->LastReportTime < this->MinimumInterval)
+      {
+      return;
+      }
+    this->LastReportTime = now;
+
+    double progress = static_cast<double>(done) / this->Total;
+    this->Algorithm->UpdateProgress(progress < 1.0 ? progress : 1.0);
+  }
+
+  vtkAlgorithm *Algorithm;
+  vtkIdType Total;
+  vtkIdType Step;
+  double MinimumInterval;
+  double LastReportTime;
+  std::thread::id Owner;
+  std::atomic<vtkIdType> Done;
+  std::atomic<vtkIdType> NextCheck;
+  vtkIdType NextReport;
+  std::atomic<bool> Aborted;
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSpatialIndexRegistry.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkSpatialIndexRegistry.h"
+
+#include "vtkDataSet.h"
+#include "vtkKdTreePointLocator.h"
+#include "vtkModifiedBSPTree.h"
+#include "vtkObjectFactory.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkStaticCellLocator.h"
+#include "vtkStaticPointLocator.h"
+
+#include <vector>
+
+vtkStandardNewMacro(vtkSpatialIndexRegistry);
+
+namespace
+{
+bool IsPointIndex(int type)
+{
+  return type == vtkSpatialIndexRegistry::POINT_LOCATOR ||
+         type == vtkSpatialIndexRegistry::KD_TREE;
+}
+
+bool IsEmpty(vtkDataSet *dataSet, int type)
+{
+  return IsPointIndex(type) ? dataSet->GetNumberOfPoints() == 0
+                            : dataSet->GetNumberOfCells() == 0;
+}
+
+// The locators compute the bounds and, for polydata, the cell links
+// lazily, which is not safe once several of them read the dataset at
+// the same time. Done once up front, the builds only read.
+void PrepareDataSet(vtkDataSet *dataSet)
+{
+  double bounds[6];
+  dataSet->GetBounds(bounds);
+  vtkPolyData *polyData = vtkPolyData::SafeDownCast(dataSet);
+  if (polyData && polyData->NeedToBuildCells())
+    {
+    polyData->BuildCells();
+    }
+}
+
+// Returns a new locator with a reference count of one.
+vtkLocator *BuildIndex(vtkDataSet *dataSet, int type)
+{
+  vtkLocator *index;
+  switch (type)
+    {
+    case vtkSpatialIndexRegistry::POINT_LOCATOR:
+      index = vtkStaticPointLocator::New();
+      break;
+    case vtkSpatialIndexRegistry::CELL_LOCATOR:
+      index = vtkStaticCellLocator::New();
+      break;
+    case vtkSpatialIndexRegistry::CELL_TREE:
+      index = vtkModifiedBSPTree::New();
+      break;
+    default:
+      index = vtkKdTreePointLocator::New();
+      break;
+    }
+  index->SetDataSet(dataSet);
+  index->BuildLocator();
+  return index;
+}
+
+// The locators do not report their size. These are the per point or per
+// cell costs of their main arrays, in KiB, good enough to bound the cache.
+unsigned long EstimateSize(vtkDataSet *dataSet, int type)
+{
+  double bytes;
+  switch (type)
+    {
+    case vtkSpatialIndexRegistry::POINT_LOCATOR:
+      // (point id, bin id) tuples and bin offsets
+      bytes = 3.0 * sizeof(vtkIdType) * dataSet->GetNumberOfPoints();
+      break;
+    case vtkSpatialIndexRegistry::CELL_LOCATOR:
+      // cell bounds, and each cell listed in a few bins
+      bytes = (6.0 * sizeof(double) + 8.0 * sizeof(vtkIdType)) *
+        dataSet->GetNumberOfCells();
+      break;
+    case vtkSpatialIndexRegistry::CELL_TREE:
+      // cell bounds and ids, and the tree nodes
+      bytes = (7.0 * sizeof(double) + 2.0 * sizeof(vtkIdType)) *
+        dataSet->GetNumberOfCells();
+      break;
+    default:
+      // a float copy of the points, ids and region lists
+      bytes = (3.0 * sizeof(float) + 2.0 * sizeof(vtkIdType)) *
+        dataSet->GetNumberOfPoints();
+      break;
+    }
+  return static_cast<unsigned long>(bytes / 1024.0) + 1;
+}
+
+class BuildIndices
+{
+public:
+  vtkDataSet *DataSet;
+  const int *Types;
+  vtkSmartPointer<vtkLocator> *Indices;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      this->Indices[i].TakeReference(BuildIndex(this->DataSet, this->Types[i]));
+      }
+  }
+};
+}
+
+//----------------------------------------------------------------------------
+vtkSpatialIndexRegistry::vtkSpatialIndexRegistry()
+{
+  this->MaximumMemorySize = 512 * 1024;
+  this->MemorySize = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkSpatialIndexRegistry::~vtkSpatialIndexRegistry()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSpatialIndexRegistry *vtkSpatialIndexRegistry::GetGlobalRegistry()
+{
+  static vtkSmartPointer<vtkSpatialIndexRegistry> registry =
+    vtkSmartPointer<vtkSpatialIndexRegistry>::New();
+  return registry;
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::SetMaximumMemorySize(unsigned long size)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (this->MaximumMemorySize != size)
+    {
+    this->MaximumMemorySize = size;
+    this->Evict();
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+std::list<vtkSpatialIndexRegistry::Entry>::iterator
+vtkSpatialIndexRegistry::FindEntry(vtkDataSet *dataSet, int type, vtkMTimeType time)
+{
+  // A slower thread may look up an older time than an entry already has;
+  // such entries are skipped, not dropped.
+  std::list<Entry>::iterator found = this->Entries.end();
+  std::list<Entry>::iterator entry = this->Entries.begin();
+  while (entry != this->Entries.end())
+    {
+    if (entry->DataSet == dataSet && entry->Type == type &&
+        entry->DataSetTime < time)
+      {
+      this->MemorySize -= entry->Size;
+      entry = this->Entries.erase(entry);
+      continue;
+      }
+    if (entry->DataSet == dataSet && entry->Type == type &&
+        entry->DataSetTime == time)
+      {
+      found = entry;
+      }
+    ++entry;
+    }
+  if (found != this->Entries.end())
+    {
+    this->Entries.splice(this->Entries.begin(), this->Entries, found);
+    }
+  return found;
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::AddPlaceholder(vtkDataSet *dataSet, int type,
+                                             vtkMTimeType time)
+{
+  Entry entry;
+  entry.DataSet = dataSet;
+  entry.Type = type;
+  entry.DataSetTime = time;
+  entry.Size = 0;
+  this->Entries.push_front(entry);
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::StoreIndex(vtkDataSet *dataSet, int type,
+                                         vtkMTimeType time, vtkLocator *index)
+{
+  // The placeholder is gone if the indices were released meanwhile.
+  std::list<Entry>::iterator entry = this->FindEntry(dataSet, type, time);
+  if (entry == this->Entries.end())
+    {
+    this->AddPlaceholder(dataSet, type, time);
+    entry = this->Entries.begin();
+    }
+  entry->Index = index;
+  entry->Size = EstimateSize(dataSet, type);
+  this->MemorySize += entry->Size;
+  this->Evict();
+  this->Built.notify_all();
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::Evict()
+{
+  // Least recently used first, keeping the front entry and the ones being
+  // built.
+  std::list<Entry>::iterator entry = this->Entries.end();
+  while (this->MemorySize > this->MaximumMemorySize && entry != this->Entries.begin())
+    {
+    --entry;
+    if (entry != this->Entries.begin() && entry->Index)
+      {
+      this->MemorySize -= entry->Size;
+      entry = this->Entries.erase(entry);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkLocator *vtkSpatialIndexRegistry::GetIndex(vtkDataSet *dataSet, int type)
+{
+  if (type < 0 || type >= NUMBER_OF_INDEX_TYPES)
+    {
+    vtkErrorMacro(<< "Invalid index type " << type);
+    return NULL;
+    }
+  if (!dataSet || IsEmpty(dataSet, type))
+    {
+    return NULL;
+    }
+
+  vtkMTimeType time = dataSet->GetMTime();
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  std::list<Entry>::iterator entry;
+  while ((entry = this->FindEntry(dataSet, type, time)) != this->Entries.end() &&
+         !entry->Index)
+    {
+    this->Built.wait(lock);
+    }
+  if (entry != this->Entries.end())
+    {
+    return entry->Index;
+    }
+  this->AddPlaceholder(dataSet, type, time);
+  PrepareDataSet(dataSet);
+
+  // Build without the lock, so requests for other indices are not held up.
+  lock.unlock();
+  vtkSmartPointer<vtkLocator> index;
+  index.TakeReference(BuildIndex(dataSet, type));
+  lock.lock();
+  this->StoreIndex(dataSet, type, time, index);
+  return index;
+}
+
+//----------------------------------------------------------------------------
+vtkAbstractPointLocator *vtkSpatialIndexRegistry::GetPointLocator(vtkDataSet *dataSet)
+{
+  return static_cast<vtkAbstractPointLocator*>(this->GetIndex(dataSet, POINT_LOCATOR));
+}
+
+//----------------------------------------------------------------------------
+vtkAbstractCellLocator *vtkSpatialIndexRegistry::GetCellLocator(vtkDataSet *dataSet)
+{
+  return static_cast<vtkAbstractCellLocator*>(this->GetIndex(dataSet, CELL_LOCATOR));
+}
+
+//----------------------------------------------------------------------------
+vtkAbstractCellLocator *vtkSpatialIndexRegistry::GetCellTree(vtkDataSet *dataSet)
+{
+  return static_cast<vtkAbstractCellLocator*>(this->GetIndex(dataSet, CELL_TREE));
+}
+
+//----------------------------------------------------------------------------
+vtkKdTreePointLocator *vtkSpatialIndexRegistry::GetKdTree(vtkDataSet *dataSet)
+{
+  return static_cast<vtkKdTreePointLocator*>(this->GetIndex(dataSet, KD_TREE));
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::Prefetch(vtkDataSet *dataSet, int typeMask)
+{
+  if (!dataSet)
+    {
+    return;
+    }
+
+  // Indices that another thread is building are left to it; waiting here
+  // while holding placeholders could deadlock with another Prefetch().
+  vtkMTimeType time = dataSet->GetMTime();
+  std::vector<int> types;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (int type = 0; type < NUMBER_OF_INDEX_TYPES; type++)
+    {
+    if ((typeMask & (1 << type)) && !IsEmpty(dataSet, type) &&
+        this->FindEntry(dataSet, type, time) == this->Entries.end())
+      {
+      this->AddPlaceholder(dataSet, type, time);
+      types.push_back(type);
+      }
+    }
+  if (types.empty())
+    {
+    return;
+    }
+  PrepareDataSet(dataSet);
+  }
+
+  std::vector<vtkSmartPointer<vtkLocator> > indices(types.size());
+  BuildIndices build;
+  build.DataSet = dataSet;
+  build.Types = &types[0];
+  build.Indices = &indices[0];
+  vtkSMPTools::For(0, static_cast<vtkIdType>(types.size()), 1, build);
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  for (size_t i = 0; i < types.size(); i++)
+    {
+    this->StoreIndex(dataSet, types[i], time, indices[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkSpatialIndexRegistry::GetNumberOfIndices()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return static_cast<int>(this->Entries.size());
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkSpatialIndexRegistry::GetMemorySize()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->MemorySize;
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::ReleaseIndices(vtkDataSet *dataSet)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  std::list<Entry>::iterator entry = this->Entries.begin();
+  while (entry != this->Entries.end())
+    {
+    if (entry->DataSet == dataSet)
+      {
+      this->MemorySize -= entry->Size;
+      entry = this->Entries.erase(entry);
+      }
+    else
+      {
+      ++entry;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::ReleaseIndices()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Entries.clear();
+  this->MemorySize = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSpatialIndexRegistry::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Maximum Memory Size: " << this->MaximumMemorySize << " KiB\n";
+  os << indent << "Number Of Indices: " << this->GetNumberOfIndices() << "\n";
+  os << indent << "Memory Size: " << this->GetMemorySize() << " KiB\n";
+}
@@ -0,0 +1,157 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSpatialIndexRegistry.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkSpatialIndexRegistry - shared cache of point and cell locators
+// .SECTION Description
+// vtkSpatialIndexRegistry builds spatial indices of datasets on demand and
+// hands the same instance to every consumer, so pickers, interpolators and
+// filters that search the same unchanged dataset stop rebuilding their own.
+// An index is keyed by the dataset and its MTime: when the dataset is
+// modified the next request builds a new index, and consumers still holding
+// the old one are not disturbed.
+//
+// Four kinds of index are available:
+//   POINT_LOCATOR  vtkStaticPointLocator, for closest point queries
+//   CELL_LOCATOR   vtkStaticCellLocator, for FindCell() style queries
+//   CELL_TREE      vtkModifiedBSPTree, a bounding volume hierarchy of the
+//                  cells for ray queries, e.g. vtkCellPicker::AddLocator()
+//   KD_TREE        vtkKdTreePointLocator
+// The static locators build in parallel with vtkSMPTools, and Prefetch()
+// builds several indices of a dataset at the same time.
+//
+// The indices are kept in a least-recently-used list bounded by
+// MaximumMemorySize. A cached index references its dataset, so the dataset
+// stays alive until the index is evicted or ReleaseIndices() is called. An
+// index returned by the registry is owned by it and valid until it is
+// evicted; keep a vtkSmartPointer to it to use it longer. Requests may come
+// from several threads, but another thread's request can then evict an
+// index before the caller has taken its reference, so MaximumMemorySize
+// should hold the working set.
+//
+// The indices are shared, so they must only be queried. Do not pass one to
+// a filter that calls SetDataSet() or BuildLocator() on its locator, such
+// as vtkPointInterpolator and vtkSPHInterpolator: that would rebuild it
+// under the other consumers.
+//
+// GetGlobalRegistry() returns a process-wide instance for consumers that
+// have no other way to share one.
+//
+// .SECTION See Also
+// vtkStaticPointLocator vtkStaticCellLocator vtkModifiedBSPTree
+// vtkKdTreePointLocator
+
+#ifndef __vtkSpatialIndexRegistry_h
+#define __vtkSpatialIndexRegistry_h
+
+#include "vtkObject.h"
+#include "vtkSmartPointer.h"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+
+class vtkAbstractCellLocator;
+class vtkAbstractPointLocator;
+class vtkDataSet;
+class vtkKdTreePointLocator;
+class vtkLocator;
+
+class vtkSpatialIndexRegistry : public vtkObject
+{
+public:
+  static vtkSpatialIndexRegistry *New();
+  vtkTypeMacro(vtkSpatialIndexRegistry, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  enum IndexType
+  {
+    POINT_LOCATOR = 0,
+    CELL_LOCATOR,
+    CELL_TREE,
+    KD_TREE,
+    NUMBER_OF_INDEX_TYPES
+  };
+
+  // Description:
+  // A registry shared by the whole process, created on first use.
+  static vtkSpatialIndexRegistry *GetGlobalRegistry();
+
+  // Description:
+  // The index of the given type for dataSet, built if it is missing or
+  // older than the dataset. Returns NULL for a NULL or empty dataset.
+  vtkLocator *GetIndex(vtkDataSet *dataSet, int type);
+  vtkAbstractPointLocator *GetPointLocator(vtkDataSet *dataSet);
+  vtkAbstractCellLocator *GetCellLocator(vtkDataSet *dataSet);
+  vtkAbstractCellLocator *GetCellTree(vtkDataSet *dataSet);
+  vtkKdTreePointLocator *GetKdTree(vtkDataSet *dataSet);
+
+  // Description:
+  // Build the missing indices of dataSet whose bit (1 << type) is set in
+  // typeMask, concurrently.
+  void Prefetch(vtkDataSet *dataSet, int typeMask);
+
+  // Description:
+  // Estimated memory, in KiB, that the cached indices may use before the
+  // least recently used ones are dropped. The most recent index is always
+  // kept. Default is 512 MiB.
+  virtual void SetMaximumMemorySize(unsigned long size);
+  vtkGetMacro(MaximumMemorySize, unsigned long);
+
+  // Description:
+  // The number of cached indices and their estimated memory in KiB.
+  int GetNumberOfIndices();
+  unsigned long GetMemorySize();
+
+  // Description:
+  // Drop the cached indices of dataSet, or all of them.
+  void ReleaseIndices(vtkDataSet *dataSet);
+  void ReleaseIndices();
+
+protected:
+  vtkSpatialIndexRegistry();
+  ~vtkSpatialIndexRegistry();
+
+  // An entry without an index is being built by some thread.
+  struct Entry
+  {
+    vtkDataSet *DataSet;
+    int Type;
+    vtkMTimeType DataSetTime;
+    vtkSmartPointer<vtkLocator> Index;
+    unsigned long Size;
+  };
+
+  // The entry of the index for time, built or being built, moved to the
+  // front; entries for older times are dropped. Called with the mutex held.
+  std::list<Entry>::iterator FindEntry(vtkDataSet *dataSet, int type,
+                                       vtkMTimeType time);
+  void AddPlaceholder(vtkDataSet *dataSet, int type, vtkMTimeType time);
+
+  // Store a built index in its placeholder, and wake up waiting threads.
+  void StoreIndex(vtkDataSet *dataSet, int type, vtkMTimeType time,
+                  vtkLocator *index);
+  void Evict();
+
+  std::list<Entry> Entries;
+  unsigned long MaximumMemorySize;
+  unsigned long MemorySize;
+  std::mutex Mutex;
+  std::condition_variable Built;
+
+private:
+  vtkSpatialIndexRegistry(const vtkSpatialIndexRegistry&);  // Not implemented.
+  void operator=(const vtkSpatialIndexRegistry&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,171 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkTypedTupleAccess.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkTypedTupleAccess - typed, in-place access to point and attribute arrays
+// .SECTION Description
+// Header-only helpers shared by the filters in Application/. Instead of
+// calling vtkDataSet::GetPoint() or vtkDataArray::SetTuple() once per
+// element, a filter writes its inner loop as a worker with a templated
+// operator() and hands it to vtkDispatchTuples() or vtkDispatchPoints().
+// These call the worker with a tuple accessor for the concrete storage:
+//
+//   vtkTypedTuples<float>     contiguous float tuples, accessed in place
+//   vtkTypedTuples<double>    contiguous double tuples, accessed in place
+//   vtkGenericTuples          any other vtkDataArray, through its virtuals
+//   vtkDataSetPointTuples     points of datasets without a vtkPoints
+//
+// All accessors provide GetTuple(i, double*), SetTuple(i, const double*)
+// (except the dataset one) and GetNumberOfTuples(), so the worker is
+// compiled once per storage type and the float/double loops inline to
+// plain pointer arithmetic.
+//
+//   struct BoundsWorker
+//   {
+//     template <class Points> void operator()(const Points& points) { ... }
+//   };
+//   BoundsWorker worker;
+//   vtkDispatchPoints(input, worker);
+
+#ifndef __vtkTypedTupleAccess_h
+#define __vtkTypedTupleAccess_h
+
+#include "vtkDataArray.h"
+#include "vtkDataSet.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkPoints.h"
+#include "vtkPointSet.h"
+
+template <class ValueType>
+class vtkTypedTuples
+{
+public:
+  vtkTypedTuples(ValueType *data, int numComps, vtkIdType numTuples)
+    : Data(data), NumberOfComponents(numComps), NumberOfTuples(numTuples) {}
+
+  vtkIdType GetNumberOfTuples() const { return this->NumberOfTuples; }
+  int GetNumberOfComponents() const { return this->NumberOfComponents; }
+
+  // Pointer to the first component of tuple i.
+  ValueType *operator[](vtkIdType i) const
+  {
+    return this->Data + i*this->NumberOfComponents;
+  }
+
+  void GetTuple(vtkIdType i, double *tuple) const
+  {
+    const ValueType *t = (*this)[i];
+    for (int c = 0; c < this->NumberOfComponents; c++)
+      {
+      tuple[c] = static_cast<double>(t[c]);
+      }
+  }
+
+  void SetTuple(vtkIdType i, const double *tuple) const
+  {
+    ValueType *t = (*this)[i];
+    for (int c = 0; c < this->NumberOfComponents; c++)
+      {
+      t[c] = static_cast<ValueType>(tuple[c]);
+      }
+  }
+
+private:
+  ValueType *Data;
+  int NumberOfComponents;
+  vtkIdType NumberOfTuples;
+};
+
+class vtkGenericTuples
+{
+public:
+  vtkGenericTuples(vtkDataArray *array) : Array(array) {}
+
+  vtkIdType GetNumberOfTuples() const { return this->Array->GetNumberOfTuples(); }
+  int GetNumberOfComponents() const { return this->Array->GetNumberOfComponents(); }
+
+  void GetTuple(vtkIdType i, double *tuple) const
+  {
+    this->Array->GetTuple(i, tuple);
+  }
+
+  void SetTuple(vtkIdType i, const double *tuple) const
+  {
+    this->Array->SetTuple(i, tuple);
+  }
+
+private:
+  vtkDataArray *Array;
+};
+
+class vtkDataSetPointTuples
+{
+public:
+  vtkDataSetPointTuples(vtkDataSet *dataSet) : DataSet(dataSet) {}
+
+  vtkIdType GetNumberOfTuples() const { return this->DataSet->GetNumberOfPoints(); }
+  int GetNumberOfComponents() const { return 3; }
+
+  void GetTuple(vtkIdType i, double *tuple) const
+  {
+    this->DataSet->GetPoint(i, tuple);
+  }
+
+private:
+  vtkDataSet *DataSet;
+};
+
+// Calls worker(tuples) with the fastest accessor for array.
+template <class Worker>
+void vtkDispatchTuples(vtkDataArray *array, Worker &worker)
+{
+  if (vtkFloatArray *floats = vtkFloatArray::SafeDownCast(array))
+    {
+    worker(vtkTypedTuples<float>(floats->GetPointer(0),
+      floats->GetNumberOfComponents(), floats->GetNumberOfTuples()));
+    }
+  else if (vtkDoubleArray *doubles = vtkDoubleArray::SafeDownCast(array))
+    {
+    worker(vtkTypedTuples<double>(doubles->GetPointer(0),
+      doubles->GetNumberOfComponents(), doubles->GetNumberOfTuples()));
+    }
+  else
+    {
+    worker(vtkGenericTuples(array));
+    }
+}
+
+// Calls worker(points) with the fastest accessor for the points of
+// dataSet. Datasets with implicit points (e.g. vtkImageData) are read
+// through GetPoint(), which is safe to call from several threads once it
+// has been called once; that first call is made here.
+template <class Worker>
+void vtkDispatchPoints(vtkDataSet *dataSet, Worker &worker)
+{
+  vtkPointSet *pointSet = vtkPointSet::SafeDownCast(dataSet);
+  if (pointSet && pointSet->GetPoints())
+    {
+    vtkDispatchTuples(pointSet->GetPoints()->GetData(), worker);
+    return;
+    }
+
+  if (dataSet->GetNumberOfPoints() > 0)
+    {
+    double p[3];
+    dataSet->GetPoint(0, p);
+    }
+  worker(vtkDataSetPointTuples(dataSet));
+}
+
+#endif
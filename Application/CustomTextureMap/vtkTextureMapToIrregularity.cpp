@@ -5,15 +5,163 @@
 #include "vtkCellData.h"
 #include "vtkMath.h"
 #include "vtkFloatArray.h"
+#include "vtkImplicitTCoordsArray.h"
 #include "vtkPointData.h"
+#include "vtkPointSet.h"
+#include "vtkPoints.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkTypedTupleAccess.h"
 
 vtkStandardNewMacro(vtkTextureMapToIrregularity);
 
+namespace
+{
+// Projects points [begin, end) onto Vector, caching each projection in the
+// t slot of the texture coordinate array, and tracks the per-thread range.
+// With no TCoords only the range is computed.
+template <class PointSource>
+class ProjectPoints
+{
+public:
+	const PointSource* Points;
+	const double* Vector;
+	float* TCoords;
+	vtkSMPThreadLocal<double> LocalMin;
+	vtkSMPThreadLocal<double> LocalMax;
+	double MinProjection;
+	double MaxProjection;
+
+	ProjectPoints() : LocalMin(VTK_DOUBLE_MAX), LocalMax(-VTK_DOUBLE_MAX),
+		MinProjection(VTK_DOUBLE_MAX), MaxProjection(-VTK_DOUBLE_MAX) {}
+
+	void Initialize()
+	{
+		this->LocalMin.Local() = VTK_DOUBLE_MAX;
+		this->LocalMax.Local() = -VTK_DOUBLE_MAX;
+	}
+
+	void operator()(vtkIdType begin, vtkIdType end)
+	{
+		const double v[3] = { this->Vector[0], this->Vector[1], this->Vector[2] };
+		float* tc = this->TCoords;
+		double& minProjection = this->LocalMin.Local();
+		double& maxProjection = this->LocalMax.Local();
+		for (vtkIdType i = begin; i < end; i++) {
+			double pos[3];
+			this->Points->GetTuple(i, pos);
+			double projection = pos[0] * v[0] + pos[1] * v[1] + pos[2] * v[2];
+			if (projection < minProjection)
+				minProjection = projection;
+			if (projection > maxProjection)
+				maxProjection = projection;
+			if (tc) {
+				tc[2 * i] = 0.0f;
+				tc[2 * i + 1] = static_cast<float>(projection);
+			}
+		}
+	}
+
+	void Reduce()
+	{
+		for (vtkSMPThreadLocal<double>::iterator it = this->LocalMin.begin(); it != this->LocalMin.end(); ++it)
+			if (*it < this->MinProjection)
+				this->MinProjection = *it;
+		for (vtkSMPThreadLocal<double>::iterator it = this->LocalMax.begin(); it != this->LocalMax.end(); ++it)
+			if (*it > this->MaxProjection)
+				this->MaxProjection = *it;
+	}
+};
+
+// Runs ProjectPoints over whichever point storage the input has.
+class ProjectPointsWorker
+{
+public:
+	const double* Vector;
+	float* TCoords;
+	double MinProjection;
+	double MaxProjection;
+
+	template <class PointSource>
+	void operator()(const PointSource& points)
+	{
+		ProjectPoints<PointSource> project;
+		project.Points = &points;
+		project.Vector = this->Vector;
+		project.TCoords = this->TCoords;
+		vtkSMPTools::For(0, points.GetNumberOfTuples(), project);
+		this->MinProjection = project.MinProjection;
+		this->MaxProjection = project.MaxProjection;
+	}
+};
+
+// Maps the cached projections to t = (p - offset) * scale, clamped to [0, 1].
+// The loop body is branch free so that it vectorizes.
+class NormalizeProjections
+{
+public:
+	float* TCoords;
+	float Offset;
+	float Scale;
+
+	void operator()(vtkIdType begin, vtkIdType end)
+	{
+		float* tc = this->TCoords;
+		const float offset = this->Offset;
+		const float scale = this->Scale;
+		for (vtkIdType i = begin; i < end; i++) {
+			float t = (tc[2 * i + 1] - offset) * scale;
+			t = t < 0.0f ? 0.0f : t;
+			tc[2 * i + 1] = t > 1.0f ? 1.0f : t;
+		}
+	}
+};
+
+// Evaluates the texture coordinates of a single point for
+// vtkImplicitTCoordsArray, with the same rounding as NormalizeProjections.
+class IrregularityTCoordsFunction : public vtkTCoordsFunction
+{
+public:
+	double Vector[3];
+	float Offset;
+	float Scale;
+
+	void Evaluate(const double x[3], float tc[2]) const
+	{
+		float projection = static_cast<float>(x[0] * this->Vector[0] + x[1] * this->Vector[1] + x[2] * this->Vector[2]);
+		float t = (projection - this->Offset) * this->Scale;
+		t = t < 0.0f ? 0.0f : t;
+		tc[0] = 0.0f;
+		tc[1] = t > 1.0f ? 1.0f : t;
+	}
+};
+
+// Modification time of the geometry the texture coordinates depend on.
+vtkMTimeType GetGeometryTime(vtkDataSet* input)
+{
+	vtkPointSet* pointSet = vtkPointSet::SafeDownCast(input);
+	if (pointSet && pointSet->GetPoints())
+		return pointSet->GetPoints()->GetMTime();
+	return input->GetMTime();
+}
+}
+
 vtkTextureMapToIrregularity::vtkTextureMapToIrregularity()
 {
 	this->Vector[0] = 0.0;
 	this->Vector[1] = 1.0;
 	this->Vector[2] = 0.0;
+	this->ReuseTextureCoordinates = 0;
+	this->ImplicitTCoords = 0;
+	this->CachedTCoords = NULL;
+	this->CachedGeometryTime = 0;
+	this->CachedVector[0] = this->CachedVector[1] = this->CachedVector[2] = 0.0;
+}
+
+vtkTextureMapToIrregularity::~vtkTextureMapToIrregularity()
+{
+	if (this->CachedTCoords)
+		this->CachedTCoords->Delete();
 }
 
 int vtkTextureMapToIrregularity::RequestData(vtkInformation *vtkNotUsed(request), vtkInformationVector **inputVector, vtkInformationVector *outputVector)
@@ -34,30 +182,76 @@ int vtkTextureMapToIrregularity::RequestData(vtkInformation *vtkNotUsed(request)
 		return 1;
 	}
 
-	double minProjection = VTK_DOUBLE_MAX;
-	double maxProjection = VTK_DOUBLE_MIN;
-	for (int i = 0; i < input->GetNumberOfPoints(); i++) {
-		double pos[3];
-		input->GetPoint(i, pos);
-		double projection = vtkMath::Dot(pos, this->Vector);
-		if (projection < minProjection)
-			minProjection = projection;
-		if (projection > maxProjection)
-			maxProjection = projection;
-    }
-
-	vtkFloatArray* tCoords = vtkFloatArray::New();
-	tCoords->SetNumberOfComponents(2);
-	for (int i = 0; i < input->GetNumberOfPoints(); i++){
-		double pos[3];
-		input->GetPoint(i, pos);
-		double projection = vtkMath::Dot(pos, this->Vector);
-		double t = (projection - minProjection) / (maxProjection - minProjection);
-		if (t > 1.0)
-			t = 1.0;
-		if (t < 0.0)
-			t = 0.0;
-		tCoords->InsertNextTuple2(0, t);
+	vtkIdType numPts = input->GetNumberOfPoints();
+	vtkMTimeType geometryTime = GetGeometryTime(input);
+
+	bool reuse = this->ReuseTextureCoordinates && this->CachedTCoords &&
+		this->CachedTCoords->GetNumberOfTuples() == numPts &&
+		(vtkImplicitTCoordsArray::SafeDownCast(this->CachedTCoords) != NULL) == (this->ImplicitTCoords != 0) &&
+		this->CachedGeometryTime == geometryTime &&
+		this->CachedVector[0] == this->Vector[0] &&
+		this->CachedVector[1] == this->Vector[1] &&
+		this->CachedVector[2] == this->Vector[2];
+
+	vtkDataArray* tCoords;
+	if (reuse) {
+		tCoords = this->CachedTCoords;
+		tCoords->Register(this);
+	}
+	else if (this->ImplicitTCoords) {
+		// Only the range is needed up front; the coordinates themselves are
+		// evaluated whenever the array is read.
+		ProjectPointsWorker project;
+		project.Vector = this->Vector;
+		project.TCoords = NULL;
+		vtkDispatchPoints(input, project);
+
+		double range = project.MaxProjection - project.MinProjection;
+		IrregularityTCoordsFunction* function = new IrregularityTCoordsFunction;
+		for (int i = 0; i < 3; i++)
+			function->Vector[i] = this->Vector[i];
+		function->Offset = static_cast<float>(project.MinProjection);
+		function->Scale = range > 0.0 ? static_cast<float>(1.0 / range) : 0.0f;
+
+		vtkImplicitTCoordsArray* implicitTCoords = vtkImplicitTCoordsArray::New();
+		implicitTCoords->SetName("Texture Coordinates");
+		implicitTCoords->SetGeometry(input, function);
+		tCoords = implicitTCoords;
+	}
+	else {
+		vtkFloatArray* tcoordArray = vtkFloatArray::New();
+		tcoordArray->SetName("Texture Coordinates");
+		tcoordArray->SetNumberOfComponents(2);
+		tcoordArray->SetNumberOfTuples(numPts);
+		float* tc = tcoordArray->GetPointer(0);
+
+		// The projections are cached in the t slots of the output array, so
+		// the points are read once and no scratch buffer is needed.
+		ProjectPointsWorker project;
+		project.Vector = this->Vector;
+		project.TCoords = tc;
+		vtkDispatchPoints(input, project);
+
+		double range = project.MaxProjection - project.MinProjection;
+		NormalizeProjections normalize;
+		normalize.TCoords = tc;
+		normalize.Offset = static_cast<float>(project.MinProjection);
+		normalize.Scale = range > 0.0 ? static_cast<float>(1.0 / range) : 0.0f;
+		vtkSMPTools::For(0, numPts, normalize);
+		tCoords = tcoordArray;
+	}
+
+	if (!reuse) {
+		if (this->CachedTCoords)
+			this->CachedTCoords->Delete();
+		this->CachedTCoords = NULL;
+		if (this->ReuseTextureCoordinates) {
+			this->CachedTCoords = tCoords;
+			this->CachedTCoords->Register(this);
+			this->CachedGeometryTime = geometryTime;
+			for (int i = 0; i < 3; i++)
+				this->CachedVector[i] = this->Vector[i];
+		}
 	}
 
 	// Update ourselves
@@ -66,7 +260,7 @@ int vtkTextureMapToIrregularity::RequestData(vtkInformation *vtkNotUsed(request)
 	output->GetCellData()->PassData(input->GetCellData());
 
 	output->GetPointData()->SetTCoords(tCoords);
-	tCoords->Delete();
+	tCoords->UnRegister(this);
 
 	return 1;
 
@@ -78,14 +272,22 @@ void vtkTextureMapToIrregularity::PrintSelf(ostream& os, vtkIndent indent)
 	this->Superclass::PrintSelf(os, indent);
 	os << indent << "Origin: (" << this->Vector[0] << ", "
 		<< this->Vector[1] << ", " << this->Vector[2] << " )\n";
+	os << indent << "Reuse Texture Coordinates: "
+		<< (this->ReuseTextureCoordinates ? "On\n" : "Off\n");
+	os << indent << "Implicit TCoords: "
+		<< (this->ImplicitTCoords ? "On\n" : "Off\n");
 }
 
 void vtkTextureMapToIrregularity::SetVector(double vector[3])
 {
 	if (vector)	{
-		for (size_t i = 0; i < 3; i++)
-			this->Vector[0] = vector[0];
-		vtkMath::Normalize(this->Vector);
+		double v[3] = { vector[0], vector[1], vector[2] };
+		vtkMath::Normalize(v);
+		if (v[0] != this->Vector[0] || v[1] != this->Vector[1] || v[2] != this->Vector[2]) {
+			for (size_t i = 0; i < 3; i++)
+				this->Vector[i] = v[i];
+			this->Modified();
+		}
 	}
 
 }
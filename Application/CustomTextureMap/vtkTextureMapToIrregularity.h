@@ -3,6 +3,8 @@
 
 #include "vtkDataSetAlgorithm.h"
 
+class vtkDataArray;
+
 class vtkTextureMapToIrregularity : public vtkDataSetAlgorithm
 {
 public:
@@ -12,16 +14,35 @@ public:
 	// Description: project points of dataset to textureAxis
 	void SetVector(double vector[3]);
 	vtkGetVectorMacro(Vector, double, 3);
+	// Description: keep the last texture coordinates and hand them out again
+	// while neither the input points nor Vector have changed. This pays off
+	// when the filter re-executes because the input was modified without
+	// moving its points, e.g. new scalars or cells on the same vtkPoints;
+	// the texture image is not an input, so swapping it re-executes nothing.
+	vtkSetMacro(ReuseTextureCoordinates, int);
+	vtkGetMacro(ReuseTextureCoordinates, int);
+	vtkBooleanMacro(ReuseTextureCoordinates, int);
+	// Description: produce a vtkImplicitTCoordsArray that evaluates the
+	// texture coordinates from the point positions on access instead of a
+	// stored float array.
+	vtkSetMacro(ImplicitTCoords, int);
+	vtkGetMacro(ImplicitTCoords, int);
+	vtkBooleanMacro(ImplicitTCoords, int);
 
 protected:
 	vtkTextureMapToIrregularity();
-	~vtkTextureMapToIrregularity() {}
+	~vtkTextureMapToIrregularity();
 	int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
 
 private:
 	vtkTextureMapToIrregularity(const vtkTextureMapToIrregularity&);  // Not implemented.
 	void operator=(const vtkTextureMapToIrregularity&);  // Not implemented.
 	double Vector[3];
+	int ReuseTextureCoordinates;
+	int ImplicitTCoords;
 
+	vtkDataArray* CachedTCoords;
+	vtkMTimeType CachedGeometryTime;
+	double CachedVector[3];
 };
 #endif // !__vtkTextureMapToIrregularity_h
@@ -17,11 +17,17 @@
 #include "vtkCellData.h"
 #include "vtkDataSet.h"
 #include "vtkFloatArray.h"
+#include "vtkImplicitTCoordsArray.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkTypedTupleAccess.h"
+
+#include <algorithm>
 
 vtkStandardNewMacro(vtkTextureMapToSurface);
 
@@ -42,6 +48,173 @@ vtkTextureMapToSurface::vtkTextureMapToSurface()
 
   this->TRange[0] = 0.0;
   this->TRange[1] = 1.0;
+
+  this->ImplicitTCoords = 0;
+}
+
+namespace
+{
+// Projects p onto the datum plane through o with normal n (nn = |n|^2)
+// and returns the unnormalized (s, t) pair: the components of PQ along and
+// across the direction from q (Point2) to the projected point.
+inline void ProjectToDatum(const double p[3], const double o[3],
+  const double q[3], const double n[3], double nn, double &s, double &t)
+{
+  double k = (n[0]*(o[0] - p[0]) + n[1]*(o[1] - p[1]) + n[2]*(o[2] - p[2])) / nn;
+  double projectPoint[3] = { p[0] + k*n[0], p[1] + k*n[1], p[2] + k*n[2] };
+
+  double PQ[3] = { projectPoint[0] - o[0], projectPoint[1] - o[1], projectPoint[2] - o[2] };
+  double S[3] = { projectPoint[0] - q[0], projectPoint[1] - q[1], projectPoint[2] - q[2] };
+  double L = sqrt(PQ[0]*PQ[0] + PQ[1]*PQ[1] + PQ[2]*PQ[2]);
+  double SL = sqrt(S[0]*S[0] + S[1]*S[1] + S[2]*S[2]);
+  double cos = (L > 0.0 && SL > 0.0) ?
+    (PQ[0]*S[0] + PQ[1]*S[1] + PQ[2]*S[2]) / (SL * L) : 1.0;
+  cos = vtkMath::ClampValue(cos, -1.0, 1.0);
+  double sin = sqrt(1.0 - cos*cos);
+
+  s = L * cos;
+  t = L * sin;
+}
+
+// Projects points [begin, end) onto the datum plane and writes the
+// unnormalized (s, t) pair of each one straight into the texture
+// coordinate array, tracking the per-thread maxima of s and t. With no
+// TCoords only the maxima are computed.
+template <class PointSource>
+class ProjectPoints
+{
+public:
+  const PointSource *Points;
+  const double *Origin;
+  const double *Point2;
+  const double *Normal;
+  float *TCoords;
+  vtkSMPThreadLocal<double> SMax;
+  vtkSMPThreadLocal<double> TMax;
+  double Smax;
+  double Tmax;
+
+  ProjectPoints() : SMax(0.0), TMax(0.0), Smax(0.0), Tmax(0.0) {}
+
+  void Initialize()
+  {
+    this->SMax.Local() = 0.0;
+    this->TMax.Local() = 0.0;
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const double *o = this->Origin;
+    const double *q = this->Point2;
+    const double *n = this->Normal;
+    const double nn = n[0]*n[0] + n[1]*n[1] + n[2]*n[2];
+    double &smax = this->SMax.Local();
+    double &tmax = this->TMax.Local();
+
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      double p[3], s, t;
+      this->Points->GetTuple(i, p);
+      ProjectToDatum(p, o, q, n, nn, s, t);
+      if (smax < s)
+        {
+        smax = s;
+        }
+      if (tmax < t)
+        {
+        tmax = t;
+        }
+
+      if (this->TCoords)
+        {
+        this->TCoords[2*i] = static_cast<float>(s);
+        this->TCoords[2*i+1] = static_cast<float>(t);
+        }
+      }
+  }
+
+  void Reduce()
+  {
+    this->Smax = 0.0;
+    this->Tmax = 0.0;
+    for (vtkSMPThreadLocal<double>::iterator it = this->SMax.begin(); it != this->SMax.end(); ++it)
+      {
+      this->Smax = std::max(this->Smax, *it);
+      }
+    for (vtkSMPThreadLocal<double>::iterator it = this->TMax.begin(); it != this->TMax.end(); ++it)
+      {
+      this->Tmax = std::max(this->Tmax, *it);
+      }
+  }
+};
+
+// Scales every (s, t) pair by (sScale, tScale).
+class NormalizeTCoords
+{
+public:
+  float *TCoords;
+  float SScale;
+  float TScale;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    float *tc = this->TCoords;
+    const float sScale = this->SScale;
+    const float tScale = this->TScale;
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      tc[2*i] *= sScale;
+      tc[2*i+1] *= tScale;
+      }
+  }
+};
+
+// Evaluates the normalized (s, t) pair of a single point for
+// vtkImplicitTCoordsArray.
+class SurfaceTCoordsFunction : public vtkTCoordsFunction
+{
+public:
+  double Origin[3];
+  double Point2[3];
+  double Normal[3];
+  double NN;
+  double SScale;
+  double TScale;
+
+  void Evaluate(const double x[3], float tc[2]) const
+  {
+    double s, t;
+    ProjectToDatum(x, this->Origin, this->Point2, this->Normal, this->NN, s, t);
+    tc[0] = static_cast<float>(s * this->SScale);
+    tc[1] = static_cast<float>(t * this->TScale);
+  }
+};
+
+// Runs ProjectPoints over whichever point storage the input has.
+class ProjectPointsWorker
+{
+public:
+  const double *Origin;
+  const double *Point2;
+  const double *Normal;
+  float *TCoords;
+  double Smax;
+  double Tmax;
+
+  template <class PointSource>
+  void operator()(const PointSource &points)
+  {
+    ProjectPoints<PointSource> project;
+    project.Points = &points;
+    project.Origin = this->Origin;
+    project.Point2 = this->Point2;
+    project.Normal = this->Normal;
+    project.TCoords = this->TCoords;
+    vtkSMPTools::For(0, points.GetNumberOfTuples(), project);
+    this->Smax = project.Smax;
+    this->Tmax = project.Tmax;
+  }
+};
 }
 
 int vtkTextureMapToSurface::RequestData(
@@ -59,14 +232,8 @@ int vtkTextureMapToSurface::RequestData(
   vtkDataSet *output = vtkDataSet::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  double tcoords[2];
   vtkIdType numPts;
-  vtkFloatArray *newTCoords;
-  vtkFloatArray *tempTCoords;
-  vtkIdType i;
-  int dir = 0;
-  double p[3];
-  int abort=0;
+  vtkDataArray *newTCoords;
 
   vtkDebugMacro(<<"Generating texture coordinates!");
 
@@ -79,88 +246,80 @@ int vtkTextureMapToSurface::RequestData(
     return 1;
     }
 
-  //  Allocate texture data
-  newTCoords = vtkFloatArray::New();
-  newTCoords->SetName("Texture Coordinates");
-  newTCoords->SetNumberOfComponents(2);
-  newTCoords->SetNumberOfTuples(numPts);
-
-  tempTCoords = vtkFloatArray::New();
-  tempTCoords->SetName("Temp Texture Coordinate");
-  tempTCoords->SetNumberOfComponents(2);
-  tempTCoords->SetNumberOfTuples(numPts);
-
-
   //  Poitnt1 can not be equal to Point2
   if ( this->Point1[0] == this->Point2[0]  && this->Point1[1] == this->Point2[1])
     {
-		vtkErrorMacro(<< "Error: point1 or point2\n");
-		return 1;
+    vtkErrorMacro(<< "Error: point1 or point2\n");
+    return 1;
     }
   this->ComputeNormal();
 
-  //  Now project each point onto datum plane 
-  double Smax = 0;
-  double Tmax = 0;
-  for (int i = 0; i < numPts; i++)
-  {
-	  output->GetPoint(i, p);
-	  double projectPoint[3];
-	  double k;
-	  k = (this->Normal[0]*(this->Origin[0] - p[0]) + this->Normal[1]*(this->Origin[1] - p[1]) + this->Normal[2]*(this->Origin[2] - p[2])) /(this->Normal[0] * this->Normal[0] + this->Normal[1] * this->Normal[1] + this->Normal[2] * this->Normal[2]);
-	  for (int j = 0; j<3; j++)
-	  {
-		  projectPoint[j] = p[j] + k * this->Normal[j];
-		  //Calculate texture coordinate
-		  double PQ[3];
-		  PQ[0] = projectPoint[0] - this->Origin[0];
-		  PQ[1] = projectPoint[1] - this->Origin[1];
-		  PQ[2] = projectPoint[2] - this->Origin[2];
-		  double S[3];
-		  S[0] = projectPoint[0] - this->Point2[0];
-		  S[1] = projectPoint[1] - this->Point2[1];
-		  S[2] = projectPoint[2] - this->Point2[2];
-		  double L = sqrt(PQ[0]*PQ[0] + PQ[1]*PQ[1]  + PQ[2]*PQ[2]);
-		  double SL = sqrt(S[0]*S[0] + S[1]*S[1]  + S[2]*S[2]);
-          double cos =  (PQ[0]* S[0] + PQ[1]* S[1] + PQ[2]* S[2]) / (SL * L);
-		  double sin = sqrt(1- cos*cos);
-		  tcoords[0] = L *cos;
-		  tcoords[1] = L * sin;
-          if (Smax < tcoords[0])
-          {
-			  Smax = tcoords[0];
-          }
-		  if (Tmax < tcoords[1])
-		  {
-			  Tmax = tcoords[1];
-		  }
-		  tempTCoords->SetTuple(i, tcoords);
-
-	  }
-  }
-   
-    // compute s-t coordinates
-    for (i=0; i < numPts; i++) 
+  if (this->ImplicitTCoords)
     {
-		tempTCoords->GetTuple(i,tcoords);
-		//s-coordinate
-		tcoords[0] = tcoords[0] / Smax;
-		//t-coordinate
-		tcoords[1] = tcoords[1] / Tmax;;
-
-		newTCoords->SetTuple(i,tcoords);
-    
+    //  Only the maxima are needed up front; the coordinates themselves are
+    //  evaluated whenever the array is read.
+    ProjectPointsWorker worker;
+    worker.Origin = this->Origin;
+    worker.Point2 = this->Point2;
+    worker.Normal = this->Normal;
+    worker.TCoords = NULL;
+    vtkDispatchPoints(input, worker);
+
+    SurfaceTCoordsFunction *function = new SurfaceTCoordsFunction;
+    const double *n = this->Normal;
+    for (int i = 0; i < 3; i++)
+      {
+      function->Origin[i] = this->Origin[i];
+      function->Point2[i] = this->Point2[i];
+      function->Normal[i] = n[i];
+      }
+    function->NN = n[0]*n[0] + n[1]*n[1] + n[2]*n[2];
+    function->SScale = worker.Smax > 0.0 ? 1.0 / worker.Smax : 0.0;
+    function->TScale = worker.Tmax > 0.0 ? 1.0 / worker.Tmax : 0.0;
+
+    vtkImplicitTCoordsArray *implicitTCoords = vtkImplicitTCoordsArray::New();
+    implicitTCoords->SetName("Texture Coordinates");
+    implicitTCoords->SetGeometry(input, function);
+    newTCoords = implicitTCoords;
     }
-	// Update ourselves
-	output->GetPointData()->CopyTCoordsOff();
-	output->GetPointData()->PassData(input->GetPointData());
-	output->GetCellData()->PassData(input->GetCellData());
+  else
+    {
+    //  Allocate texture data
+    vtkFloatArray *tcoordArray = vtkFloatArray::New();
+    tcoordArray->SetName("Texture Coordinates");
+    tcoordArray->SetNumberOfComponents(2);
+    tcoordArray->SetNumberOfTuples(numPts);
+    float *tcoords = tcoordArray->GetPointer(0);
+
+    //  Now project each point onto datum plane in one parallel pass, reading
+    //  the point coordinates in place where the dataset stores them.
+    ProjectPointsWorker worker;
+    worker.Origin = this->Origin;
+    worker.Point2 = this->Point2;
+    worker.Normal = this->Normal;
+    worker.TCoords = tcoords;
+    vtkDispatchPoints(input, worker);
+    double Smax = worker.Smax;
+    double Tmax = worker.Tmax;
+
+    // compute s-t coordinates
+    NormalizeTCoords normalize;
+    normalize.TCoords = tcoords;
+    normalize.SScale = static_cast<float>(Smax > 0.0 ? 1.0 / Smax : 0.0);
+    normalize.TScale = static_cast<float>(Tmax > 0.0 ? 1.0 / Tmax : 0.0);
+    vtkSMPTools::For(0, numPts, normalize);
+    newTCoords = tcoordArray;
+    }
+
+  // Update ourselves
+  output->GetPointData()->CopyTCoordsOff();
+  output->GetPointData()->PassData(input->GetPointData());
+  output->GetCellData()->PassData(input->GetCellData());
 
-	output->GetPointData()->SetTCoords(newTCoords);
-	newTCoords->Delete();
-	tempTCoords->Delete();
+  output->GetPointData()->SetTCoords(newTCoords);
+  newTCoords->Delete();
 
-	return 1;
+  return 1;
 }
 
 #define VTK_TOLERANCE 1.0e-03
@@ -197,4 +356,6 @@ void vtkTextureMapToSurface::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Normal: (" << this->Normal[0] << ", "
                                 << this->Normal[1] << ", "
                                 << this->Normal[2] << ")\n";
+  os << indent << "Implicit TCoords: "
+     << (this->ImplicitTCoords ? "On\n" : "Off\n");
 }
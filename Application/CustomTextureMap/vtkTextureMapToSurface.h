@@ -71,6 +71,14 @@ public:
   vtkSetVector2Macro(TRange,double);
   vtkGetVectorMacro(TRange,double,2);
 
+  // Description:
+  // When on, the output carries a vtkImplicitTCoordsArray that computes the
+  // texture coordinates from the point positions on access instead of a
+  // stored float array. Off by default.
+  vtkSetMacro(ImplicitTCoords,int);
+  vtkGetMacro(ImplicitTCoords,int);
+  vtkBooleanMacro(ImplicitTCoords,int);
+
   // Description:
   // Turn on/off automatic plane generation.
   //vtkSetMacro(AutomaticPlaneGeneration,int);
@@ -90,6 +98,7 @@ protected:
   double Normal[3];
   double SRange[2];
   double TRange[2];
+  int ImplicitTCoords;
 
 private:
   vtkTextureMapToSurface(const vtkTextureMapToSurface&);  // Not implemented.
@@ -5,9 +5,40 @@
 #include "vtkInformation.h"
 #include "vtkDataObject.h"
 #include "vtkSmartPointer.h"
+#include "vtkMath.h"
+#include "vtkProgressReporter.h"
+#include "vtkTypedTupleAccess.h"
+
+#include <algorithm>
+#include <cmath>
 
 vtkStandardNewMacro(vtkReportProgressFilter);
 
+namespace
+{
+//squared distance of the farthest point from Center, reading the points
+//in place through the accessor chosen by vtkDispatchPoints()
+struct FarthestPointWorker
+{
+	const double* Center;
+	vtkProgressReporter* Progress;
+	double MaxDistance2;
+
+	template <class Points>
+	void operator()(const Points& points)
+	{
+		vtkIdType numPts = points.GetNumberOfTuples();
+		for(vtkIdType i = 0; i < numPts && this->Progress->Update(i); i++)
+		{
+			double point[3];
+			points.GetTuple(i, point);
+			this->MaxDistance2 = std::max(this->MaxDistance2,
+				vtkMath::Distance2BetweenPoints(point, this->Center));
+		}
+	}
+};
+}
+
 int vtkReportProgressFilter::RequestData(vtkInformation *vtkNotUsed(request),
 										 vtkInformationVector **inputVector,
 										 vtkInformationVector *outputVector)
@@ -21,10 +52,18 @@ int vtkReportProgressFilter::RequestData(vtkInformation *vtkNotUsed(request),
 	vtkPolyData *output = vtkPolyData::SafeDownCast(
 		outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-	for(vtkIdType i = 0; i < input->GetNumberOfPoints(); i++)
-	{
-		this->UpdateProgress(static_cast<double>(i)/input->GetNumberOfPoints());
-	}
+	//the per-point work only measures the farthest point from the centre
+	//of the bounds; the output is the input, unchanged
+	double center[3];
+	input->GetCenter(center);
+	vtkProgressReporter progress(this, input->GetNumberOfPoints());
+	FarthestPointWorker farthest;
+	farthest.Center = center;
+	farthest.Progress = &progress;
+	farthest.MaxDistance2 = 0.0;
+	vtkDispatchPoints(input, farthest);
+	progress.Finish();
+	vtkDebugMacro(<< "Farthest point from the centre: " << sqrt(farthest.MaxDistance2));
 
 	output->ShallowCopy(input);
 
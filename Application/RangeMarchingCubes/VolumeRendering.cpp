@@ -17,29 +17,35 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkCamera.h"
 #include "vtkCommand.h"
 #include "vtkColorTransferFunction.h"
-#include "vtkDICOMImageReader.h"
+#include "vtkDICOMSeriesLoader.h"
 #include "vtkImageData.h"
-#include "vtkImageResample.h"
+#include "vtkLODProp3D.h"
 #include "vtkMetaImageReader.h"
+#include "vtkPointData.h"
 #include "vtkPiecewiseFunction.h"
 #include "vtkPlanes.h"
 #include "vtkProperty.h"
 #include "vtkRenderer.h"
 #include "vtkRenderWindow.h"
 #include "vtkRenderWindowInteractor.h"
-#include "vtkVolume.h"
 #include "vtkVolumeProperty.h"
 #include "vtkXMLImageDataReader.h"
 #include "vtkSmartVolumeMapper.h"
 #include "vtkImageMarchingCubes.h"
 #include <vtkPolyDataMapper.h>
 #include <vtkActor.h>
+#include "vtkVolumePresetLibrary.h"
+#include "vtkVolumeBrickPyramid.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 
 #define VTI_FILETYPE 1
 #define MHA_FILETYPE 2
 
-// Callback for moving the planes from the box widget to the mapper
+// Callback for moving the planes from the box widget to the mappers of
+// all levels of detail
 class vtkBoxWidgetCallback : public vtkCommand
 {
 public:
@@ -50,26 +56,37 @@ public:
 	void Execute(vtkObject *caller, unsigned long, void*) override
 	{
 		vtkBoxWidget *widget = reinterpret_cast<vtkBoxWidget*>(caller);
-		if (this->Mapper)
+		vtkPlanes *planes = vtkPlanes::New();
+		widget->GetPlanes(planes);
+		for (size_t i = 0; i < this->Mappers.size(); i++)
 		{
-			vtkPlanes *planes = vtkPlanes::New();
-			widget->GetPlanes(planes);
-			this->Mapper->SetClippingPlanes(planes);
-			planes->Delete();
+			this->Mappers[i]->SetClippingPlanes(planes);
 		}
+		planes->Delete();
 	}
-	void SetMapper(vtkSmartVolumeMapper* m)
+	void AddMapper(vtkSmartVolumeMapper* m)
 	{
-		this->Mapper = m;
+		this->Mappers.push_back(m);
 	}
 
 protected:
-	vtkBoxWidgetCallback()
+	std::vector<vtkSmartVolumeMapper*> Mappers;
+};
+
+// Callback printing the progress of the DICOM series loader
+class vtkLoadProgressCallback : public vtkCommand
+{
+public:
+	static vtkLoadProgressCallback *New()
 	{
-		this->Mapper = nullptr;
+		return new vtkLoadProgressCallback;
+	}
+	void Execute(vtkObject *, unsigned long, void *callData) override
+	{
+		double progress = *static_cast<double*>(callData);
+		cout << "\rLoading DICOM series: " << static_cast<int>(progress * 100)
+			<< "%" << flush;
 	}
-
-	vtkSmartVolumeMapper *Mapper;
 };
 
 void PrintUsage()
@@ -104,7 +121,9 @@ void PrintUsage()
 	cout << "Use the -FrameRate option with a desired frame rate (in frames per second)" << endl;
 	cout << "which will control the interactive rendering rate." << endl;
 	cout << "Use the -DataReduction option with a reduction factor (greater than zero and" << endl;
-	cout << "less than one) to reduce the data before rendering." << endl;
+	cout << "less than one) to render the data at a reduced resolution even when still." << endl;
+	cout << "The volume is rendered from a pyramid of halved resolutions, and the level" << endl;
+	cout << "drawn is chosen to keep the frame rate during interaction." << endl;
 	cout << "Use one of the remaining options to specify the blend function" << endl;
 	cout << "and transfer functions. The -MIP option utilizes a maximum intensity" << endl;
 	cout << "projection method, while the others utilize compositing. The" << endl;
@@ -223,7 +242,8 @@ int main(int argc, char *argv[])
 			}
 			count += 2;
 		}
-		else if (!strcmp(argv[count], "-ReductionFactor"))
+		else if (!strcmp(argv[count], "-DataReduction") ||
+			!strcmp(argv[count], "-ReductionFactor"))
 		{
 			reductionFactor = atof(argv[count + 1]);
 			if (reductionFactor <= 0.0 || reductionFactor >= 1.0)
@@ -277,9 +297,15 @@ int main(int argc, char *argv[])
 	vtkImageData *input = nullptr;
 	if (dirname)
 	{
-		vtkDICOMImageReader *dicomReader = vtkDICOMImageReader::New();
+		vtkDICOMSeriesLoader *dicomReader = vtkDICOMSeriesLoader::New();
 		dicomReader->SetDirectoryName(dirname);
+		vtkLoadProgressCallback *progress = vtkLoadProgressCallback::New();
+		dicomReader->AddObserver(vtkCommand::ProgressEvent, progress);
+		progress->Delete();
 		dicomReader->Update();
+		cout << endl << "Read " << dicomReader->GetNumberOfSlices() << " slices in "
+			<< dicomReader->GetScanTime() + dicomReader->GetReadTime()
+			<< " s" << endl;
 		input = dicomReader->GetOutput();
 		reader = dicomReader;
 	}
@@ -316,18 +342,41 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	vtkImageResample *resample = vtkImageResample::New();
-	if (reductionFactor < 1.0)
+	// Build a pyramid of halved resolutions. Level 0 is the input itself.
+	// The reduction factor picks the finest level that is rendered, and
+	// the pyramid keeps only the first component, so data with several
+	// components is rendered at full resolution only.
+	vtkVolumeBrickPyramid *pyramid = vtkVolumeBrickPyramid::New();
+	pyramid->SetInputData(input);
+	pyramid->SetMaximumNumberOfLevels(4);
+	int finestLevel = 0;
+	int numberOfLevels = 1;
+	if (input->GetPointData()->GetScalars() &&
+		input->GetPointData()->GetScalars()->GetNumberOfComponents() == 1 &&
+		pyramid->Update())
 	{
-		resample->SetInputConnection(reader->GetOutputPort());
-		resample->SetAxisMagnificationFactor(0, reductionFactor);
-		resample->SetAxisMagnificationFactor(1, reductionFactor);
-		resample->SetAxisMagnificationFactor(2, reductionFactor);
+		numberOfLevels = pyramid->GetNumberOfLevels();
+		finestLevel = static_cast<int>(floor(log(1.0 / reductionFactor) / log(2.0) + 0.5));
+		finestLevel = std::min(finestLevel, numberOfLevels - 1);
+	}
+	else if (reductionFactor < 1.0)
+	{
+		cout << "Data reduction is ignored for data with several components." << endl;
 	}
 
-	// Create our volume and mapper
-	vtkVolume *volume = vtkVolume::New();
-	vtkSmartVolumeMapper *mapper = vtkSmartVolumeMapper::New();
+	// Create our volume, with one mapper per level of detail. vtkLODProp3D
+	// picks the finest level whose measured render time fits the time the
+	// render window allots for the desired update rate: coarse levels
+	// while interacting, the finest one for still renders.
+	vtkLODProp3D *volume = vtkLODProp3D::New();
+	std::vector<vtkSmartVolumeMapper*> mappers;
+	for (int level = finestLevel; level < numberOfLevels; level++)
+	{
+		vtkSmartVolumeMapper *levelMapper = vtkSmartVolumeMapper::New();
+		levelMapper->SetInputData(level == 0 ? input : pyramid->GetLevel(level));
+		mappers.push_back(levelMapper);
+	}
+	vtkSmartVolumeMapper *mapper = mappers[0];
 
 	//marching cubes
 	vtkSmartPointer<vtkImageMarchingCubes> surface = vtkSmartPointer<vtkImageMarchingCubes>::New();
@@ -349,46 +398,25 @@ int main(int argc, char *argv[])
 	{
 		box->SetInteractor(iren);
 		box->SetPlaceFactor(1.01);
-		if (reductionFactor < 1.0)
-		{
-			box->SetInputConnection(resample->GetOutputPort());
-		}
-		else
-		{
-			box->SetInputData(input);
-		}
+		box->SetInputData(input);
 
 		box->SetDefaultRenderer(renderer);
 		box->InsideOutOn();
 		box->PlaceWidget();
 		vtkBoxWidgetCallback *callback = vtkBoxWidgetCallback::New();
-		callback->SetMapper(mapper);
+		for (size_t i = 0; i < mappers.size(); i++)
+		{
+			callback->AddMapper(mappers[i]);
+		}
 		box->AddObserver(vtkCommand::InteractionEvent, callback);
 		callback->Delete();
 		box->EnabledOn();
 		box->GetSelectedFaceProperty()->SetOpacity(0.0);
 	}
 
-	if (reductionFactor < 1.0)
-	{
-		mapper->SetInputConnection(resample->GetOutputPort());
-	}
-	else
-	{
-		mapper->SetInputConnection(reader->GetOutputPort());
-	}
-
-
 	// Set the sample distance on the ray to be 1/2 the average spacing
 	double spacing[3];
-	if (reductionFactor < 1.0)
-	{
-		resample->GetOutput()->GetSpacing(spacing);
-	}
-	else
-	{
-		input->GetSpacing(spacing);
-	}
+	mappers[0]->GetInput()->GetSpacing(spacing);
 
 	//  mapper->SetSampleDistance( (spacing[0]+spacing[1]+spacing[2])/6.0 );
 	//  mapper->SetMaximumImageSampleDistance(10.0);
@@ -405,9 +433,6 @@ int main(int argc, char *argv[])
 	property->SetScalarOpacity(opacityFun);
 	property->SetInterpolationTypeToLinear();
 
-	// connect up the volume to the property and the mapper
-	volume->SetProperty(property);
-	volume->SetMapper(mapper);
 
 	// Depending on the blend type selected as a command line option,
 	// adjust the transfer function
@@ -446,76 +471,19 @@ int main(int argc, char *argv[])
 		property->ShadeOn();
 		break;
 
-		// CT_Skin
-		// Use compositing and functions set to highlight skin in CT data
-		// Not for use on RGB data
+		// CT_Skin, CT_Bone, CT_Muscle
+		// Use compositing and the shaded presets that highlight skin, bone
+		// or muscle in CT data. Not for use on RGB data
 	case 3:
-		colorFun->AddRGBPoint(-3024, 0, 0, 0, 0.5, 0.0);
-		colorFun->AddRGBPoint(-1000, .62, .36, .18, 0.5, 0.0);
-		colorFun->AddRGBPoint(-500, .88, .60, .29, 0.33, 0.45);
-		colorFun->AddRGBPoint(3071, .83, .66, 1, 0.5, 0.0);
-
-		opacityFun->AddPoint(-3024, 0, 0.5, 0.0);
-		opacityFun->AddPoint(-1000, 0, 0.5, 0.0);
-		opacityFun->AddPoint(-500, 1.0, 0.33, 0.45);
-		opacityFun->AddPoint(3071, 1.0, 0.5, 0.0);
-
-		mapper->SetBlendModeToComposite();
-		property->ShadeOn();
-		property->SetAmbient(0.1);
-		property->SetDiffuse(0.9);
-		property->SetSpecular(0.2);
-		property->SetSpecularPower(10.0);
-		property->SetScalarOpacityUnitDistance(0.8919);
-		break;
-
-		// CT_Bone
-		// Use compositing and functions set to highlight bone in CT data
-		// Not for use on RGB data
 	case 4:
-		colorFun->AddRGBPoint(-3024, 0, 0, 0, 0.5, 0.0);
-		colorFun->AddRGBPoint(-16, 0.73, 0.25, 0.30, 0.49, .61);
-		colorFun->AddRGBPoint(641, .90, .82, .56, .5, 0.0);
-		colorFun->AddRGBPoint(3071, 1, 1, 1, .5, 0.0);
-
-		opacityFun->AddPoint(-3024, 0, 0.5, 0.0);
-		opacityFun->AddPoint(-16, 0, .49, .61);
-		opacityFun->AddPoint(641, .72, .5, 0.0);
-		opacityFun->AddPoint(3071, .71, 0.5, 0.0);
-
-		mapper->SetBlendModeToComposite();
-		property->ShadeOn();
-		property->SetAmbient(0.1);
-		property->SetDiffuse(0.9);
-		property->SetSpecular(0.2);
-		property->SetSpecularPower(10.0);
-		property->SetScalarOpacityUnitDistance(0.8919);
-		break;
-
-		// CT_Muscle
-		// Use compositing and functions set to highlight muscle in CT data
-		// Not for use on RGB data
 	case 5:
-		colorFun->AddRGBPoint(-3024, 0, 0, 0, 0.5, 0.0);
-		colorFun->AddRGBPoint(-155, .55, .25, .15, 0.5, .92);
-		colorFun->AddRGBPoint(217, .88, .60, .29, 0.33, 0.45);
-		colorFun->AddRGBPoint(420, 1, .94, .95, 0.5, 0.0);
-		colorFun->AddRGBPoint(3071, .83, .66, 1, 0.5, 0.0);
-
-		opacityFun->AddPoint(-3024, 0, 0.5, 0.0);
-		opacityFun->AddPoint(-155, 0, 0.5, 0.92);
-		opacityFun->AddPoint(217, .68, 0.33, 0.45);
-		opacityFun->AddPoint(420, .83, 0.5, 0.0);
-		opacityFun->AddPoint(3071, .80, 0.5, 0.0);
-
+	{
+		const char *presetNames[] = { "CT_Skin", "CT_Bone", "CT_Muscle" };
+		vtkSmartPointer<vtkVolumePresetLibrary> presets = vtkSmartPointer<vtkVolumePresetLibrary>::New();
+		presets->ApplyPreset(presetNames[blendType - 3], property);
 		mapper->SetBlendModeToComposite();
-		property->ShadeOn();
-		property->SetAmbient(0.1);
-		property->SetDiffuse(0.9);
-		property->SetSpecular(0.2);
-		property->SetSpecularPower(10.0);
-		property->SetScalarOpacityUnitDistance(0.8919);
 		break;
+	}
 
 		// RGB_Composite
 		// Use compositing and functions set to highlight red/green/blue regions
@@ -543,12 +511,21 @@ int main(int argc, char *argv[])
 		break;
 	}
 
+	// connect up the volume to the property and the mappers, finest level
+	// first; the other mappers take the blend mode of the first
+	for (size_t i = 0; i < mappers.size(); i++)
+	{
+		mappers[i]->SetBlendMode(mapper->GetBlendMode());
+		int id = volume->AddLOD(mappers[i], property, 0.0);
+		volume->SetLODLevel(id, static_cast<double>(i));
+	}
+
 	// Set the default window size
 	renWin->SetSize(600, 600);
 	renWin->Render();
 
 	// Add the volume to the scene
-	renderer->AddVolume(volume);
+	renderer->AddViewProp(volume);
 	renderer->AddActor(surface_actor);
 
 	renderer->ResetCamera();
@@ -564,9 +541,12 @@ int main(int argc, char *argv[])
 
 	box->Delete();
 	volume->Delete();
-	mapper->Delete();
+	for (size_t i = 0; i < mappers.size(); i++)
+	{
+		mappers[i]->Delete();
+	}
+	pyramid->Delete();
 	reader->Delete();
-	resample->Delete();
 	renderer->Delete();
 	renWin->Delete();
 	iren->Delete();
@@ -14,9 +14,19 @@ For more information visit: http://blog.csdn.net/webzhuce
 #include <vtkActor.h>
 #include <iostream>
 
+#include "vtkPipelineProfiler.h"
+
 
 int main(int argc, char* argv[])
 {
+	// Record every pipeline pass of the algorithms created below, save them
+	// as a Chrome trace (open in chrome://tracing) and print the memory
+	// each filter used on exit.
+	vtkSmartPointer<vtkPipelineProfiler> profiler =
+		vtkSmartPointer<vtkPipelineProfiler>::New();
+	profiler->PrintMemorySummaryOnExitOn();
+	profiler->Install();
+
 	//if (argc < 2)
 	//{
 	//	std::cout<<argv[0]<<" "<<"VTK-File(*.vtk)"<<std::endl;
@@ -61,6 +71,7 @@ int main(int argc, char* argv[])
 
 	interactor->Initialize();
 	interactor->Start();
+	profiler->WriteChromeTrace("pipeline_trace.json");
 	//////////////////////////////////////////////////////////////////////////////////////////////////
 
 	return EXIT_SUCCESS;
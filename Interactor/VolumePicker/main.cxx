@@ -15,7 +15,7 @@ For more information visit: http://blog.csdn.net/webzhuce
 #include <vtkMarchingCubes.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkStripper.h>
-#include <vtkCellLocator.h>
+#include <vtkAbstractCellLocator.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
 #include <vtkActor.h>
@@ -30,6 +30,9 @@ For more information visit: http://blog.csdn.net/webzhuce
 #include <vtkDataSetMapper.h>
 #include <vtkVolumePicker.h>
 #include <vtkCommand.h>
+#include <vtkMath.h>
+#include "vtkAsyncVolumePicker.h"
+#include "vtkSpatialIndexRegistry.h"
 
 class vtkMyMouseCommand : public vtkCommand
 {
@@ -53,17 +56,38 @@ public:
 		actor->RotateWXYZ(180, (nx + n)*0.5, ny*0.5, nz*0.5);
 	}
 
+	//Mouse moves only queue a volume pick; the timer moves the cones when
+	//the worker thread has an answer, so a slow pick never stalls the UI.
 	virtual void Execute(vtkObject *caller, unsigned long eventId, void *callData)
 	{
-		//renWin->HideCursor();
-		int x, y;
-		iren->GetEventPosition(x, y);
-		picker->Pick(x, y, 0, ren);
-		double p[3];
-		picker->GetPickPosition(p);
+		if (eventId == vtkCommand::MouseMoveEvent)
+		{
+			int x, y;
+			iren->GetEventPosition(x, y);
+			volumePicker->PickAsync(x, y, ren);
+			return;
+		}
+
+		double p[3], n[3], display[2];
+		int hit = volumePicker->GetLatestPick(p, n, display);
+		if (hit < 0)
+		{
+			return;
+		}
+
+		//the bone surface is picked here, through its locator, and the
+		//nearer of the two hits wins
+		if (picker->Pick(display[0], display[1], 0, ren))
+		{
+			double *eye = ren->GetActiveCamera()->GetPosition();
+			double *q = picker->GetPickPosition();
+			if (!hit || vtkMath::Distance2BetweenPoints(eye, q) < vtkMath::Distance2BetweenPoints(eye, p))
+			{
+				picker->GetPickPosition(p);
+				picker->GetPickNormal(n);
+			}
+		}
 		std::cout << p[0]<< " "<< p[1]<<" " << p[2]<<std::endl;
-		double n[3];
-		picker->GetPickNormal(n);
 		redCone->SetPosition(p[0], p[1], p[2]);
 		PointCone(redCone, n[0], n[1], n[2]);
 		greenCone->SetPosition(p[0], p[1], p[2]);
@@ -75,6 +99,7 @@ public:
 	vtkRenderer *ren;
 	vtkRenderWindowInteractor *iren;
 	vtkVolumePicker *picker;
+	vtkAsyncVolumePicker *volumePicker;
 	vtkActor *redCone;
 	vtkActor *greenCone;
 };
@@ -147,10 +172,12 @@ int main(int, char *[])
 
 	vtkNew<vtkStripper> boneStripper;
 	boneStripper->SetInputConnection(boneNormals->GetOutputPort());
+	boneStripper->Update();
 
-	vtkNew<vtkCellLocator> boneLocator;
-	boneLocator->SetDataSet(boneExtractor->GetOutput());
-	boneLocator->LazyEvaluationOn();
+	//the bone's cell tree comes from the shared registry, so every consumer
+	//of this surface uses one index, rebuilt only when the surface changes
+	vtkSpatialIndexRegistry* indices = vtkSpatialIndexRegistry::GetGlobalRegistry();
+	vtkAbstractCellLocator* boneLocator = indices->GetCellTree(boneStripper->GetOutput());
 
 	vtkNew<vtkPolyDataMapper> boneMapper;
 	boneMapper->SetInputConnection(boneStripper->GetOutputPort());
@@ -235,10 +262,16 @@ int main(int, char *[])
 	ren->AddViewProp(redCone);
 	ren->AddViewProp(greenCone);
 
-	//the picker
+	//the pickers: the volume is picked off the UI thread, skipping empty
+	//bricks, and vtkVolumePicker only picks the bone
+	vtkNew<vtkAsyncVolumePicker> volumePicker;
+	volumePicker->SetVolume(volume);
+	volumePicker->SetVolumeOpacityIsovalue(0.1);
+
 	vtkNew<vtkVolumePicker> picker ;
 	picker->SetTolerance(1e-6);
-	picker->SetVolumeOpacityIsovalue(0.1);
+	picker->PickFromListOn();
+	picker->AddPickList(bone);
 	//locator is optional, but improves performance for large polydata
 	picker->AddLocator(boneLocator);
 	
@@ -248,9 +281,13 @@ int main(int, char *[])
 	mouseCommand->ren= ren;
 	mouseCommand->iren = iren;
 	mouseCommand->picker = picker;
+	mouseCommand->volumePicker = volumePicker;
 	mouseCommand->redCone = redCone;
 	mouseCommand->greenCone = greenCone;
 	iren->AddObserver(vtkCommand::MouseMoveEvent, mouseCommand);
+	iren->AddObserver(vtkCommand::TimerEvent, mouseCommand);
+	iren->Initialize();
+	iren->CreateRepeatingTimer(10);
 	iren->Start();
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
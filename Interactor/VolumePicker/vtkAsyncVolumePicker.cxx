@@ -0,0 +1,858 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkAsyncVolumePicker.cxx
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkAsyncVolumePicker.h"
+
+#include "vtkCamera.h"
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkPlane.h"
+#include "vtkPlaneCollection.h"
+#include "vtkPointData.h"
+#include "vtkRenderer.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkVolume.h"
+#include "vtkVolumeMapper.h"
+#include "vtkVolumeProperty.h"
+
+#include <algorithm>
+#include <cmath>
+
+vtkStandardNewMacro(vtkAsyncVolumePicker);
+
+namespace
+{
+const int TableSize = 4096;
+
+inline int TableIndex(double value, double shift, double scale)
+{
+  double index = (value + shift) * scale;
+  if (index <= 0.0)
+    {
+    return 0;
+    }
+  return index >= TableSize - 1 ? TableSize - 1 : static_cast<int>(index);
+}
+}
+
+// The volume as seen by the picks: the scalars (referenced, so they stay
+// alive while a worker reads them), the brick min/max and the bricks that
+// can reach the isovalue.
+struct vtkAsyncVolumePicker::Snapshot
+{
+  vtkSmartPointer<vtkDataArray> Scalars;
+  int Dimensions[3];
+  double Origin[3];
+  double Spacing[3];
+  vtkIdType Increments[3];
+
+  int BrickSize;
+  int BrickDimensions[3];
+  std::shared_ptr<const std::vector<double> > MinMax;
+
+  bool Linear;
+  double Isovalue;
+  double TableShift;
+  double TableScale;
+  std::vector<float> Opacity;
+  std::vector<unsigned char> Occupied;
+};
+
+// Everything a pick needs, captured on the thread that asked for it.
+struct vtkAsyncVolumePicker::Request
+{
+  std::shared_ptr<const Snapshot> Bricks;
+  double Display[2];
+  // The ray from the near to the far plane, in world and data coordinates,
+  // and the point on the focal plane reported on a miss.
+  double WorldP1[3];
+  double WorldP2[3];
+  double DataP1[3];
+  double DataP2[3];
+  double Focal[3];
+  double WorldToData[16];
+  // Clipping planes as (origin, normal) in world coordinates.
+  std::vector<double> ClippingPlanes;
+  int Cropping;
+  int CroppingRegionFlags;
+  double CroppingRegionPlanes[6];
+};
+
+struct vtkAsyncVolumePicker::Result
+{
+  int Hit;
+  double Display[2];
+  double Position[3];
+  double Normal[3];
+};
+
+namespace
+{
+// Scalar minimum and maximum of each brick, one slab of bricks per work
+// item. Brick (i, j, k) covers the cells from i * size to (i + 1) * size,
+// so it includes the voxels on its upper faces.
+template <class T>
+class ComputeMinMax
+{
+public:
+  const T *Scalars;
+  int Dimensions[3];
+  vtkIdType Increments[3];
+  int BrickSize;
+  int BrickDimensions[3];
+  double *MinMax;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType bk = begin; bk < end; bk++)
+      {
+      for (int bj = 0; bj < this->BrickDimensions[1]; bj++)
+        {
+        for (int bi = 0; bi < this->BrickDimensions[0]; bi++)
+          {
+          int lo[3] = { bi * this->BrickSize, bj * this->BrickSize,
+                        static_cast<int>(bk) * this->BrickSize };
+          int hi[3];
+          for (int a = 0; a < 3; a++)
+            {
+            hi[a] = std::min(lo[a] + this->BrickSize, this->Dimensions[a] - 1);
+            }
+          double minimum = VTK_DOUBLE_MAX;
+          double maximum = VTK_DOUBLE_MIN;
+          for (int k = lo[2]; k <= hi[2]; k++)
+            {
+            for (int j = lo[1]; j <= hi[1]; j++)
+              {
+              const T *row = this->Scalars + k * this->Increments[2] + j * this->Increments[1];
+              for (int i = lo[0]; i <= hi[0]; i++)
+                {
+                double value = row[i * this->Increments[0]];
+                minimum = std::min(minimum, value);
+                maximum = std::max(maximum, value);
+                }
+              }
+            }
+          vtkIdType brick = (bk * this->BrickDimensions[1] + bj) * this->BrickDimensions[0] + bi;
+          this->MinMax[2*brick] = minimum;
+          this->MinMax[2*brick + 1] = maximum;
+          }
+        }
+      }
+  }
+};
+
+template <class T>
+void ComputeBrickMinMax(const T *scalars, int dims[3],
+                        vtkIdType increments[3], int brickSize, int brickDims[3],
+                        double *minMax)
+{
+  ComputeMinMax<T> compute;
+  compute.Scalars = scalars;
+  compute.BrickSize = brickSize;
+  compute.MinMax = minMax;
+  for (int a = 0; a < 3; a++)
+    {
+    compute.Dimensions[a] = dims[a];
+    compute.Increments[a] = increments[a];
+    compute.BrickDimensions[a] = brickDims[a];
+    }
+  vtkSMPTools::For(0, brickDims[2], compute);
+}
+
+// Marches a ray in the continuous index space of the volume, t being the
+// parameter of the ray from the near (0) to the far (1) plane.
+template <class T>
+class RayMarcher
+{
+public:
+  const T *Scalars;
+  int MaxIndex[3];
+  vtkIdType Increments[3];
+  bool Linear;
+  const float *Opacity;
+  double TableShift;
+  double TableScale;
+
+  double Sample(const double x[3]) const
+  {
+    double c[3];
+    for (int a = 0; a < 3; a++)
+      {
+      c[a] = std::min(std::max(x[a], 0.0), static_cast<double>(this->MaxIndex[a]));
+      }
+    if (!this->Linear)
+      {
+      vtkIdType offset = 0;
+      for (int a = 0; a < 3; a++)
+        {
+        offset += static_cast<int>(c[a] + 0.5) * this->Increments[a];
+        }
+      return static_cast<double>(this->Scalars[offset]);
+      }
+    int i[3];
+    double f[3];
+    vtkIdType d[3];
+    for (int a = 0; a < 3; a++)
+      {
+      i[a] = std::min(static_cast<int>(c[a]), std::max(this->MaxIndex[a] - 1, 0));
+      f[a] = c[a] - i[a];
+      d[a] = this->MaxIndex[a] > 0 ? this->Increments[a] : 0;
+      }
+    const T *s = this->Scalars +
+      i[0]*this->Increments[0] + i[1]*this->Increments[1] + i[2]*this->Increments[2];
+    double c00 = s[0] + f[0] * (static_cast<double>(s[d[0]]) - s[0]);
+    double c10 = s[d[1]] + f[0] * (static_cast<double>(s[d[1] + d[0]]) - s[d[1]]);
+    double c01 = s[d[2]] + f[0] * (static_cast<double>(s[d[2] + d[0]]) - s[d[2]]);
+    double c11 = s[d[2] + d[1]] +
+      f[0] * (static_cast<double>(s[d[2] + d[1] + d[0]]) - s[d[2] + d[1]]);
+    double c0 = c00 + f[1] * (c10 - c00);
+    double c1 = c01 + f[1] * (c11 - c01);
+    return c0 + f[2] * (c1 - c0);
+  }
+
+  float OpacityAt(const double x[3]) const
+  {
+    return this->Opacity[TableIndex(this->Sample(x), this->TableShift, this->TableScale)];
+  }
+
+  // Gradient of the interpolated scalars, per index unit.
+  void Gradient(const double x[3], double g[3]) const
+  {
+    for (int a = 0; a < 3; a++)
+      {
+      double lo[3] = { x[0], x[1], x[2] };
+      double hi[3] = { x[0], x[1], x[2] };
+      lo[a] = std::max(x[a] - 0.5, 0.0);
+      hi[a] = std::min(x[a] + 0.5, static_cast<double>(this->MaxIndex[a]));
+      g[a] = hi[a] > lo[a] ? (this->Sample(hi) - this->Sample(lo)) / (hi[a] - lo[a]) : 0.0;
+      }
+  }
+};
+
+// Clips t in [t0, t1] to the part of the line o + t d inside the box
+// [lower, upper]; returns false if nothing is left.
+bool ClipToBox(const double o[3], const double d[3], const double lower[3],
+               const double upper[3], double &t0, double &t1)
+{
+  for (int a = 0; a < 3; a++)
+    {
+    if (d[a] == 0.0)
+      {
+      if (o[a] < lower[a] || o[a] > upper[a])
+        {
+        return false;
+        }
+      continue;
+      }
+    double ta = (lower[a] - o[a]) / d[a];
+    double tb = (upper[a] - o[a]) / d[a];
+    if (ta > tb)
+      {
+      std::swap(ta, tb);
+      }
+    t0 = std::max(t0, ta);
+    t1 = std::min(t1, tb);
+    }
+  return t0 <= t1;
+}
+
+// Walks the bricks along the ray with a 3D DDA and samples only the ones
+// that can reach the isovalue, every half voxel on a grid anchored at t0.
+// A hit is refined by bisection between the last two samples. The request
+// type is deduced, as it is internal to vtkAsyncVolumePicker.
+template <class T, class RequestType>
+bool MarchRay(const RequestType &request,
+              const double o[3], const double d[3], double t0, double t1,
+              const double cropping[6], double &tHit, double x[3], double g[3])
+{
+  const auto &bricks = *request.Bricks;
+  RayMarcher<T> marcher;
+  marcher.Scalars = static_cast<const T*>(bricks.Scalars->GetVoidPointer(0));
+  marcher.Linear = bricks.Linear;
+  marcher.Opacity = &bricks.Opacity[0];
+  marcher.TableShift = bricks.TableShift;
+  marcher.TableScale = bricks.TableScale;
+  for (int a = 0; a < 3; a++)
+    {
+    marcher.MaxIndex[a] = bricks.Dimensions[a] - 1;
+    marcher.Increments[a] = bricks.Increments[a];
+    }
+  float isovalue = static_cast<float>(bricks.Isovalue);
+
+  double length = vtkMath::Norm(d);
+  double dt = 0.5 / length;
+  int size = bricks.BrickSize;
+
+  // Cropping regions other than the central one are tested per sample.
+  bool regions = request.Cropping && request.CroppingRegionFlags != VTK_CROP_SUBVOLUME;
+
+  // DDA state: the current brick, the t at which the ray crosses the next
+  // brick boundary along each axis and the t between boundaries.
+  double start[3] = { o[0] + t0*d[0], o[1] + t0*d[1], o[2] + t0*d[2] };
+  int brick[3], step[3];
+  double tNext[3], tDelta[3];
+  for (int a = 0; a < 3; a++)
+    {
+    brick[a] = std::min(static_cast<int>(start[a] / size), bricks.BrickDimensions[a] - 1);
+    brick[a] = std::max(brick[a], 0);
+    if (d[a] > 0.0)
+      {
+      step[a] = 1;
+      tNext[a] = ((brick[a] + 1) * size - o[a]) / d[a];
+      tDelta[a] = size / d[a];
+      }
+    else if (d[a] < 0.0)
+      {
+      step[a] = -1;
+      tNext[a] = (brick[a] * size - o[a]) / d[a];
+      tDelta[a] = -size / d[a];
+      }
+    else
+      {
+      step[a] = 0;
+      tNext[a] = VTK_DOUBLE_MAX;
+      tDelta[a] = VTK_DOUBLE_MAX;
+      }
+    }
+
+  double tEnter = t0;
+  while (tEnter <= t1)
+    {
+    int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) :
+                                     (tNext[1] < tNext[2] ? 1 : 2);
+    double tExit = std::min(tNext[axis], t1);
+    vtkIdType b = (static_cast<vtkIdType>(brick[2]) * bricks.BrickDimensions[1] + brick[1]) *
+      bricks.BrickDimensions[0] + brick[0];
+    if (bricks.Occupied[b])
+      {
+      for (vtkIdType k = static_cast<vtkIdType>(ceil((tEnter - t0) / dt));
+           t0 + k * dt <= tExit; k++)
+        {
+        double t = t0 + k * dt;
+        double p[3] = { o[0] + t*d[0], o[1] + t*d[1], o[2] + t*d[2] };
+        if (regions)
+          {
+          int region = 0;
+          for (int a = 0, weight = 1; a < 3; a++, weight *= 3)
+            {
+            region += weight * (p[a] < cropping[2*a] ? 0 : (p[a] > cropping[2*a+1] ? 2 : 1));
+            }
+          if (!(request.CroppingRegionFlags & (1 << region)))
+            {
+            continue;
+            }
+          }
+        if (marcher.OpacityAt(p) < isovalue)
+          {
+          continue;
+          }
+        double lo = std::max(t - dt, t0);
+        double hi = t;
+        for (int i = 0; i < 8 && hi > lo; i++)
+          {
+          double mid = 0.5 * (lo + hi);
+          double pm[3] = { o[0] + mid*d[0], o[1] + mid*d[1], o[2] + mid*d[2] };
+          if (marcher.OpacityAt(pm) < isovalue)
+            {
+            lo = mid;
+            }
+          else
+            {
+            hi = mid;
+            }
+          }
+        tHit = hi;
+        for (int a = 0; a < 3; a++)
+          {
+          x[a] = o[a] + hi*d[a];
+          }
+        marcher.Gradient(x, g);
+        return true;
+        }
+      }
+
+    tEnter = tNext[axis];
+    brick[axis] += step[axis];
+    if (brick[axis] < 0 || brick[axis] >= bricks.BrickDimensions[axis])
+      {
+      break;
+      }
+    tNext[axis] += tDelta[axis];
+    }
+  return false;
+}
+}
+
+//----------------------------------------------------------------------------
+vtkAsyncVolumePicker::vtkAsyncVolumePicker()
+{
+  this->Volume = NULL;
+  this->VolumeOpacityIsovalue = 0.05;
+  this->BrickSize = 8;
+  this->PickPosition[0] = this->PickPosition[1] = this->PickPosition[2] = 0.0;
+  this->PickNormal[0] = this->PickNormal[1] = this->PickNormal[2] = 0.0;
+  this->Busy = false;
+  this->Stop = false;
+}
+
+//----------------------------------------------------------------------------
+vtkAsyncVolumePicker::~vtkAsyncVolumePicker()
+{
+  if (this->Worker.joinable())
+    {
+    {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stop = true;
+    }
+    this->Condition.notify_all();
+    this->Worker.join();
+    }
+  this->SetVolume(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::SetVolume(vtkVolume *volume)
+{
+  if (this->Volume == volume)
+    {
+    return;
+    }
+  if (volume)
+    {
+    volume->Register(this);
+    }
+  if (this->Volume)
+    {
+    this->Volume->UnRegister(this);
+    }
+  this->Volume = volume;
+  this->Bricks.reset();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::UpdateBricks()
+{
+  vtkVolumeMapper *mapper = vtkVolumeMapper::SafeDownCast(this->Volume->GetMapper());
+  vtkImageData *input = mapper ? vtkImageData::SafeDownCast(mapper->GetDataSetInput()) : NULL;
+  vtkDataArray *scalars = input ? input->GetPointData()->GetScalars() : NULL;
+  vtkVolumeProperty *property = this->Volume->GetProperty();
+  if (!scalars || scalars->GetNumberOfTuples() == 0 || !property)
+    {
+    this->Bricks.reset();
+    return;
+    }
+
+  // Rebuilt snapshots are new objects, so a worker still using the old one
+  // is not disturbed.
+  std::shared_ptr<Snapshot> bricks;
+  if (!this->Bricks || this->Bricks->Scalars != scalars ||
+      this->Bricks->BrickSize != this->BrickSize ||
+      this->MinMaxTime < scalars->GetMTime() || this->MinMaxTime < input->GetMTime())
+    {
+    bricks.reset(new Snapshot);
+    bricks->Scalars = scalars;
+    input->GetDimensions(bricks->Dimensions);
+    input->GetOrigin(bricks->Origin);
+    input->GetSpacing(bricks->Spacing);
+    bricks->Increments[0] = scalars->GetNumberOfComponents();
+    bricks->Increments[1] = bricks->Increments[0] * bricks->Dimensions[0];
+    bricks->Increments[2] = bricks->Increments[1] * bricks->Dimensions[1];
+    bricks->BrickSize = this->BrickSize;
+    for (int a = 0; a < 3; a++)
+      {
+      int cells = std::max(bricks->Dimensions[a] - 1, 1);
+      bricks->BrickDimensions[a] = (cells + this->BrickSize - 1) / this->BrickSize;
+      }
+    std::vector<double> *minMax = new std::vector<double>(2 *
+      static_cast<vtkIdType>(bricks->BrickDimensions[0]) *
+      bricks->BrickDimensions[1] * bricks->BrickDimensions[2]);
+    bricks->MinMax.reset(minMax);
+    switch (scalars->GetDataType())
+      {
+      vtkTemplateMacro(ComputeBrickMinMax(
+        static_cast<const VTK_TT*>(scalars->GetVoidPointer(0)),
+        bricks->Dimensions, bricks->Increments, bricks->BrickSize,
+        bricks->BrickDimensions, &(*minMax)[0]));
+      default:
+        vtkErrorMacro(<< "Unsupported scalar type " << scalars->GetDataTypeAsString());
+        this->Bricks.reset();
+        return;
+      }
+    this->MinMaxTime.Modified();
+    }
+  else if (this->FlagsTime < property->GetMTime() ||
+           this->Bricks->Isovalue != this->VolumeOpacityIsovalue)
+    {
+    bricks.reset(new Snapshot(*this->Bricks));
+    }
+  else
+    {
+    return;
+    }
+
+  // The opacity table spans the scalar range, and a brick can reach the
+  // isovalue if any table entry between its minimum and maximum does.
+  const std::vector<double> &minMax = *bricks->MinMax;
+  double range[2] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+  for (size_t i = 0; i < minMax.size(); i += 2)
+    {
+    range[0] = std::min(range[0], minMax[i]);
+    range[1] = std::max(range[1], minMax[i + 1]);
+    }
+  if (range[1] <= range[0])
+    {
+    range[1] = range[0] + 1.0;
+    }
+  bricks->Linear = property->GetInterpolationType() == VTK_LINEAR_INTERPOLATION;
+  bricks->Isovalue = this->VolumeOpacityIsovalue;
+  bricks->TableShift = -range[0];
+  bricks->TableScale = (TableSize - 1) / (range[1] - range[0]);
+  bricks->Opacity.resize(TableSize);
+  property->GetScalarOpacity()->GetTable(range[0], range[1], TableSize, &bricks->Opacity[0]);
+
+  // nextOpaque[i] is the first entry at or after i that reaches the
+  // isovalue, or TableSize if there is none.
+  std::vector<int> nextOpaque(TableSize + 1, TableSize);
+  for (int i = TableSize - 1; i >= 0; i--)
+    {
+    nextOpaque[i] = bricks->Opacity[i] >= this->VolumeOpacityIsovalue ? i : nextOpaque[i + 1];
+    }
+  bricks->Occupied.resize(minMax.size() / 2);
+  for (size_t b = 0; b < bricks->Occupied.size(); b++)
+    {
+    int lo = TableIndex(minMax[2*b], bricks->TableShift, bricks->TableScale);
+    int hi = TableIndex(minMax[2*b + 1], bricks->TableShift, bricks->TableScale);
+    bricks->Occupied[b] = nextOpaque[lo] <= hi;
+    }
+  this->FlagsTime.Modified();
+  this->Bricks = bricks;
+}
+
+//----------------------------------------------------------------------------
+bool vtkAsyncVolumePicker::CreateRequest(double x, double y, vtkRenderer *renderer,
+                                         Request &request)
+{
+  if (!this->Volume || !renderer)
+    {
+    vtkErrorMacro(<< "A volume and a renderer are required");
+    return false;
+    }
+  this->UpdateBricks();
+  request.Bricks = this->Bricks;
+  request.Display[0] = x;
+  request.Display[1] = y;
+
+  // The ray through the display point from the near to the far plane, as
+  // in vtkPicker; a miss reports the point at the depth of the focal point.
+  double world[4];
+  vtkCamera *camera = renderer->GetActiveCamera();
+  camera->GetFocalPoint(world);
+  world[3] = 1.0;
+  renderer->SetWorldPoint(world);
+  renderer->WorldToDisplay();
+  double depth[3] = { 0.0, 1.0, renderer->GetDisplayPoint()[2] };
+  double *targets[3] = { request.WorldP1, request.WorldP2, request.Focal };
+  for (int i = 0; i < 3; i++)
+    {
+    renderer->SetDisplayPoint(x, y, depth[i]);
+    renderer->DisplayToWorld();
+    renderer->GetWorldPoint(world);
+    for (int a = 0; a < 3; a++)
+      {
+      targets[i][a] = world[a] / world[3];
+      }
+    }
+
+  vtkMatrix4x4 *inverse = vtkMatrix4x4::New();
+  vtkMatrix4x4::Invert(this->Volume->GetMatrix(), inverse);
+  std::copy(&inverse->Element[0][0], &inverse->Element[0][0] + 16, request.WorldToData);
+  double p[4], q[4];
+  for (int i = 0; i < 2; i++)
+    {
+    const double *source = i ? request.WorldP2 : request.WorldP1;
+    double *target = i ? request.DataP2 : request.DataP1;
+    p[0] = source[0]; p[1] = source[1]; p[2] = source[2]; p[3] = 1.0;
+    inverse->MultiplyPoint(p, q);
+    for (int a = 0; a < 3; a++)
+      {
+      target[a] = q[a] / q[3];
+      }
+    }
+  inverse->Delete();
+
+  request.ClippingPlanes.clear();
+  request.Cropping = 0;
+  request.CroppingRegionFlags = VTK_CROP_SUBVOLUME;
+  vtkVolumeMapper *mapper = vtkVolumeMapper::SafeDownCast(this->Volume->GetMapper());
+  if (mapper)
+    {
+    vtkPlaneCollection *planes = mapper->GetClippingPlanes();
+    if (planes)
+      {
+      vtkPlane *plane;
+      planes->InitTraversal();
+      while ((plane = planes->GetNextItem()))
+        {
+        double *origin = plane->GetOrigin();
+        double *normal = plane->GetNormal();
+        request.ClippingPlanes.insert(request.ClippingPlanes.end(), origin, origin + 3);
+        request.ClippingPlanes.insert(request.ClippingPlanes.end(), normal, normal + 3);
+        }
+      }
+    request.Cropping = mapper->GetCropping();
+    request.CroppingRegionFlags = mapper->GetCroppingRegionFlags();
+    mapper->GetCroppingRegionPlanes(request.CroppingRegionPlanes);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::Intersect(const Request &request, Result &result)
+{
+  result.Hit = 0;
+  result.Display[0] = request.Display[0];
+  result.Display[1] = request.Display[1];
+  for (int a = 0; a < 3; a++)
+    {
+    result.Position[a] = request.Focal[a];
+    result.Normal[a] = 0.0;
+    }
+  if (!request.Bricks)
+    {
+    return;
+    }
+  const Snapshot &bricks = *request.Bricks;
+
+  // Clipping planes keep the side their normal points to. The ray
+  // parameter is the same in world and data coordinates.
+  double t0 = 0.0, t1 = 1.0;
+  for (size_t i = 0; i < request.ClippingPlanes.size(); i += 6)
+    {
+    const double *origin = &request.ClippingPlanes[i];
+    const double *normal = origin + 3;
+    double d1 = 0.0, d2 = 0.0;
+    for (int a = 0; a < 3; a++)
+      {
+      d1 += normal[a] * (request.WorldP1[a] - origin[a]);
+      d2 += normal[a] * (request.WorldP2[a] - origin[a]);
+      }
+    if (d1 < 0.0 && d2 < 0.0)
+      {
+      return;
+      }
+    if (d1 < 0.0)
+      {
+      t0 = std::max(t0, d1 / (d1 - d2));
+      }
+    else if (d2 < 0.0)
+      {
+      t1 = std::min(t1, d1 / (d1 - d2));
+      }
+    }
+
+  // The ray in continuous index coordinates, clipped to the volume and,
+  // for the usual central cropping region, to the cropping box.
+  double o[3], d[3], lower[3], upper[3], cropping[6];
+  for (int a = 0; a < 3; a++)
+    {
+    o[a] = (request.DataP1[a] - bricks.Origin[a]) / bricks.Spacing[a];
+    d[a] = (request.DataP2[a] - request.DataP1[a]) / bricks.Spacing[a];
+    lower[a] = 0.0;
+    upper[a] = bricks.Dimensions[a] - 1;
+    for (int side = 0; side < 2; side++)
+      {
+      cropping[2*a + side] =
+        (request.CroppingRegionPlanes[2*a + side] - bricks.Origin[a]) / bricks.Spacing[a];
+      }
+    if (cropping[2*a] > cropping[2*a + 1])
+      {
+      std::swap(cropping[2*a], cropping[2*a + 1]);
+      }
+    }
+  if (vtkMath::Norm(d) == 0.0 || !ClipToBox(o, d, lower, upper, t0, t1))
+    {
+    return;
+    }
+  if (request.Cropping && request.CroppingRegionFlags == VTK_CROP_SUBVOLUME)
+    {
+    double cropLower[3] = { cropping[0], cropping[2], cropping[4] };
+    double cropUpper[3] = { cropping[1], cropping[3], cropping[5] };
+    if (!ClipToBox(o, d, cropLower, cropUpper, t0, t1))
+      {
+      return;
+      }
+    }
+
+  double tHit = 0.0, x[3], g[3];
+  bool hit = false;
+  switch (bricks.Scalars->GetDataType())
+    {
+    vtkTemplateMacro(hit = MarchRay<VTK_TT>(request, o, d, t0, t1, cropping, tHit, x, g));
+    }
+  if (!hit)
+    {
+    return;
+    }
+
+  result.Hit = 1;
+  double direction[3];
+  for (int a = 0; a < 3; a++)
+    {
+    result.Position[a] = request.WorldP1[a] + tHit * (request.WorldP2[a] - request.WorldP1[a]);
+    direction[a] = request.WorldP2[a] - request.WorldP1[a];
+    g[a] /= bricks.Spacing[a];
+    }
+
+  // Normals transform with the transpose of the world to data matrix. The
+  // normal is turned to face the viewer; inside a uniform region, or on a
+  // clipped face, it points back along the ray.
+  const double *m = request.WorldToData;
+  for (int a = 0; a < 3; a++)
+    {
+    result.Normal[a] = m[a] * g[0] + m[4 + a] * g[1] + m[8 + a] * g[2];
+    }
+  if (vtkMath::Normalize(result.Normal) == 0.0)
+    {
+    for (int a = 0; a < 3; a++)
+      {
+      result.Normal[a] = -direction[a];
+      }
+    vtkMath::Normalize(result.Normal);
+    }
+  else if (vtkMath::Dot(result.Normal, direction) > 0.0)
+    {
+    for (int a = 0; a < 3; a++)
+      {
+      result.Normal[a] = -result.Normal[a];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkAsyncVolumePicker::Pick(double x, double y, vtkRenderer *renderer)
+{
+  Request request;
+  Result result;
+  if (!this->CreateRequest(x, y, renderer, request))
+    {
+    return 0;
+    }
+  Intersect(request, result);
+  for (int a = 0; a < 3; a++)
+    {
+    this->PickPosition[a] = result.Position[a];
+    this->PickNormal[a] = result.Normal[a];
+    }
+  return result.Hit;
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::PickAsync(double x, double y, vtkRenderer *renderer)
+{
+  std::unique_ptr<Request> request(new Request);
+  if (!this->CreateRequest(x, y, renderer, *request))
+    {
+    return;
+    }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (!this->Worker.joinable())
+    {
+    this->Worker = std::thread(&vtkAsyncVolumePicker::RunWorker, this);
+    }
+  // Dropping a request that was not started releases its snapshot here,
+  // on the calling thread.
+  this->Pending = std::move(request);
+  this->Condition.notify_all();
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::RunWorker()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  for (;;)
+    {
+    while (!this->Stop && !this->Pending)
+      {
+      this->Condition.wait(lock);
+      }
+    if (this->Stop)
+      {
+      return;
+      }
+    std::unique_ptr<Request> request(std::move(this->Pending));
+    this->Busy = true;
+    lock.unlock();
+
+    std::unique_ptr<Result> result(new Result);
+    Intersect(*request, *result);
+    request.reset();
+
+    lock.lock();
+    this->Latest = std::move(result);
+    this->Busy = false;
+    this->Condition.notify_all();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkAsyncVolumePicker::GetLatestPick(double position[3], double normal[3],
+                                        double display[2])
+{
+  std::unique_ptr<Result> result;
+  {
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  result = std::move(this->Latest);
+  }
+  if (!result)
+    {
+    return -1;
+    }
+  for (int a = 0; a < 3; a++)
+    {
+    position[a] = result->Position[a];
+    normal[a] = result->Normal[a];
+    }
+  display[0] = result->Display[0];
+  display[1] = result->Display[1];
+  return result->Hit;
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::WaitForPicks()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (this->Pending || this->Busy)
+    {
+    this->Condition.wait(lock);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkAsyncVolumePicker::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Volume: " << this->Volume << "\n";
+  os << indent << "Volume Opacity Isovalue: " << this->VolumeOpacityIsovalue << "\n";
+  os << indent << "Brick Size: " << this->BrickSize << "\n";
+  os << indent << "Pick Position: (" << this->PickPosition[0] << ", "
+     << this->PickPosition[1] << ", " << this->PickPosition[2] << ")\n";
+  os << indent << "Pick Normal: (" << this->PickNormal[0] << ", "
+     << this->PickNormal[1] << ", " << this->PickNormal[2] << ")\n";
+}
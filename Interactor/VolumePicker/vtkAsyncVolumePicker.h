@@ -0,0 +1,142 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkAsyncVolumePicker.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkAsyncVolumePicker - volume picker with empty space skipping and a worker thread
+// .SECTION Description
+// vtkAsyncVolumePicker finds the first point along a display ray where the
+// scalar opacity of a vtkVolume reaches VolumeOpacityIsovalue, like
+// vtkVolumePicker, and returns its position and surface normal.
+//
+// The volume is split into bricks of BrickSize^3 cells whose scalar
+// minimum and maximum are kept. Combined with the scalar opacity function,
+// they tell which bricks contain no sample at or above the isovalue; the
+// ray walks brick by brick and only samples the others. The min/max are
+// recomputed when the scalars change, the brick flags when the opacity
+// function or the isovalue change.
+//
+// The cropping region planes and flags and the clipping planes of the
+// volume's mapper are honoured, and so is the volume's matrix (including
+// a user transform). Only the first scalar component is used, and
+// gradient opacity is ignored, as in vtkVolumePicker by default.
+//
+// Pick() answers on the calling thread. PickAsync() only captures the ray
+// and the volume state and returns; a worker thread answers the most
+// recent request, dropping older ones that it has not started.
+// GetLatestPick() returns the newest answer once. The volume scalars must
+// not be modified while a pick is running.
+//
+// .SECTION See Also
+// vtkVolumePicker
+
+#ifndef __vtkAsyncVolumePicker_h
+#define __vtkAsyncVolumePicker_h
+
+#include "vtkObject.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class vtkRenderer;
+class vtkVolume;
+
+class vtkAsyncVolumePicker : public vtkObject
+{
+public:
+  static vtkAsyncVolumePicker *New();
+  vtkTypeMacro(vtkAsyncVolumePicker, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // The volume to pick. Its mapper input must be a vtkImageData.
+  virtual void SetVolume(vtkVolume *volume);
+  vtkGetObjectMacro(Volume, vtkVolume);
+
+  // Description:
+  // Scalar opacity at which a ray is considered to hit. Default is 0.05.
+  vtkSetClampMacro(VolumeOpacityIsovalue, double, 0.0, 1.0);
+  vtkGetMacro(VolumeOpacityIsovalue, double);
+
+  // Description:
+  // Edge length of the empty space skipping bricks, in cells. Default is 8.
+  vtkSetClampMacro(BrickSize, int, 2, 64);
+  vtkGetMacro(BrickSize, int);
+
+  // Description:
+  // Pick at display position (x, y) of renderer, on the calling thread.
+  // Returns 1 if the volume was hit. On a miss the position is on the
+  // focal plane and the normal is zero.
+  int Pick(double x, double y, vtkRenderer *renderer);
+  vtkGetVector3Macro(PickPosition, double);
+  vtkGetVector3Macro(PickNormal, double);
+
+  // Description:
+  // Queue a pick at display position (x, y) of renderer for the worker
+  // thread, replacing any request it has not started yet.
+  void PickAsync(double x, double y, vtkRenderer *renderer);
+
+  // Description:
+  // The answer to the most recent finished request, if it was not returned
+  // before: returns 1 for a hit, 0 for a miss (position and normal as in
+  // Pick()) and -1 if there is no new answer. display receives the display
+  // position of the request.
+  int GetLatestPick(double position[3], double normal[3], double display[2]);
+
+  // Description:
+  // Block until the worker thread has answered every queued request.
+  void WaitForPicks();
+
+protected:
+  vtkAsyncVolumePicker();
+  ~vtkAsyncVolumePicker();
+
+  struct Snapshot;
+  struct Request;
+  struct Result;
+
+  // Capture the ray and the volume state on the calling thread. Returns
+  // false if there is nothing to pick.
+  bool CreateRequest(double x, double y, vtkRenderer *renderer, Request &request);
+  void UpdateBricks();
+  static void Intersect(const Request &request, Result &result);
+  void RunWorker();
+
+  vtkVolume *Volume;
+  double VolumeOpacityIsovalue;
+  int BrickSize;
+  double PickPosition[3];
+  double PickNormal[3];
+
+  // The brick min/max and flags, rebuilt on the calling thread and shared
+  // read-only with the worker.
+  std::shared_ptr<Snapshot> Bricks;
+  vtkTimeStamp MinMaxTime;
+  vtkTimeStamp FlagsTime;
+
+  std::thread Worker;
+  std::mutex Mutex;
+  std::condition_variable Condition;
+  std::unique_ptr<Request> Pending;
+  std::unique_ptr<Result> Latest;
+  bool Busy;
+  bool Stop;
+
+private:
+  vtkAsyncVolumePicker(const vtkAsyncVolumePicker&);  // Not implemented.
+  void operator=(const vtkAsyncVolumePicker&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,115 @@
+/**********************************************************************
+
+Copyright (c) Mr.Bin. All rights reserved.
+For more information visit: http://blog.csdn.net/webzhuce
+
+**********************************************************************/
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkStructuredPointsReader.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkVolumeProperty.h>
+#include <vtkCamera.h>
+#include <vtkPNGWriter.h>
+#include <vtkTimerLog.h>
+#include "vtkCPUVolumeRayCaster.h"
+#include "vtkVolumePresetLibrary.h"
+
+#include <sstream>
+#include <vector>
+
+//Usage: HeadlessRayCast [file.vtk] [preset]
+//With a preset (CT_Skin, CT_Bone, CT_Muscle or MIP) the views are rendered
+//with its pre-integrated tables instead of the property below.
+int main(int argc, char *argv[])
+{
+	const int numberOfViews = 36;
+
+	vtkNew<vtkStructuredPointsReader> reader;
+	reader->SetFileName(argc > 1 ? argv[1] : "E:\\TestData\\mummy.128.vtk");
+	reader->Update();
+
+	vtkNew<vtkVolumeProperty> volumeProperty;
+	volumeProperty->SetInterpolationTypeToLinear();
+	volumeProperty->ShadeOn();
+	volumeProperty->SetAmbient(0.4);
+	volumeProperty->SetDiffuse(0.6);
+	volumeProperty->SetSpecular(0.2);
+
+	vtkNew<vtkPiecewiseFunction> compositeOpacity;
+	compositeOpacity->AddPoint(70,   0.00);
+	compositeOpacity->AddPoint(90,   0.40);
+	compositeOpacity->AddPoint(180,  0.60);
+	volumeProperty->SetScalarOpacity(compositeOpacity);
+
+	vtkNew<vtkColorTransferFunction> color;
+	color->AddRGBPoint(0.000,  0.00, 0.00, 0.00);
+	color->AddRGBPoint(64.00,  1.00, 0.52, 0.30);
+	color->AddRGBPoint(190.0,  1.00, 1.00, 1.00);
+	color->AddRGBPoint(220.0,  0.20, 0.20, 0.20);
+	volumeProperty->SetColor(color);
+
+	vtkNew<vtkCPUVolumeRayCaster> rayCaster;
+	rayCaster->SetInputData(reader->GetOutput());
+	rayCaster->SetVolumeProperty(volumeProperty);
+	rayCaster->SetImageSize(256, 256);
+	rayCaster->SetBackground(1.0, 1.0, 1.0, 1.0);
+
+	vtkNew<vtkVolumePresetLibrary> presets;
+	if (argc > 2)
+	{
+		rayCaster->SetPresetLibrary(presets);
+		if (!rayCaster->SetPreset(argv[2]))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	//orbit the camera around the volume, one keyframe every 10 degrees
+	double bounds[6];
+	reader->GetOutput()->GetBounds(bounds);
+	double center[3] = { (bounds[0] + bounds[1]) / 2,
+		(bounds[2] + bounds[3]) / 2, (bounds[4] + bounds[5]) / 2 };
+	double radius = sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
+		(bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
+		(bounds[5] - bounds[4]) * (bounds[5] - bounds[4])) / 2;
+
+	std::vector<vtkSmartPointer<vtkCamera> > cameras(numberOfViews);
+	std::vector<vtkSmartPointer<vtkImageData> > images(numberOfViews);
+	std::vector<vtkCamera*> cameraPointers(numberOfViews);
+	std::vector<vtkImageData*> imagePointers(numberOfViews);
+	for (int i = 0; i < numberOfViews; i++)
+	{
+		cameras[i] = vtkSmartPointer<vtkCamera>::New();
+		cameras[i]->SetFocalPoint(center);
+		cameras[i]->SetPosition(center[0], center[1] - 3 * radius, center[2]);
+		cameras[i]->SetViewUp(0, 0, -1);
+		cameras[i]->SetClippingRange(2 * radius, 4 * radius);
+		cameras[i]->Azimuth(i * 360.0 / numberOfViews);
+		cameraPointers[i] = cameras[i];
+
+		images[i] = vtkSmartPointer<vtkImageData>::New();
+		imagePointers[i] = images[i];
+	}
+
+	double start = vtkTimerLog::GetUniversalTime();
+	if (!rayCaster->RenderViews(numberOfViews, &cameraPointers[0], &imagePointers[0]))
+	{
+		return EXIT_FAILURE;
+	}
+	std::cout << "Rendered " << numberOfViews << " views in "
+		<< vtkTimerLog::GetUniversalTime() - start << " s" << std::endl;
+
+	vtkNew<vtkPNGWriter> writer;
+	for (int i = 0; i < numberOfViews; i++)
+	{
+		std::ostringstream fileName;
+		fileName << "view_" << i << ".png";
+		writer->SetInputData(images[i]);
+		writer->SetFileName(fileName.str().c_str());
+		writer->Write();
+	}
+
+	return EXIT_SUCCESS;
+}
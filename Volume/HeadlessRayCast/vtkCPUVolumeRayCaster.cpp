@@ -0,0 +1,1298 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkCPUVolumeRayCaster.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkCPUVolumeRayCaster.h"
+
+#include "vtkCamera.h"
+#include "vtkColorTransferFunction.h"
+#include "vtkCommand.h"
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkPointData.h"
+#include "vtkSMPTools.h"
+#include "vtkTimerLog.h"
+#include "vtkVolumeBrickPyramid.h"
+#include "vtkVolumePresetLibrary.h"
+#include "vtkVolumeProperty.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+vtkStandardNewMacro(vtkCPUVolumeRayCaster);
+
+vtkCxxSetObjectMacro(vtkCPUVolumeRayCaster, VolumeProperty, vtkVolumeProperty);
+vtkCxxSetObjectMacro(vtkCPUVolumeRayCaster, Pyramid, vtkVolumeBrickPyramid);
+vtkCxxSetObjectMacro(vtkCPUVolumeRayCaster, PresetLibrary, vtkVolumePresetLibrary);
+
+namespace
+{
+const int TableSize = 4096;
+const int MaximumLevels = 8;
+
+// Progressive passes: the pixel grid stride, the phase of the grid, the
+// size of the block each cast pixel fills, and the log2 of the factor the
+// sample distance is multiplied by. The first pass casts 1/16 of the rays
+// with a 4x longer step; the last four interleave the full resolution
+// rays in a 2x2 pattern.
+struct ProgressivePass
+{
+  int Stride;
+  int Offset[2];
+  int Block;
+  int StepShift;
+};
+const ProgressivePass ProgressivePasses[] =
+{
+  { 4, { 0, 0 }, 4, 2 },
+  { 2, { 0, 0 }, 2, 1 },
+  { 2, { 0, 0 }, 1, 0 },
+  { 2, { 1, 1 }, 1, 0 },
+  { 2, { 1, 0 }, 1, 0 },
+  { 2, { 0, 1 }, 1, 0 }
+};
+const int NumberOfProgressivePasses =
+  sizeof(ProgressivePasses) / sizeof(ProgressivePasses[0]);
+const ProgressivePass FullPass = { 1, { 0, 0 }, 1, 0 };
+const int MaximumStepShift = 2;
+
+// One resolution of the volume. Level l has 2^l times the input spacing.
+// Step, CorrectedOpacity and PreIntegrated also include the step factor of
+// the pass. PreIntegrated is NULL unless the rays are pre-integrated.
+struct LevelParameters
+{
+  const void *Scalars;
+  int Dimensions[3];
+  vtkIdType Increments[3];
+  double Scale;
+  double Step;
+  const float *CorrectedOpacity;
+  const float *PreIntegrated;
+};
+
+// Everything a thread needs to cast the rays of a tile, copied out of the
+// caster so the workers never touch VTK objects.
+struct RayCastParameters
+{
+  int Dimensions[3];
+  double Origin[3];
+  double Spacing[3];
+
+  int BlendMode;
+  bool Linear;
+  bool Shade;
+  float Ambient;
+  float Diffuse;
+  float Specular;
+  float SpecularPower;
+  float Background[4];
+
+  // Level 0 is the input. BrickLevels holds the level of each brick for
+  // each view, or NULL for views drawn entirely at full resolution.
+  int NumberOfLevels;
+  LevelParameters Levels[MaximumLevels];
+  int BrickSize;
+  int BrickDimensions[3];
+
+  const float *Color;
+  const float *Opacity;
+  const float *GradientOpacity;
+  double TableShift;
+  double TableScale;
+  double GradientTableScale;
+  bool PreIntegrate;
+  int PreIntegratedSize;
+  double PreIntegratedScale;
+
+  int Width;
+  int Height;
+  int TileSize;
+  int TilesX;
+  int TilesY;
+  ProgressivePass Pass;
+
+  // Polled by every worker before each tile.
+  const std::atomic<int> *Abort;
+
+  // Per view: the inverse of the composite projection matrix, mapping
+  // normalized device coordinates to world coordinates, and the output.
+  std::vector<double> NDCToWorld;
+  std::vector<unsigned char*> Pixels;
+  std::vector<const unsigned char*> BrickLevels;
+};
+
+inline void Unproject(const double *m, double x, double y, double z, double out[3])
+{
+  double w = m[12]*x + m[13]*y + m[14]*z + m[15];
+  out[0] = (m[0]*x + m[1]*y + m[2]*z + m[3]) / w;
+  out[1] = (m[4]*x + m[5]*y + m[6]*z + m[7]) / w;
+  out[2] = (m[8]*x + m[9]*y + m[10]*z + m[11]) / w;
+}
+
+// Clips o + t d, t >= 0, against the box [0, upper]; returns false if the
+// ray misses it.
+inline bool ClipRay(const double o[3], const double d[3], const double upper[3],
+                    double &t0, double &t1)
+{
+  t0 = 0.0;
+  t1 = VTK_DOUBLE_MAX;
+  for (int a = 0; a < 3; a++)
+    {
+    if (d[a] == 0.0)
+      {
+      if (o[a] < 0.0 || o[a] > upper[a])
+        {
+        return false;
+        }
+      continue;
+      }
+    double ta = -o[a] / d[a];
+    double tb = (upper[a] - o[a]) / d[a];
+    if (ta > tb)
+      {
+      std::swap(ta, tb);
+      }
+    t0 = std::max(t0, ta);
+    t1 = std::min(t1, tb);
+    }
+  return t0 <= t1;
+}
+
+template <class T>
+class VolumeSampler
+{
+public:
+  const T *Scalars;
+  int MaxIndex[3];
+  vtkIdType Increments[3];
+  // Increment to the upper neighbour, 0 along axes of extent 1.
+  vtkIdType UpperIncrements[3];
+
+  void Initialize(const LevelParameters &level)
+  {
+    this->Scalars = static_cast<const T*>(level.Scalars);
+    for (int a = 0; a < 3; a++)
+      {
+      this->MaxIndex[a] = level.Dimensions[a] - 1;
+      this->Increments[a] = level.Increments[a];
+      this->UpperIncrements[a] = level.Dimensions[a] > 1 ? level.Increments[a] : 0;
+      }
+  }
+
+  // Converts input index coordinates to the index coordinates of a level
+  // whose voxels are scale input voxels wide.
+  void FromInputIndex(const double x[3], double scale, double xl[3]) const
+  {
+    for (int a = 0; a < 3; a++)
+      {
+      double v = (x[a] + 0.5) / scale - 0.5;
+      xl[a] = v < 0.0 ? 0.0 : (v > this->MaxIndex[a] ? this->MaxIndex[a] : v);
+      }
+  }
+
+  // x is in continuous index coordinates and inside the volume.
+  double Nearest(const double x[3]) const
+  {
+    vtkIdType offset = 0;
+    for (int a = 0; a < 3; a++)
+      {
+      int i = static_cast<int>(x[a] + 0.5);
+      offset += std::min(i, this->MaxIndex[a]) * this->Increments[a];
+      }
+    return static_cast<double>(this->Scalars[offset]);
+  }
+
+  double Linear(const double x[3]) const
+  {
+    int i[3];
+    double f[3];
+    for (int a = 0; a < 3; a++)
+      {
+      i[a] = std::min(static_cast<int>(x[a]), std::max(this->MaxIndex[a] - 1, 0));
+      f[a] = x[a] - i[a];
+      }
+    const T *s = this->Scalars +
+      i[0]*this->Increments[0] + i[1]*this->Increments[1] + i[2]*this->Increments[2];
+    vtkIdType dx = this->UpperIncrements[0];
+    vtkIdType dy = this->UpperIncrements[1];
+    vtkIdType dz = this->UpperIncrements[2];
+    double c00 = s[0] + f[0] * (static_cast<double>(s[dx]) - s[0]);
+    double c10 = s[dy] + f[0] * (static_cast<double>(s[dy + dx]) - s[dy]);
+    double c01 = s[dz] + f[0] * (static_cast<double>(s[dz + dx]) - s[dz]);
+    double c11 = s[dz + dy] + f[0] * (static_cast<double>(s[dz + dy + dx]) - s[dz + dy]);
+    double c0 = c00 + f[1] * (c10 - c00);
+    double c1 = c01 + f[1] * (c11 - c01);
+    return c0 + f[2] * (c1 - c0);
+  }
+
+  // Central-difference gradient at the voxel nearest to x, per index unit.
+  void Gradient(const double x[3], double g[3]) const
+  {
+    int i[3];
+    for (int a = 0; a < 3; a++)
+      {
+      i[a] = std::min(static_cast<int>(x[a] + 0.5), this->MaxIndex[a]);
+      }
+    for (int a = 0; a < 3; a++)
+      {
+      int lo = std::max(i[a] - 1, 0);
+      int hi = std::min(i[a] + 1, this->MaxIndex[a]);
+      if (hi == lo)
+        {
+        g[a] = 0.0;
+        continue;
+        }
+      vtkIdType base = 0;
+      for (int b = 0; b < 3; b++)
+        {
+        base += (b == a ? 0 : i[b]) * this->Increments[b];
+        }
+      g[a] = (static_cast<double>(this->Scalars[base + hi*this->Increments[a]]) -
+              this->Scalars[base + lo*this->Increments[a]]) / (hi - lo);
+      }
+  }
+};
+
+inline int TableIndex(double value, double shift, double scale)
+{
+  double index = (value + shift) * scale;
+  if (index <= 0.0)
+    {
+    return 0;
+    }
+  return index >= TableSize - 1 ? TableSize - 1 : static_cast<int>(index);
+}
+
+// Continuous index into the pre-integrated tables, whose entries are at
+// the bin values.
+inline float PreIntegratedIndex(double value, double shift, double scale, int size)
+{
+  double index = (value + shift) * scale;
+  if (index <= 0.0)
+    {
+    return 0.0f;
+    }
+  return static_cast<float>(index >= size - 1 ? size - 1 : index);
+}
+
+// Bilinear lookup of the segment from front to back.
+inline void PreIntegratedLookup(const float *table, int size, float front, float back,
+                                float rgba[4])
+{
+  int i = std::min(static_cast<int>(front), size - 2);
+  int j = std::min(static_cast<int>(back), size - 2);
+  float fi = front - i;
+  float fj = back - j;
+  const float *t00 = table + 4*(static_cast<vtkIdType>(j)*size + i);
+  const float *t10 = t00 + 4*size;
+  for (int c = 0; c < 4; c++)
+    {
+    float lower = t00[c] + fi * (t00[c + 4] - t00[c]);
+    float upper = t10[c] + fi * (t10[c + 4] - t10[c]);
+    rgba[c] = lower + fj * (upper - lower);
+    }
+}
+
+// Casts the rays of a range of tiles. Work item w is tile w % tilesPerView
+// of view w / tilesPerView. Only the pixels on the grid of the pass are
+// cast, each filling the block of pixels up to the next grid pixel.
+template <class T>
+class RenderTiles
+{
+public:
+  const RayCastParameters *Parameters;
+  VolumeSampler<T> Samplers[MaximumLevels];
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const RayCastParameters &p = *this->Parameters;
+    vtkIdType tilesPerView = static_cast<vtkIdType>(p.TilesX) * p.TilesY;
+    const ProgressivePass &pass = p.Pass;
+    for (vtkIdType w = begin; w < end && !p.Abort->load(std::memory_order_relaxed); w++)
+      {
+      int view = static_cast<int>(w / tilesPerView);
+      int tile = static_cast<int>(w % tilesPerView);
+      int x0 = (tile % p.TilesX) * p.TileSize;
+      int y0 = (tile / p.TilesX) * p.TileSize;
+      int x1 = std::min(x0 + p.TileSize, p.Width);
+      int y1 = std::min(y0 + p.TileSize, p.Height);
+      const double *m = &p.NDCToWorld[16*view];
+      unsigned char *pixels = p.Pixels[view];
+      const unsigned char *brickLevels = p.BrickLevels[view];
+      int xs = x0 + ((pass.Offset[0] - x0) % pass.Stride + pass.Stride) % pass.Stride;
+      int ys = y0 + ((pass.Offset[1] - y0) % pass.Stride + pass.Stride) % pass.Stride;
+      for (int y = ys; y < y1; y += pass.Stride)
+        {
+        for (int x = xs; x < x1; x += pass.Stride)
+          {
+          unsigned char *pixel = pixels + 4*(static_cast<vtkIdType>(y)*p.Width + x);
+          this->CastRay(m, brickLevels, x, y, pixel);
+          if (pass.Block > 1)
+            {
+            this->FillBlock(pixels, x, y, pixel);
+            }
+          }
+        }
+      }
+  }
+
+  void FillBlock(unsigned char *pixels, int x, int y, const unsigned char *value) const
+  {
+    const RayCastParameters &p = *this->Parameters;
+    int x1 = std::min(x + p.Pass.Block, p.Width);
+    int y1 = std::min(y + p.Pass.Block, p.Height);
+    for (int yy = y; yy < y1; yy++)
+      {
+      unsigned char *row = pixels + 4*static_cast<vtkIdType>(yy)*p.Width;
+      for (int xx = (yy == y ? x + 1 : x); xx < x1; xx++)
+        {
+        std::copy(value, value + 4, row + 4*xx);
+        }
+      }
+  }
+
+  void CastRay(const double *m, const unsigned char *brickLevels, int x, int y,
+               unsigned char *pixel) const
+  {
+    const RayCastParameters &p = *this->Parameters;
+    float rgba[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    // The ray through the pixel centre, from the near to the far plane.
+    double ndcX = 2.0 * (x + 0.5) / p.Width - 1.0;
+    double ndcY = 2.0 * (y + 0.5) / p.Height - 1.0;
+    double nearPoint[3], farPoint[3];
+    Unproject(m, ndcX, ndcY, -1.0, nearPoint);
+    Unproject(m, ndcX, ndcY, 1.0, farPoint);
+    double d[3] = { farPoint[0] - nearPoint[0], farPoint[1] - nearPoint[1],
+                    farPoint[2] - nearPoint[2] };
+    double length = vtkMath::Norm(d);
+    if (length > 0.0)
+      {
+      d[0] /= length; d[1] /= length; d[2] /= length;
+
+      // March in continuous index space; t stays a world distance.
+      double o[3], di[3], upper[3];
+      for (int a = 0; a < 3; a++)
+        {
+        o[a] = (nearPoint[a] - p.Origin[a]) / p.Spacing[a];
+        di[a] = d[a] / p.Spacing[a];
+        upper[a] = p.Dimensions[a] - 1;
+        }
+      double t0, t1;
+      if (ClipRay(o, di, upper, t0, t1))
+        {
+        if (p.BlendMode == VTK_CPU_RAYCAST_MAXIMUM_INTENSITY_BLEND)
+          {
+          this->IntegrateMaximum(o, di, t0, t1, brickLevels, rgba);
+          }
+        else if (p.PreIntegrate)
+          {
+          this->IntegratePreIntegrated(o, di, d, t0, t1, brickLevels, rgba);
+          }
+        else
+          {
+          this->IntegrateComposite(o, di, d, t0, t1, brickLevels, rgba);
+          }
+        }
+      }
+
+    // Composite over the background and un-premultiply.
+    float remaining = 1.0f - rgba[3];
+    float alpha = rgba[3] + remaining * p.Background[3];
+    for (int c = 0; c < 3; c++)
+      {
+      float value = rgba[c] + remaining * p.Background[3] * p.Background[c];
+      value = alpha > 0.0f ? value / alpha : 0.0f;
+      pixel[c] = static_cast<unsigned char>(std::min(value, 1.0f) * 255.0f + 0.5f);
+      }
+    pixel[3] = static_cast<unsigned char>(std::min(alpha, 1.0f) * 255.0f + 0.5f);
+  }
+
+  // The level of the brick containing input index x.
+  int GetLevel(const unsigned char *brickLevels, const double x[3]) const
+  {
+    if (!brickLevels)
+      {
+      return 0;
+      }
+    const RayCastParameters &p = *this->Parameters;
+    int b[3];
+    for (int a = 0; a < 3; a++)
+      {
+      b[a] = std::min(static_cast<int>(x[a] + 0.5) / p.BrickSize, p.BrickDimensions[a] - 1);
+      }
+    return brickLevels[(b[2]*p.BrickDimensions[1] + b[1])*p.BrickDimensions[0] + b[0]];
+  }
+
+  // Samples at input index x from the given level; xl receives the index
+  // coordinates in that level.
+  double Sample(int level, const double x[3], double xl[3]) const
+  {
+    const VolumeSampler<T> &sampler = this->Samplers[level];
+    if (level)
+      {
+      sampler.FromInputIndex(x, this->Parameters->Levels[level].Scale, xl);
+      }
+    else
+      {
+      xl[0] = x[0]; xl[1] = x[1]; xl[2] = x[2];
+      }
+    return this->Parameters->Linear ? sampler.Linear(xl) : sampler.Nearest(xl);
+  }
+
+  // Gradient opacity and headlight shading at xl, in the index space of
+  // level. Returns false if the gradient opacity is 0.
+  bool Illuminate(int level, const double xl[3], const double d[3],
+                  float &gradientOpacity, float &diffuse, float &specular) const
+  {
+    const RayCastParameters &p = *this->Parameters;
+    gradientOpacity = 1.0f;
+    diffuse = 1.0f;
+    specular = 0.0f;
+    double g[3];
+    this->Samplers[level].Gradient(xl, g);
+    for (int a = 0; a < 3; a++)
+      {
+      g[a] /= p.Spacing[a] * p.Levels[level].Scale;
+      }
+    double magnitude = vtkMath::Norm(g);
+    if (p.GradientOpacity)
+      {
+      gradientOpacity = p.GradientOpacity[TableIndex(magnitude, 0.0, p.GradientTableScale)];
+      if (gradientOpacity <= 0.0f)
+        {
+        return false;
+        }
+      }
+    if (p.Shade)
+      {
+      // Headlight: the light and view directions are both -d, so the
+      // half vector is -d as well. Lighting is two-sided.
+      float nDotL = 0.0f;
+      if (magnitude > 0.0)
+        {
+        nDotL = static_cast<float>(
+          fabs(g[0]*d[0] + g[1]*d[1] + g[2]*d[2]) / magnitude);
+        }
+      diffuse = p.Ambient + p.Diffuse * nDotL;
+      specular = p.Specular * pow(nDotL, p.SpecularPower);
+      }
+    return true;
+  }
+
+  void IntegrateComposite(const double o[3], const double di[3], const double d[3],
+                          double t0, double t1, const unsigned char *brickLevels,
+                          float rgba[4]) const
+  {
+    const RayCastParameters &p = *this->Parameters;
+    const bool needGradient = p.Shade || p.GradientOpacity;
+    for (double t = t0; t <= t1; )
+      {
+      double x[3] = { o[0] + t*di[0], o[1] + t*di[1], o[2] + t*di[2] };
+      int level = this->GetLevel(brickLevels, x);
+      t += p.Levels[level].Step;
+      double xl[3];
+      int index = TableIndex(this->Sample(level, x, xl), p.TableShift, p.TableScale);
+      float alpha = p.Levels[level].CorrectedOpacity[index];
+      if (alpha <= 0.0f)
+        {
+        continue;
+        }
+
+      const float *color = p.Color + 3*index;
+      float c[3] = { color[0], color[1], color[2] };
+      if (needGradient)
+        {
+        float gradientOpacity, diffuse, specular;
+        if (!this->Illuminate(level, xl, d, gradientOpacity, diffuse, specular))
+          {
+          continue;
+          }
+        alpha *= gradientOpacity;
+        for (int k = 0; k < 3; k++)
+          {
+          c[k] = c[k] * diffuse + specular;
+          }
+        }
+
+      float weight = (1.0f - rgba[3]) * alpha;
+      rgba[0] += weight * c[0];
+      rgba[1] += weight * c[1];
+      rgba[2] += weight * c[2];
+      rgba[3] += weight;
+      if (rgba[3] > 0.99f)
+        {
+        break;
+        }
+      }
+  }
+
+  // Composites the segments between consecutive samples, looked up in the
+  // pre-integrated table of the step taken from the front sample. Shading
+  // and gradient opacity are evaluated at the back sample.
+  void IntegratePreIntegrated(const double o[3], const double di[3], const double d[3],
+                              double t0, double t1, const unsigned char *brickLevels,
+                              float rgba[4]) const
+  {
+    const RayCastParameters &p = *this->Parameters;
+    const bool needGradient = p.Shade || p.GradientOpacity;
+    const float *table = NULL;
+    float front = 0.0f;
+    for (double t = t0; t <= t1; )
+      {
+      double x[3] = { o[0] + t*di[0], o[1] + t*di[1], o[2] + t*di[2] };
+      int level = this->GetLevel(brickLevels, x);
+      t += p.Levels[level].Step;
+      double xl[3];
+      float back = PreIntegratedIndex(this->Sample(level, x, xl), p.TableShift,
+                                      p.PreIntegratedScale, p.PreIntegratedSize);
+      const float *previous = table;
+      float segment[4];
+      table = p.Levels[level].PreIntegrated;
+      if (!previous)
+        {
+        front = back;
+        continue;
+        }
+      PreIntegratedLookup(previous, p.PreIntegratedSize, front, back, segment);
+      front = back;
+      if (segment[3] <= 0.0f)
+        {
+        continue;
+        }
+
+      // The segment colour is premultiplied by its opacity.
+      float alpha = segment[3];
+      float c[3] = { segment[0], segment[1], segment[2] };
+      if (needGradient)
+        {
+        float gradientOpacity, diffuse, specular;
+        if (!this->Illuminate(level, xl, d, gradientOpacity, diffuse, specular))
+          {
+          continue;
+          }
+        alpha *= gradientOpacity;
+        for (int k = 0; k < 3; k++)
+          {
+          c[k] = (c[k] * diffuse + specular * segment[3]) * gradientOpacity;
+          }
+        }
+
+      float weight = 1.0f - rgba[3];
+      rgba[0] += weight * c[0];
+      rgba[1] += weight * c[1];
+      rgba[2] += weight * c[2];
+      rgba[3] += weight * alpha;
+      if (rgba[3] > 0.99f)
+        {
+        break;
+        }
+      }
+  }
+
+  void IntegrateMaximum(const double o[3], const double di[3],
+                        double t0, double t1, const unsigned char *brickLevels,
+                        float rgba[4]) const
+  {
+    const RayCastParameters &p = *this->Parameters;
+    double maximum = VTK_DOUBLE_MIN;
+    bool hit = false;
+    for (double t = t0; t <= t1; )
+      {
+      double x[3] = { o[0] + t*di[0], o[1] + t*di[1], o[2] + t*di[2] };
+      int level = this->GetLevel(brickLevels, x);
+      t += p.Levels[level].Step;
+      double xl[3];
+      double value = this->Sample(level, x, xl);
+      if (!hit || value > maximum)
+        {
+        maximum = value;
+        hit = true;
+        }
+      }
+    if (!hit)
+      {
+      return;
+      }
+    int index = TableIndex(maximum, p.TableShift, p.TableScale);
+    float alpha = p.Opacity[index];
+    for (int c = 0; c < 3; c++)
+      {
+      rgba[c] = alpha * p.Color[3*index + c];
+      }
+    rgba[3] = alpha;
+  }
+};
+
+// Interval in milliseconds between two AbortCheckEvents.
+const int AbortCheckInterval = 10;
+
+// The tiles are cast from a helper thread while the calling thread invokes
+// AbortCheckEvent on caster every AbortCheckInterval until they are done.
+// Whichever threads the SMP backend runs the tiles on, the observers are
+// then called regularly and on the thread that started the render, which
+// is the one allowed to query the window system.
+template <class T>
+void RenderAllTiles(const RayCastParameters &parameters, vtkIdType numberOfItems,
+                    vtkObject *caster)
+{
+  RenderTiles<T> render;
+  render.Parameters = &parameters;
+  for (int level = 0; level < parameters.NumberOfLevels; level++)
+    {
+    render.Samplers[level].Initialize(parameters.Levels[level]);
+    }
+  std::mutex mutex;
+  std::condition_variable finished;
+  bool done = false;
+  std::thread tiles([&]()
+    {
+    vtkSMPTools::For(0, numberOfItems, 1, render);
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    finished.notify_one();
+    });
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!finished.wait_for(lock, std::chrono::milliseconds(AbortCheckInterval),
+                            [&done]() { return done; }))
+    {
+    lock.unlock();
+    caster->InvokeEvent(vtkCommand::AbortCheckEvent, NULL);
+    lock.lock();
+    }
+  lock.unlock();
+  tiles.join();
+}
+}
+
+//----------------------------------------------------------------------------
+vtkCPUVolumeRayCaster::vtkCPUVolumeRayCaster()
+{
+  this->Input = NULL;
+  this->VolumeProperty = NULL;
+  this->BlendMode = VTK_CPU_RAYCAST_COMPOSITE_BLEND;
+  this->ImageSize[0] = this->ImageSize[1] = 256;
+  this->Background[0] = this->Background[1] = 0.0;
+  this->Background[2] = this->Background[3] = 0.0;
+  this->SampleDistance = 0.0;
+  this->TileSize = 32;
+  this->TableRange[0] = 0.0;
+  this->TableRange[1] = 1.0;
+  this->TableShift = 0.0;
+  this->TableScale = 1.0;
+  this->GradientTableScale = 1.0;
+  this->TableSampleDistance = 0.0;
+  this->TableNumberOfLevels = 0;
+  this->TableProperty = NULL;
+  this->DesiredUpdateRate = 0.0;
+  this->Pyramid = vtkVolumeBrickPyramid::New();
+  this->SecondsPerSample = 1e-8;
+  this->LastRenderTime = 0.0;
+  this->LastCoarsestLevel = 0;
+  this->AbortRender = 0;
+  this->PresetLibrary = NULL;
+  this->Preset = -1;
+}
+
+//----------------------------------------------------------------------------
+vtkCPUVolumeRayCaster::~vtkCPUVolumeRayCaster()
+{
+  this->SetInputData(NULL);
+  this->SetVolumeProperty(NULL);
+  this->SetPyramid(NULL);
+  this->SetPresetLibrary(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkCPUVolumeRayCaster::SetAbortRender(int abort)
+{
+  this->AbortRender.store(abort);
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::GetAbortRender()
+{
+  return this->AbortRender.load();
+}
+
+//----------------------------------------------------------------------------
+void vtkCPUVolumeRayCaster::SetInputData(vtkImageData *input)
+{
+  if (this->Input == input)
+    {
+    return;
+    }
+  if (input)
+    {
+    input->Register(this);
+    }
+  if (this->Input)
+    {
+    this->Input->UnRegister(this);
+    }
+  this->Input = input;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::SetPreset(const char *name)
+{
+  int preset = this->PresetLibrary ? this->PresetLibrary->FindPreset(name) : -1;
+  if (preset < 0)
+    {
+    vtkErrorMacro(<< "No preset named " << (name ? name : "(null)"));
+    return 0;
+    }
+  this->SetPreset(preset);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+vtkVolumeProperty *vtkCPUVolumeRayCaster::GetActiveProperty()
+{
+  if (this->PresetLibrary && this->Preset >= 0)
+    {
+    return this->PresetLibrary->GetPresetProperty(this->Preset);
+    }
+  return this->VolumeProperty;
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::GetActiveBlendMode()
+{
+  if (this->PresetLibrary && this->Preset >= 0)
+    {
+    return this->PresetLibrary->GetPresetBlendMode(this->Preset);
+    }
+  return this->BlendMode;
+}
+
+//----------------------------------------------------------------------------
+bool vtkCPUVolumeRayCaster::GetPreIntegrate()
+{
+  return this->PresetLibrary && this->Preset >= 0 &&
+    this->Preset < this->PresetLibrary->GetNumberOfPresets() &&
+    this->GetActiveBlendMode() == VTK_CPU_RAYCAST_COMPOSITE_BLEND;
+}
+
+//----------------------------------------------------------------------------
+double vtkCPUVolumeRayCaster::GetEffectiveSampleDistance()
+{
+  if (this->SampleDistance > 0.0 || !this->Input)
+    {
+    return this->SampleDistance;
+    }
+  double *spacing = this->Input->GetSpacing();
+  double factor = this->GetPreIntegrate() ? 1.0 : 0.5;
+  return factor * std::min(fabs(spacing[0]), std::min(fabs(spacing[1]), fabs(spacing[2])));
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::UpdateTables(int numberOfLevels)
+{
+  vtkVolumeProperty *property = this->GetActiveProperty();
+  if (!this->Input || !property)
+    {
+    vtkErrorMacro(<< "An input volume and a volume property or preset are required");
+    return 0;
+    }
+  vtkDataArray *scalars = this->Input->GetPointData()->GetScalars();
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    vtkErrorMacro(<< "The input has no point scalars");
+    return 0;
+    }
+
+  double sampleDistance = this->GetEffectiveSampleDistance();
+  if (sampleDistance <= 0.0)
+    {
+    vtkErrorMacro(<< "Invalid sample distance " << sampleDistance);
+    return 0;
+    }
+  if (this->TableProperty == property &&
+      this->TableBuildTime > property->GetMTime() &&
+      this->TableBuildTime > this->Input->GetMTime() &&
+      this->TableBuildTime > scalars->GetMTime() &&
+      this->TableSampleDistance == sampleDistance &&
+      this->TableNumberOfLevels == numberOfLevels)
+    {
+    return 1;
+    }
+
+  double range[2];
+  scalars->GetRange(range, 0);
+  if (range[1] <= range[0])
+    {
+    range[1] = range[0] + 1.0;
+    }
+  this->TableRange[0] = range[0];
+  this->TableRange[1] = range[1];
+  this->TableShift = -range[0];
+  this->TableScale = (TableSize - 1) / (range[1] - range[0]);
+
+  this->ColorTable.resize(3 * TableSize);
+  if (property->GetColorChannels() == 1)
+    {
+    std::vector<float> gray(TableSize);
+    property->GetGrayTransferFunction()->GetTable(
+      range[0], range[1], TableSize, &gray[0]);
+    for (int i = 0; i < TableSize; i++)
+      {
+      this->ColorTable[3*i] = this->ColorTable[3*i+1] = this->ColorTable[3*i+2] = gray[i];
+      }
+    }
+  else
+    {
+    property->GetRGBTransferFunction()->GetTable(
+      range[0], range[1], TableSize, &this->ColorTable[0]);
+    }
+
+  // Opacities are defined per ScalarOpacityUnitDistance; correct them for
+  // the actual sample distance, which doubles with each level and with each
+  // step shift of the progressive passes.
+  int numberOfSteps = numberOfLevels + MaximumStepShift;
+  this->OpacityTable.resize(TableSize);
+  this->CorrectedOpacityTable.resize(numberOfSteps * TableSize);
+  property->GetScalarOpacity()->GetTable(
+    range[0], range[1], TableSize, &this->OpacityTable[0]);
+  double unitDistance = property->GetScalarOpacityUnitDistance();
+  double exponent = unitDistance > 0.0 ? sampleDistance / unitDistance : 1.0;
+  for (int i = 0; i < TableSize; i++)
+    {
+    float alpha = std::min(std::max(this->OpacityTable[i], 0.0f), 1.0f);
+    this->OpacityTable[i] = alpha;
+    for (int step = 0; step < numberOfSteps; step++)
+      {
+      this->CorrectedOpacityTable[step*TableSize + i] = alpha >= 1.0f ? 1.0f :
+        static_cast<float>(1.0 - pow(1.0 - alpha, exponent * (1 << step)));
+      }
+    }
+
+  // The gradient opacity table is only kept when it changes anything.
+  this->GradientOpacityTable.clear();
+  vtkPiecewiseFunction *gradientOpacity = property->GetGradientOpacity();
+  if (!property->GetDisableGradientOpacity() && gradientOpacity &&
+      gradientOpacity->GetSize() > 0)
+    {
+    double *gradientRange = gradientOpacity->GetRange();
+    double maximum = gradientRange[1] > 0.0 ? gradientRange[1] : range[1] - range[0];
+    this->GradientTableScale = (TableSize - 1) / maximum;
+    this->GradientOpacityTable.resize(TableSize);
+    gradientOpacity->GetTable(0.0, maximum, TableSize, &this->GradientOpacityTable[0]);
+    bool constantOne = true;
+    for (int i = 0; i < TableSize && constantOne; i++)
+      {
+      constantOne = this->GradientOpacityTable[i] >= 1.0f;
+      }
+    if (constantOne)
+      {
+      this->GradientOpacityTable.clear();
+      }
+    }
+
+  this->TableSampleDistance = sampleDistance;
+  this->TableNumberOfLevels = numberOfLevels;
+  this->TableProperty = property;
+  this->TableBuildTime.Modified();
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::RenderViews(int numberOfViews, vtkCamera **cameras,
+                                       unsigned char **rgba)
+{
+  return this->RenderPass(numberOfViews, cameras, rgba, -1);
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::GetNumberOfProgressivePasses()
+{
+  return NumberOfProgressivePasses;
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::RenderProgressive(vtkCamera *camera, unsigned char *rgba,
+                                             int pass)
+{
+  if (pass < 0 || pass >= NumberOfProgressivePasses)
+    {
+    vtkErrorMacro(<< "Invalid progressive pass " << pass);
+    return 0;
+    }
+  return this->RenderPass(1, &camera, &rgba, pass);
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::RenderProgressive(vtkCamera *camera, vtkImageData *image,
+                                             int pass)
+{
+  if (!image)
+    {
+    vtkErrorMacro(<< "No output image");
+    return 0;
+    }
+  int dims[3];
+  image->GetDimensions(dims);
+  vtkDataArray *scalars = image->GetPointData()->GetScalars();
+  if (pass == 0 || dims[0] != this->ImageSize[0] || dims[1] != this->ImageSize[1] ||
+      !scalars || scalars->GetDataType() != VTK_UNSIGNED_CHAR ||
+      scalars->GetNumberOfComponents() != 4)
+    {
+    image->SetDimensions(this->ImageSize[0], this->ImageSize[1], 1);
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    }
+  int result = this->RenderProgressive(
+    camera, static_cast<unsigned char*>(image->GetScalarPointer()), pass);
+  image->Modified();
+  return result;
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::RenderPass(int numberOfViews, vtkCamera **cameras,
+                                      unsigned char **rgba, int pass)
+{
+  this->AbortRender = 0;
+  if (numberOfViews <= 0)
+    {
+    return 1;
+    }
+  if (this->ImageSize[0] <= 0 || this->ImageSize[1] <= 0)
+    {
+    vtkErrorMacro(<< "Invalid image size " << this->ImageSize[0] << " x "
+                  << this->ImageSize[1]);
+    return 0;
+    }
+  for (int i = 0; i < numberOfViews; i++)
+    {
+    if (!cameras[i] || !rgba[i])
+      {
+      vtkErrorMacro(<< "View " << i << " has no camera or no output buffer");
+      return 0;
+      }
+    }
+  bool levelOfDetail = this->DesiredUpdateRate > 0.0 && this->Input;
+  if (levelOfDetail)
+    {
+    if (!this->Pyramid)
+      {
+      this->Pyramid = vtkVolumeBrickPyramid::New();
+      }
+    if (this->Pyramid->GetInput() != this->Input)
+      {
+      this->Pyramid->SetInputData(this->Input);
+      }
+    if (!this->Pyramid->Update())
+      {
+      return 0;
+      }
+    }
+  int numberOfLevels = levelOfDetail ? this->Pyramid->GetNumberOfLevels() : 1;
+  if (!this->UpdateTables(numberOfLevels))
+    {
+    return 0;
+    }
+
+  vtkDataArray *scalars = this->Input->GetPointData()->GetScalars();
+
+  RayCastParameters p;
+  p.Pass = pass < 0 ? FullPass : ProgressivePasses[pass];
+  p.PreIntegrate = this->GetPreIntegrate();
+  p.PreIntegratedSize = vtkVolumePresetLibrary::GetPreIntegratedTableSize();
+  p.PreIntegratedScale = (p.PreIntegratedSize - 1) / (this->TableRange[1] - this->TableRange[0]);
+  p.Abort = &this->AbortRender;
+  this->Input->GetDimensions(p.Dimensions);
+  this->Input->GetOrigin(p.Origin);
+  this->Input->GetSpacing(p.Spacing);
+
+  p.NumberOfLevels = numberOfLevels;
+  for (int level = 0; level < numberOfLevels; level++)
+    {
+    vtkImageData *image = levelOfDetail ? this->Pyramid->GetLevel(level) : this->Input;
+    LevelParameters &l = p.Levels[level];
+    l.Scalars = image->GetPointData()->GetScalars()->GetVoidPointer(0);
+    image->GetDimensions(l.Dimensions);
+    l.Increments[0] = image->GetPointData()->GetScalars()->GetNumberOfComponents();
+    l.Increments[1] = l.Increments[0] * l.Dimensions[0];
+    l.Increments[2] = l.Increments[1] * l.Dimensions[1];
+    l.Scale = 1 << level;
+    l.Step = this->TableSampleDistance * (1 << (level + p.Pass.StepShift));
+    l.CorrectedOpacity =
+      &this->CorrectedOpacityTable[(level + p.Pass.StepShift) * TableSize];
+    // The library keeps at least 8 tables, so none of the tables of this
+    // render is evicted before it is used.
+    l.PreIntegrated = NULL;
+    if (p.PreIntegrate)
+      {
+      l.PreIntegrated = this->PresetLibrary->GetPreIntegratedTable(
+        this->Preset, this->TableRange, l.Step);
+      if (!l.PreIntegrated)
+        {
+        return 0;
+        }
+      }
+    }
+  std::vector<unsigned char> brickLevels;
+  double estimatedSamples = 0.0;
+  p.BrickSize = this->Pyramid ? this->Pyramid->GetBrickSize() : 1;
+  p.BrickDimensions[0] = p.BrickDimensions[1] = p.BrickDimensions[2] = 1;
+  p.BrickLevels.assign(numberOfViews, static_cast<const unsigned char*>(NULL));
+  if (levelOfDetail)
+    {
+    this->Pyramid->GetBrickDimensions(p.BrickDimensions);
+    estimatedSamples = this->SelectLevels(numberOfViews, cameras, brickLevels);
+    vtkIdType numberOfBricks = this->Pyramid->GetNumberOfBricks();
+    for (int i = 0; i < numberOfViews; i++)
+      {
+      const unsigned char *viewLevels = &brickLevels[i * numberOfBricks];
+      if (*std::max_element(viewLevels, viewLevels + numberOfBricks) > 0)
+        {
+        p.BrickLevels[i] = viewLevels;
+        }
+      }
+    }
+
+  vtkVolumeProperty *property = this->GetActiveProperty();
+  p.BlendMode = this->GetActiveBlendMode();
+  p.Linear = property->GetInterpolationType() == VTK_LINEAR_INTERPOLATION;
+  p.Shade = property->GetShade() != 0;
+  p.Ambient = static_cast<float>(property->GetAmbient());
+  p.Diffuse = static_cast<float>(property->GetDiffuse());
+  p.Specular = static_cast<float>(property->GetSpecular());
+  p.SpecularPower = static_cast<float>(property->GetSpecularPower());
+  for (int c = 0; c < 4; c++)
+    {
+    p.Background[c] = static_cast<float>(this->Background[c]);
+    }
+
+  p.Color = &this->ColorTable[0];
+  p.Opacity = &this->OpacityTable[0];
+  p.GradientOpacity = this->GradientOpacityTable.empty() ? NULL : &this->GradientOpacityTable[0];
+  p.TableShift = this->TableShift;
+  p.TableScale = this->TableScale;
+  p.GradientTableScale = this->GradientTableScale;
+
+  p.Width = this->ImageSize[0];
+  p.Height = this->ImageSize[1];
+  p.TileSize = this->TileSize;
+  p.TilesX = (p.Width + p.TileSize - 1) / p.TileSize;
+  p.TilesY = (p.Height + p.TileSize - 1) / p.TileSize;
+
+  // vtkCamera caches its transforms, so the matrices are computed here
+  // rather than in the workers.
+  double aspect = static_cast<double>(p.Width) / p.Height;
+  p.NDCToWorld.resize(16 * numberOfViews);
+  p.Pixels.resize(numberOfViews);
+  vtkMatrix4x4 *inverse = vtkMatrix4x4::New();
+  for (int i = 0; i < numberOfViews; i++)
+    {
+    vtkMatrix4x4::Invert(
+      cameras[i]->GetCompositeProjectionTransformMatrix(aspect, -1, 1), inverse);
+    std::copy(&inverse->Element[0][0], &inverse->Element[0][0] + 16,
+              &p.NDCToWorld[16*i]);
+    p.Pixels[i] = rgba[i];
+    }
+  inverse->Delete();
+
+  vtkIdType numberOfItems =
+    static_cast<vtkIdType>(numberOfViews) * p.TilesX * p.TilesY;
+  double start = vtkTimerLog::GetUniversalTime();
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(RenderAllTiles<VTK_TT>(p, numberOfItems, this));
+    default:
+      vtkErrorMacro(<< "Unsupported scalar type " << scalars->GetDataTypeAsString());
+      return 0;
+    }
+  this->LastRenderTime = vtkTimerLog::GetUniversalTime() - start;
+  if (this->AbortRender)
+    {
+    return 0;
+    }
+
+  // Calibrate the cost model used by SelectLevels() with full frames.
+  this->LastCoarsestLevel = 0;
+  if (levelOfDetail)
+    {
+    this->LastCoarsestLevel = *std::max_element(brickLevels.begin(), brickLevels.end());
+    if (estimatedSamples > 0.0 && pass < 0)
+      {
+      this->SecondsPerSample =
+        0.5 * (this->SecondsPerSample + this->LastRenderTime / estimatedSamples);
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+double vtkCPUVolumeRayCaster::SelectLevels(int numberOfViews, vtkCamera **cameras,
+                                           std::vector<unsigned char> &levels)
+{
+  vtkVolumeBrickPyramid *pyramid = this->Pyramid;
+  int coarsest = pyramid->GetNumberOfLevels() - 1;
+  vtkIdType numberOfBricks = pyramid->GetNumberOfBricks();
+  levels.assign(numberOfViews * numberOfBricks, 0);
+
+  double origin[3], spacing[3];
+  this->Input->GetOrigin(origin);
+  this->Input->GetSpacing(spacing);
+  double voxelSize = (fabs(spacing[0]) + fabs(spacing[1]) + fabs(spacing[2])) / 3.0;
+  double width = this->ImageSize[0];
+  double height = this->ImageSize[1];
+  double aspect = width / height;
+
+  // A brick of edge s, whose centre is at depth z, covers about
+  // (s * pixelsPerUnit)^2 pixels and is crossed by s / (dt * 2^l) samples
+  // per ray at level l. Starting from full resolution, bricks are coarsened
+  // one level at a time, those whose voxels look smallest on screen first,
+  // until the estimated time fits 1 / DesiredUpdateRate.
+  std::vector<double> pixels(levels.size(), 0.0);
+  std::vector<double> length(levels.size(), 0.0);
+  typedef std::pair<double, vtkIdType> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > queue;
+  double total = 0.0;
+  for (int v = 0; v < numberOfViews; v++)
+    {
+    vtkCamera *camera = cameras[v];
+    double position[3], direction[3];
+    camera->GetPosition(position);
+    camera->GetDirectionOfProjection(direction);
+    vtkMatrix4x4 *projection = camera->GetCompositeProjectionTransformMatrix(aspect, -1, 1);
+    double viewHeight = 2.0 * camera->GetParallelScale();
+    double tanHalfAngle = tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2.0);
+    bool parallel = camera->GetParallelProjection() != 0;
+
+    for (vtkIdType b = 0; b < numberOfBricks; b++)
+      {
+      int extent[6];
+      pyramid->GetBrickExtent(b, extent);
+      double centre[4] = { 0.0, 0.0, 0.0, 1.0 };
+      double size = 0.0;
+      for (int a = 0; a < 3; a++)
+        {
+        centre[a] = origin[a] + 0.5 * (extent[2*a] + extent[2*a+1]) * spacing[a];
+        size += (extent[2*a+1] - extent[2*a] + 1) * fabs(spacing[a]) / 3.0;
+        }
+      double depth = (centre[0] - position[0]) * direction[0] +
+        (centre[1] - position[1]) * direction[1] + (centre[2] - position[2]) * direction[2];
+      if (!parallel && depth <= 0.0)
+        {
+        continue;
+        }
+      double pixelsPerUnit = height / (parallel ? viewHeight : 2.0 * depth * tanHalfAngle);
+      double ndc[4];
+      projection->MultiplyPoint(centre, ndc);
+      // Conservative NDC radius of the brick, for culling.
+      double radius = 2.0 * size * pixelsPerUnit / std::min(width, height);
+      if (ndc[3] <= 0.0 || fabs(ndc[0] / ndc[3]) > 1.0 + radius ||
+          fabs(ndc[1] / ndc[3]) > 1.0 + radius)
+        {
+        continue;
+        }
+
+      vtkIdType item = v * numberOfBricks + b;
+      double side = size * pixelsPerUnit;
+      pixels[item] = std::min(side * side, width * height);
+      length[item] = size / this->TableSampleDistance;
+      total += pixels[item] * length[item];
+      if (coarsest > 0)
+        {
+        queue.push(Candidate(2.0 * voxelSize * pixelsPerUnit, item));
+        }
+      }
+    }
+
+  double budget = 1.0 / (this->DesiredUpdateRate * this->SecondsPerSample);
+  while (total > budget && !queue.empty())
+    {
+    Candidate candidate = queue.top();
+    queue.pop();
+    vtkIdType item = candidate.second;
+    int level = ++levels[item];
+    total -= pixels[item] * length[item] / (1 << level);
+    if (level < coarsest)
+      {
+      queue.push(Candidate(2.0 * candidate.first, item));
+      }
+    }
+  return total;
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::RenderViews(int numberOfViews, vtkCamera **cameras,
+                                       vtkImageData **images)
+{
+  std::vector<unsigned char*> rgba(numberOfViews > 0 ? numberOfViews : 1, NULL);
+  for (int i = 0; i < numberOfViews; i++)
+    {
+    if (!images[i])
+      {
+      vtkErrorMacro(<< "View " << i << " has no output image");
+      return 0;
+      }
+    images[i]->SetDimensions(this->ImageSize[0], this->ImageSize[1], 1);
+    images[i]->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    rgba[i] = static_cast<unsigned char*>(images[i]->GetScalarPointer());
+    }
+  int result = this->RenderViews(numberOfViews, cameras, &rgba[0]);
+  for (int i = 0; i < numberOfViews; i++)
+    {
+    images[i]->Modified();
+    }
+  return result;
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::Render(vtkCamera *camera, vtkImageData *image)
+{
+  return this->RenderViews(1, &camera, &image);
+}
+
+//----------------------------------------------------------------------------
+int vtkCPUVolumeRayCaster::Render(vtkCamera *camera, unsigned char *rgba)
+{
+  return this->RenderViews(1, &camera, &rgba);
+}
+
+//----------------------------------------------------------------------------
+void vtkCPUVolumeRayCaster::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Input: " << this->Input << "\n";
+  os << indent << "Volume Property: " << this->VolumeProperty << "\n";
+  os << indent << "Blend Mode: "
+     << (this->BlendMode == VTK_CPU_RAYCAST_COMPOSITE_BLEND ?
+         "Composite\n" : "Maximum Intensity\n");
+  os << indent << "Image Size: (" << this->ImageSize[0] << ", "
+     << this->ImageSize[1] << ")\n";
+  os << indent << "Background: (" << this->Background[0] << ", "
+     << this->Background[1] << ", " << this->Background[2] << ", "
+     << this->Background[3] << ")\n";
+  os << indent << "Sample Distance: " << this->SampleDistance << "\n";
+  os << indent << "Tile Size: " << this->TileSize << "\n";
+  os << indent << "Desired Update Rate: " << this->DesiredUpdateRate << "\n";
+  os << indent << "Pyramid: " << this->Pyramid << "\n";
+  os << indent << "Preset Library: " << this->PresetLibrary << "\n";
+  os << indent << "Preset: " << this->Preset << "\n";
+  os << indent << "Last Render Time: " << this->LastRenderTime << "\n";
+  os << indent << "Last Coarsest Level: " << this->LastCoarsestLevel << "\n";
+  os << indent << "Abort Render: " << this->AbortRender.load() << "\n";
+}
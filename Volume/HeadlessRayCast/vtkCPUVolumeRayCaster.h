@@ -0,0 +1,262 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkCPUVolumeRayCaster.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkCPUVolumeRayCaster - headless CPU volume ray caster
+// .SECTION Description
+// vtkCPUVolumeRayCaster renders a vtkImageData volume into an in-memory
+// RGBA buffer without a render window or an OpenGL context, for batch
+// thumbnails and keyframes on servers without a GPU.
+//
+// Colour, scalar opacity, gradient opacity, interpolation and shading are
+// taken from a vtkVolumeProperty, so the same property that drives a
+// vtkFixedPointVolumeRayCastMapper on screen can be reused. The volume is
+// placed at its own world coordinates (as a vtkVolume with an identity
+// matrix), lit by a headlight, and only the first scalar component is used.
+//
+// RenderViews() renders several cameras of the same volume at once: the
+// transfer function tables are built once, and all tiles of all views are
+// distributed over the vtkSMPTools threads.
+//
+// With a DesiredUpdateRate the volume is drawn from a vtkVolumeBrickPyramid:
+// each brick is sampled from the finest level that keeps the estimated
+// frame time within 1 / DesiredUpdateRate, using a cost model calibrated
+// by the previous frames. Interactive applications set it from
+// vtkRenderWindow::GetDesiredUpdateRate(), so that renders during
+// interaction are coarse and the still render that follows is at full
+// resolution.
+//
+// RenderProgressive() draws an image in GetNumberOfProgressivePasses()
+// passes into the same buffer. Pass 0 casts one ray per 4x4 pixel block
+// with a 4x sample distance and is cheap enough for every interactive
+// frame; the following passes cast rays on finer, interleaved pixel grids
+// with shorter steps, and the last pass completes the full quality image.
+// A render can be cancelled: while the tiles are cast, the thread that
+// started the render invokes AbortCheckEvent every 10 ms, and an observer
+// that sees a pending event calls SetAbortRender(1). Every worker stops
+// at its next tile and the render returns 0.
+//
+// With a vtkVolumePresetLibrary and a Preset, the transfer functions,
+// shading and blend mode come from the preset instead of VolumeProperty
+// and BlendMode, and composite rays are classified with the preset's
+// pre-integrated tables: each pair of consecutive samples looks up the
+// colour and opacity of the whole segment between them. Thin features
+// then survive long steps, so the default sample distance becomes the
+// smallest voxel spacing rather than half of it. The library caches the
+// tables, so switching presets costs no transfer function re-sampling.
+//
+// The output pixels have straight (not premultiplied) alpha. The first row
+// is the bottom of the image, as in vtkImageData, so a vtkImageData filled
+// by Render() can be written by vtkPNGWriter directly.
+
+#ifndef __vtkCPUVolumeRayCaster_h
+#define __vtkCPUVolumeRayCaster_h
+
+#include "vtkObject.h"
+
+#include <atomic>
+#include <vector>
+
+class vtkCamera;
+class vtkImageData;
+class vtkVolumeBrickPyramid;
+class vtkVolumePresetLibrary;
+class vtkVolumeProperty;
+
+#define VTK_CPU_RAYCAST_COMPOSITE_BLEND 0
+#define VTK_CPU_RAYCAST_MAXIMUM_INTENSITY_BLEND 1
+
+class vtkCPUVolumeRayCaster : public vtkObject
+{
+public:
+  static vtkCPUVolumeRayCaster *New();
+  vtkTypeMacro(vtkCPUVolumeRayCaster, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // The volume to render.
+  virtual void SetInputData(vtkImageData *input);
+  vtkGetObjectMacro(Input, vtkImageData);
+
+  // Description:
+  // The property holding the transfer functions, interpolation type and
+  // shading parameters.
+  virtual void SetVolumeProperty(vtkVolumeProperty *property);
+  vtkGetObjectMacro(VolumeProperty, vtkVolumeProperty);
+
+  // Description:
+  // Composite (default) or maximum intensity projection.
+  vtkSetClampMacro(BlendMode, int, VTK_CPU_RAYCAST_COMPOSITE_BLEND,
+                   VTK_CPU_RAYCAST_MAXIMUM_INTENSITY_BLEND);
+  vtkGetMacro(BlendMode, int);
+  void SetBlendModeToComposite()
+    { this->SetBlendMode(VTK_CPU_RAYCAST_COMPOSITE_BLEND); }
+  void SetBlendModeToMaximumIntensity()
+    { this->SetBlendMode(VTK_CPU_RAYCAST_MAXIMUM_INTENSITY_BLEND); }
+
+  // Description:
+  // Size of the rendered images in pixels. Default is 256 x 256.
+  vtkSetVector2Macro(ImageSize, int);
+  vtkGetVector2Macro(ImageSize, int);
+
+  // Description:
+  // RGBA background the volume is composited over. Default is transparent
+  // black.
+  vtkSetVector4Macro(Background, double);
+  vtkGetVector4Macro(Background, double);
+
+  // Description:
+  // Distance between samples along a ray in world units. Values <= 0 (the
+  // default) use half of the smallest voxel spacing, or the smallest voxel
+  // spacing with pre-integration.
+  vtkSetMacro(SampleDistance, double);
+  vtkGetMacro(SampleDistance, double);
+
+  // Description:
+  // Edge length in pixels of the square tiles the images are split into
+  // for threading. Default is 32.
+  vtkSetClampMacro(TileSize, int, 4, 1024);
+  vtkGetMacro(TileSize, int);
+
+  // Description:
+  // Frames per second to aim for. 0 (the default) always renders the input
+  // at full resolution. A tiny rate, such as the interactor's still update
+  // rate, also gives full resolution but keeps the pyramid and the cost
+  // model up to date.
+  vtkSetClampMacro(DesiredUpdateRate, double, 0.0, VTK_DOUBLE_MAX);
+  vtkGetMacro(DesiredUpdateRate, double);
+
+  // Description:
+  // The pyramid used when DesiredUpdateRate > 0. The ray caster creates
+  // one; set a pyramid to share it between ray casters of the same volume.
+  // Its input is set to the input of the ray caster.
+  virtual void SetPyramid(vtkVolumeBrickPyramid *pyramid);
+  vtkGetObjectMacro(Pyramid, vtkVolumeBrickPyramid);
+
+  // Description:
+  // Library of transfer function presets and pre-integrated tables. The
+  // library can be shared between ray casters.
+  virtual void SetPresetLibrary(vtkVolumePresetLibrary *library);
+  vtkGetObjectMacro(PresetLibrary, vtkVolumePresetLibrary);
+
+  // Description:
+  // Index of the preset of PresetLibrary to render with, or -1 (the
+  // default) to use VolumeProperty and BlendMode. SetPreset(name) returns
+  // 0 if the library has no such preset.
+  vtkSetMacro(Preset, int);
+  vtkGetMacro(Preset, int);
+  int SetPreset(const char *name);
+
+  // Description:
+  // Seconds taken by the last render, and the coarsest pyramid level it
+  // used (0 when everything was at full resolution).
+  vtkGetMacro(LastRenderTime, double);
+  vtkGetMacro(LastCoarsestLevel, int);
+
+  // Description:
+  // Render one view into image, which is resized to ImageSize and given
+  // 4-component unsigned char scalars. Returns 1 on success.
+  int Render(vtkCamera *camera, vtkImageData *image);
+
+  // Description:
+  // Render one view into a caller-owned buffer of
+  // ImageSize[0] * ImageSize[1] * 4 bytes. Returns 1 on success.
+  int Render(vtkCamera *camera, unsigned char *rgba);
+
+  // Description:
+  // Render numberOfViews cameras in parallel, view i into rgba[i]
+  // (each ImageSize[0] * ImageSize[1] * 4 bytes) or images[i].
+  // Returns 1 on success.
+  int RenderViews(int numberOfViews, vtkCamera **cameras, unsigned char **rgba);
+  int RenderViews(int numberOfViews, vtkCamera **cameras, vtkImageData **images);
+
+  // Description:
+  // Render one progressive pass, 0 <= pass < GetNumberOfProgressivePasses(),
+  // into a buffer or image holding the previous passes for the same camera.
+  // The image is (re)allocated on pass 0. Returns 1 on success and 0 on
+  // error or when the pass was aborted.
+  int RenderProgressive(vtkCamera *camera, unsigned char *rgba, int pass);
+  int RenderProgressive(vtkCamera *camera, vtkImageData *image, int pass);
+  static int GetNumberOfProgressivePasses();
+
+  // Description:
+  // Set to 1 while rendering, typically from an AbortCheckEvent observer,
+  // to stop the render. It is reset when a render starts. Safe to call
+  // from any thread.
+  void SetAbortRender(int abort);
+  int GetAbortRender();
+
+protected:
+  vtkCPUVolumeRayCaster();
+  ~vtkCPUVolumeRayCaster();
+
+  // Render all views, in full or one progressive pass (pass >= 0).
+  int RenderPass(int numberOfViews, vtkCamera **cameras, unsigned char **rgba,
+                 int pass);
+
+  // The property and blend mode in use: those of the preset if one is set.
+  vtkVolumeProperty *GetActiveProperty();
+  int GetActiveBlendMode();
+  bool GetPreIntegrate();
+
+  // Rebuild the classification tables if the input or property changed.
+  // Returns 0 if there is nothing to render.
+  int UpdateTables(int numberOfLevels);
+  double GetEffectiveSampleDistance();
+
+  // Choose the pyramid level of each brick of each view. Returns the
+  // estimated number of samples.
+  double SelectLevels(int numberOfViews, vtkCamera **cameras,
+                      std::vector<unsigned char> &levels);
+
+  vtkImageData *Input;
+  vtkVolumeProperty *VolumeProperty;
+  int BlendMode;
+  int ImageSize[2];
+  double Background[4];
+  double SampleDistance;
+  int TileSize;
+  double DesiredUpdateRate;
+  vtkVolumeBrickPyramid *Pyramid;
+  vtkVolumePresetLibrary *PresetLibrary;
+  int Preset;
+
+  // Classification tables indexed by (scalar + TableShift) * TableScale.
+  // The gradient opacity table is indexed by |gradient| * GradientTableScale
+  // and is empty when gradient opacity is constant. There is one corrected
+  // opacity table per sample distance: per pyramid level, plus the longer
+  // steps of the progressive passes.
+  std::vector<float> ColorTable;
+  std::vector<float> OpacityTable;
+  std::vector<float> CorrectedOpacityTable;
+  std::vector<float> GradientOpacityTable;
+  double TableRange[2];
+  double TableShift;
+  double TableScale;
+  double GradientTableScale;
+  double TableSampleDistance;
+  int TableNumberOfLevels;
+  vtkVolumeProperty *TableProperty;
+  vtkTimeStamp TableBuildTime;
+
+  double SecondsPerSample;
+  double LastRenderTime;
+  int LastCoarsestLevel;
+  std::atomic<int> AbortRender;
+
+private:
+  vtkCPUVolumeRayCaster(const vtkCPUVolumeRayCaster&);  // Not implemented.
+  void operator=(const vtkCPUVolumeRayCaster&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,276 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkVolumeBrickPyramid.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkVolumeBrickPyramid.h"
+
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <limits>
+
+vtkStandardNewMacro(vtkVolumeBrickPyramid);
+
+namespace
+{
+// Averages blocks of 2x2x2 voxels of the first component of In into Out,
+// one output slice per work item. Blocks on an odd upper boundary are
+// averaged over the voxels that exist.
+template <class T>
+class Downsample
+{
+public:
+  const T *In;
+  T *Out;
+  int InDims[3];
+  int OutDims[3];
+  vtkIdType InIncrements[3];
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    T *out = this->Out + begin * this->OutDims[0] * this->OutDims[1];
+    for (vtkIdType k = begin; k < end; k++)
+      {
+      int k0 = static_cast<int>(2 * k);
+      int k1 = std::min(k0 + 1, this->InDims[2] - 1);
+      for (int j = 0; j < this->OutDims[1]; j++)
+        {
+        int j0 = 2 * j;
+        int j1 = std::min(j0 + 1, this->InDims[1] - 1);
+        for (int i = 0; i < this->OutDims[0]; i++)
+          {
+          int i0 = 2 * i;
+          int i1 = std::min(i0 + 1, this->InDims[0] - 1);
+          double sum = 0.0;
+          int count = 0;
+          for (int kk = k0; kk <= k1; kk++)
+            {
+            for (int jj = j0; jj <= j1; jj++)
+              {
+              const T *row = this->In + kk * this->InIncrements[2] + jj * this->InIncrements[1];
+              for (int ii = i0; ii <= i1; ii++)
+                {
+                sum += row[ii * this->InIncrements[0]];
+                count++;
+                }
+              }
+            }
+          double average = sum / count;
+          if (std::numeric_limits<T>::is_integer)
+            {
+            average = floor(average + 0.5);
+            }
+          *out++ = static_cast<T>(average);
+          }
+        }
+      }
+  }
+};
+
+template <class T>
+void DownsampleLevel(vtkImageData *input, vtkImageData *output)
+{
+  Downsample<T> downsample;
+  downsample.In = static_cast<const T*>(input->GetScalarPointer());
+  downsample.Out = static_cast<T*>(output->GetScalarPointer());
+  input->GetDimensions(downsample.InDims);
+  output->GetDimensions(downsample.OutDims);
+  downsample.InIncrements[0] = input->GetNumberOfScalarComponents();
+  downsample.InIncrements[1] = downsample.InIncrements[0] * downsample.InDims[0];
+  downsample.InIncrements[2] = downsample.InIncrements[1] * downsample.InDims[1];
+  vtkSMPTools::For(0, downsample.OutDims[2], downsample);
+}
+}
+
+//----------------------------------------------------------------------------
+vtkVolumeBrickPyramid::vtkVolumeBrickPyramid()
+{
+  this->Input = NULL;
+  this->BrickSize = 32;
+  this->MaximumNumberOfLevels = 4;
+  this->BrickDimensions[0] = this->BrickDimensions[1] = this->BrickDimensions[2] = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkVolumeBrickPyramid::~vtkVolumeBrickPyramid()
+{
+  this->SetInputData(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumeBrickPyramid::SetInputData(vtkImageData *input)
+{
+  if (this->Input == input)
+    {
+    return;
+    }
+  if (input)
+    {
+    input->Register(this);
+    }
+  if (this->Input)
+    {
+    this->Input->UnRegister(this);
+    }
+  this->ReleaseLevels();
+  this->Input = input;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumeBrickPyramid::ReleaseLevels()
+{
+  for (size_t i = 1; i < this->Levels.size(); i++)
+    {
+    this->Levels[i]->Delete();
+    }
+  this->Levels.clear();
+  this->BrickDimensions[0] = this->BrickDimensions[1] = this->BrickDimensions[2] = 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumeBrickPyramid::Update()
+{
+  if (!this->Input)
+    {
+    vtkErrorMacro(<< "No input volume");
+    return 0;
+    }
+  vtkDataArray *scalars = this->Input->GetPointData()->GetScalars();
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    vtkErrorMacro(<< "The input has no point scalars");
+    return 0;
+    }
+  if (!this->Levels.empty() && this->Levels[0] == this->Input &&
+      this->BuildTime > this->GetMTime() &&
+      this->BuildTime > this->Input->GetMTime() &&
+      this->BuildTime > scalars->GetMTime())
+    {
+    return 1;
+    }
+
+  this->ReleaseLevels();
+  this->Levels.push_back(this->Input);
+
+  int dims[3];
+  this->Input->GetDimensions(dims);
+  for (int a = 0; a < 3; a++)
+    {
+    this->BrickDimensions[a] = (dims[a] + this->BrickSize - 1) / this->BrickSize;
+    }
+
+  int brickSize = this->BrickSize;
+  while (static_cast<int>(this->Levels.size()) < this->MaximumNumberOfLevels &&
+         brickSize % 2 == 0 && brickSize >= 4)
+    {
+    vtkImageData *previous = this->Levels.back();
+    int previousDims[3], levelDims[3];
+    double origin[3], spacing[3];
+    previous->GetDimensions(previousDims);
+    previous->GetOrigin(origin);
+    previous->GetSpacing(spacing);
+    for (int a = 0; a < 3; a++)
+      {
+      levelDims[a] = (previousDims[a] + 1) / 2;
+      origin[a] += previousDims[a] > 1 ? 0.5 * spacing[a] : 0.0;
+      spacing[a] *= 2.0;
+      }
+
+    vtkImageData *level = vtkImageData::New();
+    level->SetDimensions(levelDims);
+    level->SetOrigin(origin);
+    level->SetSpacing(spacing);
+    level->AllocateScalars(scalars->GetDataType(), 1);
+    switch (scalars->GetDataType())
+      {
+      vtkTemplateMacro(DownsampleLevel<VTK_TT>(previous, level));
+      default:
+        vtkErrorMacro(<< "Unsupported scalar type " << scalars->GetDataTypeAsString());
+        level->Delete();
+        this->ReleaseLevels();
+        return 0;
+      }
+    this->Levels.push_back(level);
+    brickSize /= 2;
+    }
+
+  this->BuildTime.Modified();
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumeBrickPyramid::GetNumberOfLevels()
+{
+  return static_cast<int>(this->Levels.size());
+}
+
+//----------------------------------------------------------------------------
+vtkImageData *vtkVolumeBrickPyramid::GetLevel(int level)
+{
+  if (level < 0 || level >= static_cast<int>(this->Levels.size()))
+    {
+    return NULL;
+    }
+  return this->Levels[level];
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumeBrickPyramid::GetBrickDimensions(int dims[3])
+{
+  dims[0] = this->BrickDimensions[0];
+  dims[1] = this->BrickDimensions[1];
+  dims[2] = this->BrickDimensions[2];
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkVolumeBrickPyramid::GetNumberOfBricks()
+{
+  return static_cast<vtkIdType>(this->BrickDimensions[0]) *
+    this->BrickDimensions[1] * this->BrickDimensions[2];
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumeBrickPyramid::GetBrickExtent(vtkIdType brick, int extent[6])
+{
+  int dims[3] = { 0, 0, 0 };
+  if (this->Input)
+    {
+    this->Input->GetDimensions(dims);
+    }
+  vtkIdType index[3];
+  index[0] = brick % this->BrickDimensions[0];
+  index[1] = (brick / this->BrickDimensions[0]) % this->BrickDimensions[1];
+  index[2] = brick / (static_cast<vtkIdType>(this->BrickDimensions[0]) * this->BrickDimensions[1]);
+  for (int a = 0; a < 3; a++)
+    {
+    extent[2*a] = static_cast<int>(index[a] * this->BrickSize);
+    extent[2*a+1] = std::min(extent[2*a] + this->BrickSize, dims[a]) - 1;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumeBrickPyramid::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Input: " << this->Input << "\n";
+  os << indent << "Brick Size: " << this->BrickSize << "\n";
+  os << indent << "Maximum Number Of Levels: " << this->MaximumNumberOfLevels << "\n";
+  os << indent << "Number Of Levels: " << this->Levels.size() << "\n";
+  os << indent << "Brick Dimensions: (" << this->BrickDimensions[0] << ", "
+     << this->BrickDimensions[1] << ", " << this->BrickDimensions[2] << ")\n";
+}
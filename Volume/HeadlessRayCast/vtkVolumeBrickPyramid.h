@@ -0,0 +1,106 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkVolumeBrickPyramid.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkVolumeBrickPyramid - bricked multi-resolution copy of a volume
+// .SECTION Description
+// vtkVolumeBrickPyramid holds a volume at successively halved resolutions.
+// Level 0 is the input itself (not copied); level k averages 2x2x2 voxels
+// of level k-1 and keeps the first scalar component and the scalar type.
+// Its spacing is doubled and its origin shifted so that each voxel sits at
+// the centre of the voxels it averages.
+//
+// The input index space is split into bricks of BrickSize^3 voxels. A
+// brick covers the same region at every level, BrickSize / 2^k voxels wide
+// at level k, which lets a renderer choose the resolution brick by brick.
+// The number of levels is limited so that a brick is a whole number of
+// voxels, at least two, wide at every level.
+//
+// Update() rebuilds the levels only when the input, its scalars or the
+// pyramid parameters changed, so a pyramid can be kept with its volume and
+// shared by several renderers.
+//
+// .SECTION See Also
+// vtkCPUVolumeRayCaster
+
+#ifndef __vtkVolumeBrickPyramid_h
+#define __vtkVolumeBrickPyramid_h
+
+#include "vtkObject.h"
+
+#include <vector>
+
+class vtkImageData;
+
+class vtkVolumeBrickPyramid : public vtkObject
+{
+public:
+  static vtkVolumeBrickPyramid *New();
+  vtkTypeMacro(vtkVolumeBrickPyramid, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // The full resolution volume.
+  virtual void SetInputData(vtkImageData *input);
+  vtkGetObjectMacro(Input, vtkImageData);
+
+  // Description:
+  // Edge length of a brick in input voxels. Default is 32.
+  vtkSetClampMacro(BrickSize, int, 4, 256);
+  vtkGetMacro(BrickSize, int);
+
+  // Description:
+  // Upper limit on the number of levels, including the input. Default is 4.
+  vtkSetClampMacro(MaximumNumberOfLevels, int, 1, 8);
+  vtkGetMacro(MaximumNumberOfLevels, int);
+
+  // Description:
+  // Build the levels if they are out of date. Returns 0 if the input has
+  // no point scalars.
+  int Update();
+
+  // Description:
+  // The levels built by the last Update(). Level 0 is the input.
+  int GetNumberOfLevels();
+  vtkImageData *GetLevel(int level);
+
+  // Description:
+  // Number of bricks along each axis, and in total.
+  void GetBrickDimensions(int dims[3]);
+  vtkIdType GetNumberOfBricks();
+
+  // Description:
+  // Input index range [min, max] of the voxels in a brick, as
+  // (imin, imax, jmin, jmax, kmin, kmax).
+  void GetBrickExtent(vtkIdType brick, int extent[6]);
+
+protected:
+  vtkVolumeBrickPyramid();
+  ~vtkVolumeBrickPyramid();
+
+  void ReleaseLevels();
+
+  vtkImageData *Input;
+  int BrickSize;
+  int MaximumNumberOfLevels;
+
+  std::vector<vtkImageData*> Levels;
+  int BrickDimensions[3];
+  vtkTimeStamp BuildTime;
+
+private:
+  vtkVolumeBrickPyramid(const vtkVolumeBrickPyramid&);  // Not implemented.
+  void operator=(const vtkVolumeBrickPyramid&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,415 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkVolumePresetLibrary.cpp
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkVolumePresetLibrary.h"
+
+#include "vtkColorTransferFunction.h"
+#include "vtkCPUVolumeRayCaster.h"
+#include "vtkObjectFactory.h"
+#include "vtkPiecewiseFunction.h"
+#include "vtkSMPTools.h"
+#include "vtkVolumeProperty.h"
+
+#include <algorithm>
+#include <cmath>
+
+vtkStandardNewMacro(vtkVolumePresetLibrary);
+
+namespace
+{
+const int PreIntegratedTableSize = 256;
+
+// Copies the transfer functions and the shading parameters of source into
+// target, deep copying into the functions target already has.
+void CopyPreset(vtkVolumeProperty *source, vtkVolumeProperty *target)
+{
+  if (source->GetColorChannels() == 1)
+    {
+    vtkPiecewiseFunction *gray = vtkPiecewiseFunction::New();
+    gray->DeepCopy(source->GetGrayTransferFunction());
+    target->SetColor(gray);
+    gray->Delete();
+    }
+  else if (target->GetColorChannels() == 3)
+    {
+    target->GetRGBTransferFunction()->DeepCopy(source->GetRGBTransferFunction());
+    }
+  else
+    {
+    vtkColorTransferFunction *color = vtkColorTransferFunction::New();
+    color->DeepCopy(source->GetRGBTransferFunction());
+    target->SetColor(color);
+    color->Delete();
+    }
+  target->GetScalarOpacity()->DeepCopy(source->GetScalarOpacity());
+  target->GetGradientOpacity()->DeepCopy(source->GetGradientOpacity());
+  target->SetDisableGradientOpacity(source->GetDisableGradientOpacity());
+  target->SetScalarOpacityUnitDistance(source->GetScalarOpacityUnitDistance());
+  target->SetShade(source->GetShade());
+  target->SetAmbient(source->GetAmbient());
+  target->SetDiffuse(source->GetDiffuse());
+  target->SetSpecular(source->GetSpecular());
+  target->SetSpecularPower(source->GetSpecularPower());
+}
+
+// Integrates the segments ending at a range of back scalars. The scalar
+// moves linearly from front to back over the segment, which is split into
+// one sub-step per table bin it crosses; each sub-step is classified with
+// the interpolated extinction and colour and composited front to back.
+class PreIntegrate
+{
+public:
+  const float *Color;
+  const float *Extinction;
+  double SampleDistance;
+  float *Table;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const int size = PreIntegratedTableSize;
+    for (vtkIdType back = begin; back < end; back++)
+      {
+      float *out = this->Table + 4 * back * size;
+      for (int front = 0; front < size; front++, out += 4)
+        {
+        int steps = std::max(std::abs(static_cast<int>(back) - front), 1);
+        double ds = this->SampleDistance / steps;
+        double rgba[4] = { 0.0, 0.0, 0.0, 0.0 };
+        for (int k = 0; k < steps && rgba[3] < 0.999; k++)
+          {
+          double s = front + (back - front) * (k + 0.5) / steps;
+          int i = std::min(static_cast<int>(s), size - 2);
+          double f = s - i;
+          double tau = this->Extinction[i] + f * (this->Extinction[i+1] - this->Extinction[i]);
+          double alpha = 1.0 - exp(-tau * ds);
+          double weight = (1.0 - rgba[3]) * alpha;
+          for (int c = 0; c < 3; c++)
+            {
+            rgba[c] += weight *
+              (this->Color[3*i + c] + f * (this->Color[3*i + 3 + c] - this->Color[3*i + c]));
+            }
+          rgba[3] += weight;
+          }
+        for (int c = 0; c < 4; c++)
+          {
+          out[c] = static_cast<float>(rgba[c]);
+          }
+        }
+      }
+  }
+};
+}
+
+//----------------------------------------------------------------------------
+vtkVolumePresetLibrary::vtkVolumePresetLibrary()
+{
+  this->MaximumNumberOfTables = 16;
+  this->AddDefaultPresets();
+}
+
+//----------------------------------------------------------------------------
+vtkVolumePresetLibrary::~vtkVolumePresetLibrary()
+{
+  for (size_t i = 0; i < this->Presets.size(); i++)
+    {
+    this->Presets[i].Property->Delete();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumePresetLibrary::AddDefaultPresets()
+{
+  // The transfer functions of the VolumeRendering example.
+  vtkVolumeProperty *property = vtkVolumeProperty::New();
+  vtkColorTransferFunction *color = vtkColorTransferFunction::New();
+  vtkPiecewiseFunction *opacity = vtkPiecewiseFunction::New();
+  property->SetColor(color);
+  property->SetScalarOpacity(opacity);
+  property->ShadeOn();
+  property->SetAmbient(0.1);
+  property->SetDiffuse(0.9);
+  property->SetSpecular(0.2);
+  property->SetSpecularPower(10.0);
+  property->SetScalarOpacityUnitDistance(0.8919);
+
+  // CT_Skin
+  color->AddRGBPoint(-3024, 0, 0, 0, 0.5, 0.0);
+  color->AddRGBPoint(-1000, .62, .36, .18, 0.5, 0.0);
+  color->AddRGBPoint(-500, .88, .60, .29, 0.33, 0.45);
+  color->AddRGBPoint(3071, .83, .66, 1, 0.5, 0.0);
+  opacity->AddPoint(-3024, 0, 0.5, 0.0);
+  opacity->AddPoint(-1000, 0, 0.5, 0.0);
+  opacity->AddPoint(-500, 1.0, 0.33, 0.45);
+  opacity->AddPoint(3071, 1.0, 0.5, 0.0);
+  this->AddPreset("CT_Skin", property, VTK_CPU_RAYCAST_COMPOSITE_BLEND);
+
+  // CT_Bone
+  color->RemoveAllPoints();
+  color->AddRGBPoint(-3024, 0, 0, 0, 0.5, 0.0);
+  color->AddRGBPoint(-16, 0.73, 0.25, 0.30, 0.49, .61);
+  color->AddRGBPoint(641, .90, .82, .56, .5, 0.0);
+  color->AddRGBPoint(3071, 1, 1, 1, .5, 0.0);
+  opacity->RemoveAllPoints();
+  opacity->AddPoint(-3024, 0, 0.5, 0.0);
+  opacity->AddPoint(-16, 0, .49, .61);
+  opacity->AddPoint(641, .72, .5, 0.0);
+  opacity->AddPoint(3071, .71, 0.5, 0.0);
+  this->AddPreset("CT_Bone", property, VTK_CPU_RAYCAST_COMPOSITE_BLEND);
+
+  // CT_Muscle
+  color->RemoveAllPoints();
+  color->AddRGBPoint(-3024, 0, 0, 0, 0.5, 0.0);
+  color->AddRGBPoint(-155, .55, .25, .15, 0.5, .92);
+  color->AddRGBPoint(217, .88, .60, .29, 0.33, 0.45);
+  color->AddRGBPoint(420, 1, .94, .95, 0.5, 0.0);
+  color->AddRGBPoint(3071, .83, .66, 1, 0.5, 0.0);
+  opacity->RemoveAllPoints();
+  opacity->AddPoint(-3024, 0, 0.5, 0.0);
+  opacity->AddPoint(-155, 0, 0.5, 0.92);
+  opacity->AddPoint(217, .68, 0.33, 0.45);
+  opacity->AddPoint(420, .83, 0.5, 0.0);
+  opacity->AddPoint(3071, .80, 0.5, 0.0);
+  this->AddPreset("CT_Muscle", property, VTK_CPU_RAYCAST_COMPOSITE_BLEND);
+
+  // MIP: white, with the default opacity window 4096 and level 2048.
+  color->RemoveAllPoints();
+  color->AddRGBSegment(0.0, 1.0, 1.0, 1.0, 255.0, 1.0, 1.0, 1.0);
+  opacity->RemoveAllPoints();
+  opacity->AddSegment(0.0, 0.0, 4096.0, 1.0);
+  property->ShadeOff();
+  property->SetScalarOpacityUnitDistance(1.0);
+  this->AddPreset("MIP", property, VTK_CPU_RAYCAST_MAXIMUM_INTENSITY_BLEND);
+
+  color->Delete();
+  opacity->Delete();
+  property->Delete();
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::AddPreset(const char *name, vtkVolumeProperty *property,
+                                      int blendMode)
+{
+  if (!name || !property)
+    {
+    vtkErrorMacro(<< "A preset needs a name and a property");
+    return -1;
+    }
+  int preset = this->FindPreset(name);
+  if (preset < 0)
+    {
+    Preset entry;
+    entry.Name = name;
+    entry.Property = vtkVolumeProperty::New();
+    this->Presets.push_back(entry);
+    preset = static_cast<int>(this->Presets.size()) - 1;
+    }
+  // Replacing a preset modifies its property, which invalidates its tables.
+  CopyPreset(property, this->Presets[preset].Property);
+  this->Presets[preset].BlendMode = blendMode;
+  this->Modified();
+  return preset;
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::GetNumberOfPresets()
+{
+  return static_cast<int>(this->Presets.size());
+}
+
+//----------------------------------------------------------------------------
+const char *vtkVolumePresetLibrary::GetPresetName(int preset)
+{
+  if (preset < 0 || preset >= this->GetNumberOfPresets())
+    {
+    return NULL;
+    }
+  return this->Presets[preset].Name.c_str();
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::FindPreset(const char *name)
+{
+  for (size_t i = 0; name && i < this->Presets.size(); i++)
+    {
+    if (this->Presets[i].Name == name)
+      {
+      return static_cast<int>(i);
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkVolumeProperty *vtkVolumePresetLibrary::GetPresetProperty(int preset)
+{
+  if (preset < 0 || preset >= this->GetNumberOfPresets())
+    {
+    return NULL;
+    }
+  return this->Presets[preset].Property;
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::GetPresetBlendMode(int preset)
+{
+  if (preset < 0 || preset >= this->GetNumberOfPresets())
+    {
+    return VTK_CPU_RAYCAST_COMPOSITE_BLEND;
+    }
+  return this->Presets[preset].BlendMode;
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::ApplyPreset(int preset, vtkVolumeProperty *property)
+{
+  if (preset < 0 || preset >= this->GetNumberOfPresets() || !property)
+    {
+    vtkErrorMacro(<< "Invalid preset " << preset << " or no property");
+    return 0;
+    }
+  CopyPreset(this->Presets[preset].Property, property);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::ApplyPreset(const char *name, vtkVolumeProperty *property)
+{
+  int preset = this->FindPreset(name);
+  if (preset < 0)
+    {
+    vtkErrorMacro(<< "Unknown preset " << (name ? name : "(null)"));
+    return 0;
+    }
+  return this->ApplyPreset(preset, property);
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::GetPreIntegratedTableSize()
+{
+  return PreIntegratedTableSize;
+}
+
+//----------------------------------------------------------------------------
+const float *vtkVolumePresetLibrary::GetPreIntegratedTable(int preset,
+                                                           const double range[2],
+                                                           double sampleDistance)
+{
+  vtkVolumeProperty *property = this->GetPresetProperty(preset);
+  if (!property || sampleDistance <= 0.0)
+    {
+    vtkErrorMacro(<< "Invalid preset " << preset << " or sample distance "
+                  << sampleDistance);
+    return NULL;
+    }
+
+  // Most recently used first.
+  std::list<Table>::iterator table = this->Tables.begin();
+  for (; table != this->Tables.end(); ++table)
+    {
+    if (table->Property == property && table->Range[0] == range[0] &&
+        table->Range[1] == range[1] && table->SampleDistance == sampleDistance)
+      {
+      break;
+      }
+    }
+  if (table != this->Tables.end())
+    {
+    this->Tables.splice(this->Tables.begin(), this->Tables, table);
+    if (table->BuildTime > property->GetMTime())
+      {
+      return &table->Values[0];
+      }
+    }
+  else
+    {
+    this->Tables.push_front(Table());
+    table = this->Tables.begin();
+    table->Property = property;
+    table->Range[0] = range[0];
+    table->Range[1] = range[1];
+    table->SampleDistance = sampleDistance;
+    while (static_cast<int>(this->Tables.size()) > this->MaximumNumberOfTables)
+      {
+      this->Tables.pop_back();
+      }
+    }
+
+  const int size = PreIntegratedTableSize;
+  std::vector<float> color(3 * size);
+  if (property->GetColorChannels() == 1)
+    {
+    std::vector<float> gray(size);
+    property->GetGrayTransferFunction()->GetTable(range[0], range[1], size, &gray[0]);
+    for (int i = 0; i < size; i++)
+      {
+      color[3*i] = color[3*i+1] = color[3*i+2] = gray[i];
+      }
+    }
+  else
+    {
+    property->GetRGBTransferFunction()->GetTable(range[0], range[1], size, &color[0]);
+    }
+
+  // Opacity is given per ScalarOpacityUnitDistance; convert it to an
+  // extinction coefficient per world unit.
+  std::vector<float> extinction(size);
+  property->GetScalarOpacity()->GetTable(range[0], range[1], size, &extinction[0]);
+  double unitDistance = property->GetScalarOpacityUnitDistance();
+  if (unitDistance <= 0.0)
+    {
+    unitDistance = 1.0;
+    }
+  for (int i = 0; i < size; i++)
+    {
+    double alpha = std::min(std::max(static_cast<double>(extinction[i]), 0.0), 1.0 - 1e-6);
+    extinction[i] = static_cast<float>(-log(1.0 - alpha) / unitDistance);
+    }
+
+  table->Values.resize(4 * size * size);
+  PreIntegrate integrate;
+  integrate.Color = &color[0];
+  integrate.Extinction = &extinction[0];
+  integrate.SampleDistance = sampleDistance;
+  integrate.Table = &table->Values[0];
+  vtkSMPTools::For(0, size, integrate);
+  table->BuildTime.Modified();
+  return &table->Values[0];
+}
+
+//----------------------------------------------------------------------------
+int vtkVolumePresetLibrary::GetNumberOfTables()
+{
+  return static_cast<int>(this->Tables.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumePresetLibrary::ReleaseTables()
+{
+  this->Tables.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkVolumePresetLibrary::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Number Of Presets: " << this->Presets.size() << "\n";
+  for (size_t i = 0; i < this->Presets.size(); i++)
+    {
+    os << indent.GetNextIndent() << this->Presets[i].Name
+       << (this->Presets[i].BlendMode == VTK_CPU_RAYCAST_COMPOSITE_BLEND ?
+           " (Composite)\n" : " (Maximum Intensity)\n");
+    }
+  os << indent << "Maximum Number Of Tables: " << this->MaximumNumberOfTables << "\n";
+  os << indent << "Number Of Tables: " << this->Tables.size() << "\n";
+}
@@ -0,0 +1,132 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkVolumePresetLibrary.h
+
+  Copyright (c) A.Bin
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkVolumePresetLibrary - named transfer functions with pre-integrated tables
+// .SECTION Description
+// vtkVolumePresetLibrary holds named volume rendering presets: a colour
+// and opacity transfer function, shading parameters and a blend mode. The
+// library starts with the CT presets of the VolumeRendering example
+// (CT_Skin, CT_Bone, CT_Muscle) and a white MIP ramp (MIP); AddPreset()
+// adds more. ApplyPreset() copies a preset into a vtkVolumeProperty for
+// use with any mapper.
+//
+// GetPreIntegratedTable() returns a pre-integrated classification table
+// for a preset, a scalar range and a sample distance. Entry
+// (front, back) is the premultiplied RGBA of a ray segment one sample
+// distance long whose scalar varies linearly from front to back, so a
+// feature narrower than the sample distance still contributes when the
+// samples on either side straddle it. The tables are computed once and
+// kept in a least-recently-used cache, so switching between presets, or
+// between the step lengths of a level-of-detail renderer, does not
+// re-sample the transfer functions.
+//
+// .SECTION See Also
+// vtkCPUVolumeRayCaster
+
+#ifndef __vtkVolumePresetLibrary_h
+#define __vtkVolumePresetLibrary_h
+
+#include "vtkObject.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+class vtkVolumeProperty;
+
+class vtkVolumePresetLibrary : public vtkObject
+{
+public:
+  static vtkVolumePresetLibrary *New();
+  vtkTypeMacro(vtkVolumePresetLibrary, vtkObject);
+  void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Add a preset, or replace the preset of the same name, with a copy of
+  // property. blendMode is VTK_CPU_RAYCAST_COMPOSITE_BLEND or
+  // VTK_CPU_RAYCAST_MAXIMUM_INTENSITY_BLEND. Returns the preset index.
+  int AddPreset(const char *name, vtkVolumeProperty *property, int blendMode);
+
+  // Description:
+  // The presets, by index. FindPreset() returns -1 for an unknown name.
+  int GetNumberOfPresets();
+  const char *GetPresetName(int preset);
+  int FindPreset(const char *name);
+
+  // Description:
+  // The property and blend mode of a preset. Modifying the returned
+  // property invalidates the cached tables of the preset.
+  vtkVolumeProperty *GetPresetProperty(int preset);
+  int GetPresetBlendMode(int preset);
+
+  // Description:
+  // Copy the transfer functions and the shading parameters of a preset
+  // into property, keeping its transfer function objects. Returns 0 for an
+  // invalid preset.
+  int ApplyPreset(int preset, vtkVolumeProperty *property);
+  int ApplyPreset(const char *name, vtkVolumeProperty *property);
+
+  // Description:
+  // The pre-integrated table of a preset for scalars in range and segments
+  // of sampleDistance world units: GetPreIntegratedTableSize()^2 RGBA
+  // entries, premultiplied, at 4 * (back * size + front). Scalars map to
+  // index (s - range[0]) * (size - 1) / (range[1] - range[0]). The pointer
+  // stays valid for at least the next MaximumNumberOfTables - 1 requests.
+  // Returns NULL for an invalid preset.
+  const float *GetPreIntegratedTable(int preset, const double range[2],
+                                     double sampleDistance);
+  static int GetPreIntegratedTableSize();
+
+  // Description:
+  // Number of tables kept in the cache, 1 MiB each. Default is 16.
+  vtkSetClampMacro(MaximumNumberOfTables, int, 8, 1024);
+  vtkGetMacro(MaximumNumberOfTables, int);
+
+  // Description:
+  // Number of tables in the cache, and drop them all.
+  int GetNumberOfTables();
+  void ReleaseTables();
+
+protected:
+  vtkVolumePresetLibrary();
+  ~vtkVolumePresetLibrary();
+
+  void AddDefaultPresets();
+
+  struct Preset
+  {
+    std::string Name;
+    vtkVolumeProperty *Property;
+    int BlendMode;
+  };
+
+  struct Table
+  {
+    vtkVolumeProperty *Property;
+    double Range[2];
+    double SampleDistance;
+    vtkTimeStamp BuildTime;
+    std::vector<float> Values;
+  };
+
+  std::vector<Preset> Presets;
+  std::list<Table> Tables;
+  int MaximumNumberOfTables;
+
+private:
+  vtkVolumePresetLibrary(const vtkVolumePresetLibrary&);  // Not implemented.
+  void operator=(const vtkVolumePresetLibrary&);  // Not implemented.
+};
+
+#endif
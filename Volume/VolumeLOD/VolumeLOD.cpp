@@ -0,0 +1,192 @@
+/**********************************************************************
+
+Copyright (c) Mr.Bin. All rights reserved.
+For more information visit: http://blog.csdn.net/webzhuce
+
+**********************************************************************/
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkStructuredPointsReader.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkVolumeProperty.h>
+#include <vtkOutlineFilter.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkActor.h>
+#include <vtkProperty.h>
+#include <vtkImageActor.h>
+#include <vtkCamera.h>
+#include <vtkCommand.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkInteractorStyleTrackballCamera.h>
+#include "vtkCPUVolumeRayCaster.h"
+#include "vtkVolumeBrickPyramid.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+//Ray cast the volume with the camera of the scene before every render.
+//During interaction the window asks for the interactor's desired update
+//rate and the ray caster draws the bricks from coarser pyramid levels; the
+//still render after the interaction asks for the still update rate, which
+//refines every brick to full resolution.
+class vtkRayCastCallback : public vtkCommand
+{
+public:
+	static vtkRayCastCallback *New()
+	{
+		return new vtkRayCastCallback;
+	}
+
+	void SetRayCaster(vtkCPUVolumeRayCaster* rayCaster)
+	{
+		m_RayCaster = rayCaster;
+	}
+
+	void SetImage(vtkImageData* image)
+	{
+		m_Image = image;
+	}
+
+	void SetRenderers(vtkRenderer* sceneRenderer, vtkRenderer* imageRenderer)
+	{
+		m_SceneRenderer = sceneRenderer;
+		m_ImageRenderer = imageRenderer;
+	}
+
+	virtual void Execute(vtkObject *caller, unsigned long eventId, void* callData)
+	{
+		vtkRenderWindow* renWin = static_cast<vtkRenderWindow*>(caller);
+		int* size = renWin->GetSize();
+		m_RayCaster->SetImageSize(size[0], size[1]);
+		m_RayCaster->SetDesiredUpdateRate(renWin->GetDesiredUpdateRate());
+		m_RayCaster->Render(m_SceneRenderer->GetActiveCamera(), m_Image);
+
+		//show the image pixel for pixel
+		vtkCamera* camera = m_ImageRenderer->GetActiveCamera();
+		camera->ParallelProjectionOn();
+		camera->SetFocalPoint((size[0] - 1) / 2.0, (size[1] - 1) / 2.0, 0.0);
+		camera->SetPosition((size[0] - 1) / 2.0, (size[1] - 1) / 2.0, 1.0);
+		camera->SetViewUp(0.0, 1.0, 0.0);
+		camera->SetParallelScale(size[1] / 2.0);
+		camera->SetClippingRange(0.5, 1.5);
+
+		std::ostringstream title;
+		title << "VolumeLOD - level " << m_RayCaster->GetLastCoarsestLevel()
+			<< ", " << m_RayCaster->GetLastRenderTime() * 1000 << " ms";
+		renWin->SetWindowName(title.str().c_str());
+	}
+
+private:
+	vtkCPUVolumeRayCaster* m_RayCaster;
+	vtkImageData* m_Image;
+	vtkRenderer* m_SceneRenderer;
+	vtkRenderer* m_ImageRenderer;
+};
+
+//Usage: VolumeLOD [file.vtk] [-FrameRate fps]
+int main(int argc, char *argv[])
+{
+	const char* fileName = "E:\\TestData\\mummy.128.vtk";
+	double frameRate = 10.0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-FrameRate") == 0 && i + 1 < argc)
+		{
+			frameRate = atof(argv[++i]);
+		}
+		else
+		{
+			fileName = argv[i];
+		}
+	}
+
+	vtkSmartPointer<vtkStructuredPointsReader> reader =
+		vtkSmartPointer<vtkStructuredPointsReader>::New();
+	reader->SetFileName(fileName);
+	reader->Update();
+
+	vtkSmartPointer<vtkVolumeProperty> volumeProperty =
+		vtkSmartPointer<vtkVolumeProperty>::New();
+	volumeProperty->SetInterpolationTypeToLinear();
+	volumeProperty->ShadeOn();
+	volumeProperty->SetAmbient(0.4);
+	volumeProperty->SetDiffuse(0.6);
+	volumeProperty->SetSpecular(0.2);
+
+	vtkSmartPointer<vtkPiecewiseFunction> compositeOpacity =
+		vtkSmartPointer<vtkPiecewiseFunction>::New();
+	compositeOpacity->AddPoint(70,   0.00);
+	compositeOpacity->AddPoint(90,   0.40);
+	compositeOpacity->AddPoint(180,  0.60);
+	volumeProperty->SetScalarOpacity(compositeOpacity);
+
+	vtkSmartPointer<vtkColorTransferFunction> color =
+		vtkSmartPointer<vtkColorTransferFunction>::New();
+	color->AddRGBPoint(0.000,  0.00, 0.00, 0.00);
+	color->AddRGBPoint(64.00,  1.00, 0.52, 0.30);
+	color->AddRGBPoint(190.0,  1.00, 1.00, 1.00);
+	color->AddRGBPoint(220.0,  0.20, 0.20, 0.20);
+	volumeProperty->SetColor(color);
+
+	vtkSmartPointer<vtkCPUVolumeRayCaster> rayCaster =
+		vtkSmartPointer<vtkCPUVolumeRayCaster>::New();
+	rayCaster->SetInputData(reader->GetOutput());
+	rayCaster->SetVolumeProperty(volumeProperty);
+	rayCaster->SetBackground(1.0, 1.0, 1.0, 1.0);
+	rayCaster->GetPyramid()->SetBrickSize(32);
+	rayCaster->GetPyramid()->SetMaximumNumberOfLevels(4);
+
+	vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+	vtkSmartPointer<vtkImageActor> imageActor = vtkSmartPointer<vtkImageActor>::New();
+	imageActor->SetInputData(image);
+
+	//layer 0 shows the ray cast image, layer 1 holds the interactive camera
+	vtkSmartPointer<vtkRenderer> imageRenderer = vtkSmartPointer<vtkRenderer>::New();
+	imageRenderer->SetLayer(0);
+	imageRenderer->InteractiveOff();
+	imageRenderer->AddActor(imageActor);
+
+	vtkSmartPointer<vtkOutlineFilter> outline = vtkSmartPointer<vtkOutlineFilter>::New();
+	outline->SetInputConnection(reader->GetOutputPort());
+	vtkSmartPointer<vtkPolyDataMapper> outlineMapper =
+		vtkSmartPointer<vtkPolyDataMapper>::New();
+	outlineMapper->SetInputConnection(outline->GetOutputPort());
+	vtkSmartPointer<vtkActor> outlineActor = vtkSmartPointer<vtkActor>::New();
+	outlineActor->SetMapper(outlineMapper);
+	outlineActor->GetProperty()->SetColor(0.5, 0.5, 0.5);
+
+	vtkSmartPointer<vtkRenderer> sceneRenderer = vtkSmartPointer<vtkRenderer>::New();
+	sceneRenderer->SetLayer(1);
+	sceneRenderer->AddActor(outlineActor);
+	sceneRenderer->ResetCamera();
+
+	vtkSmartPointer<vtkRenderWindow> renWin = vtkSmartPointer<vtkRenderWindow>::New();
+	renWin->SetNumberOfLayers(2);
+	renWin->AddRenderer(imageRenderer);
+	renWin->AddRenderer(sceneRenderer);
+	renWin->SetSize(640, 480);
+
+	vtkSmartPointer<vtkRayCastCallback> callback =
+		vtkSmartPointer<vtkRayCastCallback>::New();
+	callback->SetRayCaster(rayCaster);
+	callback->SetImage(image);
+	callback->SetRenderers(sceneRenderer, imageRenderer);
+	renWin->AddObserver(vtkCommand::StartEvent, callback);
+
+	vtkSmartPointer<vtkRenderWindowInteractor> iren =
+		vtkSmartPointer<vtkRenderWindowInteractor>::New();
+	iren->SetRenderWindow(renWin);
+	iren->SetDesiredUpdateRate(frameRate);
+	vtkSmartPointer<vtkInteractorStyleTrackballCamera> style =
+		vtkSmartPointer<vtkInteractorStyleTrackballCamera>::New();
+	iren->SetInteractorStyle(style);
+
+	renWin->Render();
+	iren->Start();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/**********************************************************************
+
+Copyright (c) Mr.Bin. All rights reserved.
+For more information visit: http://blog.csdn.net/webzhuce
+
+**********************************************************************/
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkStructuredPointsReader.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkVolumeProperty.h>
+#include <vtkOutlineFilter.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkActor.h>
+#include <vtkProperty.h>
+#include <vtkImageActor.h>
+#include <vtkCamera.h>
+#include <vtkCommand.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkInteractorStyleTrackballCamera.h>
+#include "vtkCPUVolumeRayCaster.h"
+
+//Every render of the window (camera change, resize, expose) draws the cheap
+//first progressive pass. While the interactor is idle a repeating timer
+//draws the remaining passes one by one; a pass is cancelled as soon as an
+//event is pending, and the timer retries it once the event is handled.
+class vtkProgressiveCallback : public vtkCommand
+{
+public:
+	static vtkProgressiveCallback *New()
+	{
+		return new vtkProgressiveCallback;
+	}
+
+	vtkProgressiveCallback()
+	{
+		m_RayCaster = NULL;
+		m_Image = NULL;
+		m_SceneRenderer = NULL;
+		m_ImageRenderer = NULL;
+		m_RenderWindow = NULL;
+		m_NextPass = 0;
+		m_Refining = false;
+	}
+
+	void SetRayCaster(vtkCPUVolumeRayCaster* rayCaster)
+	{
+		m_RayCaster = rayCaster;
+	}
+
+	void SetImage(vtkImageData* image)
+	{
+		m_Image = image;
+	}
+
+	void SetRenderers(vtkRenderer* sceneRenderer, vtkRenderer* imageRenderer)
+	{
+		m_SceneRenderer = sceneRenderer;
+		m_ImageRenderer = imageRenderer;
+	}
+
+	void SetRenderWindow(vtkRenderWindow* renWin)
+	{
+		m_RenderWindow = renWin;
+	}
+
+	virtual void Execute(vtkObject *caller, unsigned long eventId, void* callData)
+	{
+		if (eventId == vtkCommand::StartEvent && !m_Refining)
+		{
+			//the scene changed: start over with the coarse pass
+			int* size = m_RenderWindow->GetSize();
+			m_RayCaster->SetImageSize(size[0], size[1]);
+			m_NextPass = 0;
+			RenderPass();
+			FitImageCamera(size);
+		}
+		else if (eventId == vtkCommand::TimerEvent &&
+			m_NextPass > 0 && m_NextPass < vtkCPUVolumeRayCaster::GetNumberOfProgressivePasses())
+		{
+			if (RenderPass())
+			{
+				m_Refining = true;
+				m_RenderWindow->Render();
+				m_Refining = false;
+			}
+		}
+		else if (eventId == vtkCommand::AbortCheckEvent && m_NextPass > 0)
+		{
+			//the first pass is never cancelled, there would be nothing to show
+			if (m_RenderWindow->GetEventPending())
+			{
+				m_RayCaster->SetAbortRender(1);
+			}
+		}
+	}
+
+private:
+	bool RenderPass()
+	{
+		if (m_RayCaster->RenderProgressive(m_SceneRenderer->GetActiveCamera(), m_Image, m_NextPass))
+		{
+			m_NextPass++;
+			return true;
+		}
+		if (!m_RayCaster->GetAbortRender())
+		{
+			//an error, not a cancellation: stop refining
+			m_NextPass = vtkCPUVolumeRayCaster::GetNumberOfProgressivePasses();
+		}
+		return false;
+	}
+
+	//show the image pixel for pixel
+	void FitImageCamera(int* size)
+	{
+		vtkCamera* camera = m_ImageRenderer->GetActiveCamera();
+		camera->ParallelProjectionOn();
+		camera->SetFocalPoint((size[0] - 1) / 2.0, (size[1] - 1) / 2.0, 0.0);
+		camera->SetPosition((size[0] - 1) / 2.0, (size[1] - 1) / 2.0, 1.0);
+		camera->SetViewUp(0.0, 1.0, 0.0);
+		camera->SetParallelScale(size[1] / 2.0);
+		camera->SetClippingRange(0.5, 1.5);
+	}
+
+	vtkCPUVolumeRayCaster* m_RayCaster;
+	vtkImageData* m_Image;
+	vtkRenderer* m_SceneRenderer;
+	vtkRenderer* m_ImageRenderer;
+	vtkRenderWindow* m_RenderWindow;
+	int m_NextPass;
+	bool m_Refining;
+};
+
+int main(int argc, char *argv[])
+{
+	vtkSmartPointer<vtkStructuredPointsReader> reader =
+		vtkSmartPointer<vtkStructuredPointsReader>::New();
+	reader->SetFileName(argc > 1 ? argv[1] : "E:\\TestData\\mummy.128.vtk");
+	reader->Update();
+
+	vtkSmartPointer<vtkVolumeProperty> volumeProperty =
+		vtkSmartPointer<vtkVolumeProperty>::New();
+	volumeProperty->SetInterpolationTypeToLinear();
+	volumeProperty->ShadeOn();
+	volumeProperty->SetAmbient(0.4);
+	volumeProperty->SetDiffuse(0.6);
+	volumeProperty->SetSpecular(0.2);
+
+	vtkSmartPointer<vtkPiecewiseFunction> compositeOpacity =
+		vtkSmartPointer<vtkPiecewiseFunction>::New();
+	compositeOpacity->AddPoint(70,   0.00);
+	compositeOpacity->AddPoint(90,   0.40);
+	compositeOpacity->AddPoint(180,  0.60);
+	volumeProperty->SetScalarOpacity(compositeOpacity);
+
+	vtkSmartPointer<vtkColorTransferFunction> color =
+		vtkSmartPointer<vtkColorTransferFunction>::New();
+	color->AddRGBPoint(0.000,  0.00, 0.00, 0.00);
+	color->AddRGBPoint(64.00,  1.00, 0.52, 0.30);
+	color->AddRGBPoint(190.0,  1.00, 1.00, 1.00);
+	color->AddRGBPoint(220.0,  0.20, 0.20, 0.20);
+	volumeProperty->SetColor(color);
+
+	vtkSmartPointer<vtkCPUVolumeRayCaster> rayCaster =
+		vtkSmartPointer<vtkCPUVolumeRayCaster>::New();
+	rayCaster->SetInputData(reader->GetOutput());
+	rayCaster->SetVolumeProperty(volumeProperty);
+	rayCaster->SetBackground(1.0, 1.0, 1.0, 1.0);
+
+	vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+	vtkSmartPointer<vtkImageActor> imageActor = vtkSmartPointer<vtkImageActor>::New();
+	imageActor->SetInputData(image);
+
+	//layer 0 shows the ray cast image, layer 1 holds the interactive camera
+	vtkSmartPointer<vtkRenderer> imageRenderer = vtkSmartPointer<vtkRenderer>::New();
+	imageRenderer->SetLayer(0);
+	imageRenderer->InteractiveOff();
+	imageRenderer->AddActor(imageActor);
+
+	vtkSmartPointer<vtkOutlineFilter> outline = vtkSmartPointer<vtkOutlineFilter>::New();
+	outline->SetInputConnection(reader->GetOutputPort());
+	vtkSmartPointer<vtkPolyDataMapper> outlineMapper =
+		vtkSmartPointer<vtkPolyDataMapper>::New();
+	outlineMapper->SetInputConnection(outline->GetOutputPort());
+	vtkSmartPointer<vtkActor> outlineActor = vtkSmartPointer<vtkActor>::New();
+	outlineActor->SetMapper(outlineMapper);
+	outlineActor->GetProperty()->SetColor(0.5, 0.5, 0.5);
+
+	vtkSmartPointer<vtkRenderer> sceneRenderer = vtkSmartPointer<vtkRenderer>::New();
+	sceneRenderer->SetLayer(1);
+	sceneRenderer->AddActor(outlineActor);
+	sceneRenderer->ResetCamera();
+
+	vtkSmartPointer<vtkRenderWindow> renWin = vtkSmartPointer<vtkRenderWindow>::New();
+	renWin->SetNumberOfLayers(2);
+	renWin->AddRenderer(imageRenderer);
+	renWin->AddRenderer(sceneRenderer);
+	renWin->SetSize(640, 480);
+	renWin->SetWindowName("VolumeProgressive");
+
+	vtkSmartPointer<vtkRenderWindowInteractor> iren =
+		vtkSmartPointer<vtkRenderWindowInteractor>::New();
+	iren->SetRenderWindow(renWin);
+	vtkSmartPointer<vtkInteractorStyleTrackballCamera> style =
+		vtkSmartPointer<vtkInteractorStyleTrackballCamera>::New();
+	iren->SetInteractorStyle(style);
+
+	vtkSmartPointer<vtkProgressiveCallback> callback =
+		vtkSmartPointer<vtkProgressiveCallback>::New();
+	callback->SetRayCaster(rayCaster);
+	callback->SetImage(image);
+	callback->SetRenderers(sceneRenderer, imageRenderer);
+	callback->SetRenderWindow(renWin);
+	renWin->AddObserver(vtkCommand::StartEvent, callback);
+	iren->AddObserver(vtkCommand::TimerEvent, callback);
+	rayCaster->AddObserver(vtkCommand::AbortCheckEvent, callback);
+
+	iren->Initialize();
+	iren->CreateRepeatingTimer(10);
+	renWin->Render();
+	iren->Start();
+
+	return EXIT_SUCCESS;
+}
@@ -55,6 +55,13 @@ For more information visit:  http://blog.csdn.net/webzhuce
 #include "vtkPointHandleRepresentation3D.h"
 #include "vtkPointHandleRepresentation2D.h"
 #include "vtkCallbackCommand.h"
+#include "vtkDICOMSeriesLoader.h"
+#include "vtkMappedVolumeCache.h"
+#include <QApplication>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QStandardPaths>
+#include <QTimer>
 
 int pressCounts = 0;
 
@@ -63,14 +70,49 @@ void MyCallbackFunc(vtkObject*, unsigned long eid, void* clientdata, void *calld
 	std::cout << "You have clicked: " << ++pressCounts << " times." << std::endl;
 }
 
+// Show the progress of the series loader and keep the window responsive;
+// Cancel aborts the load.
+void LoadProgressFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+	vtkDICOMSeriesLoader *loader = static_cast<vtkDICOMSeriesLoader*>(caller);
+	QProgressDialog *dialog = static_cast<QProgressDialog*>(clientdata);
+	dialog->setValue(static_cast<int>(*static_cast<double*>(calldata) * 100));
+	QApplication::processEvents();
+	if (dialog->wasCanceled())
+	{
+		loader->SetAbortExecute(1);
+	}
+}
+
 ProjectMainWindow::ProjectMainWindow()
 {
 	setupUi(this);
-    vtkSmartPointer<vtkDICOMImageReader> reader = vtkSmartPointer< vtkDICOMImageReader >::New();
+    vtkSmartPointer<vtkDICOMSeriesLoader> reader = vtkSmartPointer< vtkDICOMSeriesLoader >::New();
     reader->SetDirectoryName("E:\\TestData\\dcm");
+    // Reopening the same study maps the volume decoded the first time.
+    vtkSmartPointer<vtkMappedVolumeCache> cache = vtkSmartPointer<vtkMappedVolumeCache>::New();
+    cache->SetDirectory((QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/volumes").toLocal8Bit().constData());
+    reader->SetCache(cache);
+    QProgressDialog progressDialog("Loading DICOM series...", "Cancel", 0, 100);
+    progressDialog.setWindowModality(Qt::ApplicationModal);
+    progressDialog.setMinimumDuration(500);
+    vtkSmartPointer<vtkCallbackCommand> progressCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    progressCallback->SetCallback(LoadProgressFunc);
+    progressCallback->SetClientData(&progressDialog);
+    reader->AddObserver(vtkCommand::ProgressEvent, progressCallback);
     reader->Update();
+    reader->RemoveObserver(progressCallback);
+    bool canceled = progressDialog.wasCanceled();
+    progressDialog.reset();
     int imageDims[3];
     reader->GetOutput()->GetDimensions(imageDims);
+    if (imageDims[0] < 1 || imageDims[1] < 1 || imageDims[2] < 1)
+    {
+        // Cancelled or failed: there is no volume to set the viewers up with.
+        QMessageBox::warning(this, "CTViewer", canceled ? "Loading the DICOM series was cancelled." : "Cannot load the DICOM series.");
+        QTimer::singleShot(0, this, SLOT(close()));
+        return;
+    }
 	
     for(int i = 0; i < 3; i++)
     {
@@ -4,7 +4,7 @@
 #include "vtkBoundedPlanePointPlacer.h"
 #include "vtkCellPicker.h"
 #include "vtkCommand.h"
-#include "vtkDICOMImageReader.h"
+#include "vtkDICOMSeriesLoader.h"
 #include "vtkDistanceRepresentation.h"
 #include "vtkDistanceRepresentation2D.h"
 #include "vtkDistanceWidget.h"
@@ -15,6 +15,7 @@
 #include "vtkImageSlabReslice.h"
 #include "vtkInteractorStyleImage.h"
 #include "vtkLookupTable.h"
+#include "vtkMappedVolumeCache.h"
 #include "vtkPlane.h"
 #include "vtkPlaneSource.h"
 #include "vtkPointHandleRepresentation2D.h"
@@ -31,6 +32,42 @@
 #include "vtkResliceCursor.h"
 #include "vtkResliceImageViewerMeasurements.h"
 
+#include <QApplication>
+#include <QDir>
+#include <QMessageBox>
+#include <QProgressDialog>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+#include <QTimer>
+
+//----------------------------------------------------------------------------
+// Shows the progress of the series loader while keeping the window
+// responsive; Cancel aborts the load.
+class vtkLoadProgressCallback : public vtkCommand
+{
+public:
+  static vtkLoadProgressCallback *New()
+  { return new vtkLoadProgressCallback; }
+
+  void Execute( vtkObject *caller, unsigned long vtkNotUsed(ev),
+                void *callData )
+  {
+    vtkDICOMSeriesLoader *loader =
+      static_cast< vtkDICOMSeriesLoader* >( caller );
+    double progress = *static_cast< double* >( callData );
+    this->Dialog->setValue(static_cast<int>(progress * 100));
+    QApplication::processEvents();
+    if (this->Dialog->wasCanceled())
+    {
+      loader->SetAbortExecute(1);
+    }
+  }
+
+  vtkLoadProgressCallback() : Dialog(NULL) {}
+  QProgressDialog *Dialog;
+};
+
 //----------------------------------------------------------------------------
 class vtkResliceCursorCallback : public vtkCommand
 {
@@ -122,12 +159,43 @@ QtVTKRenderWindows::QtVTKRenderWindows( int vtkNotUsed(argc), char *argv[])
   this->ui = new Ui_QtVTKRenderWindows;
   this->ui->setupUi(this);
 
-  vtkSmartPointer< vtkDICOMImageReader > reader =
-    vtkSmartPointer< vtkDICOMImageReader >::New();
+  vtkSmartPointer< vtkDICOMSeriesLoader > reader =
+    vtkSmartPointer< vtkDICOMSeriesLoader >::New();
   reader->SetDirectoryName(argv[1]);
+  // Reopening the same study maps the volume decoded the first time.
+#if QT_VERSION >= 0x050000
+  QString cacheLocation =
+    QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+  QString cacheLocation = QDir::tempPath();
+#endif
+  vtkSmartPointer< vtkMappedVolumeCache > cache =
+    vtkSmartPointer< vtkMappedVolumeCache >::New();
+  cache->SetDirectory(
+    (cacheLocation + "/volumes").toLocal8Bit().constData());
+  reader->SetCache(cache);
+  QProgressDialog progressDialog("Loading DICOM series...", "Cancel", 0, 100);
+  progressDialog.setWindowModality(Qt::ApplicationModal);
+  progressDialog.setMinimumDuration(500);
+  vtkSmartPointer< vtkLoadProgressCallback > progressCallback =
+    vtkSmartPointer< vtkLoadProgressCallback >::New();
+  progressCallback->Dialog = &progressDialog;
+  reader->AddObserver(vtkCommand::ProgressEvent, progressCallback);
   reader->Update();
+  reader->RemoveObserver(progressCallback);
+  bool canceled = progressDialog.wasCanceled();
+  progressDialog.reset();
   int imageDims[3];
   reader->GetOutput()->GetDimensions(imageDims);
+  if (imageDims[0] < 1 || imageDims[1] < 1 || imageDims[2] < 1)
+  {
+    // Cancelled or failed: there is no volume to set the viewers up with.
+    QMessageBox::warning(this, "QtVTKRenderWindows", canceled ?
+      "Loading the DICOM series was cancelled." :
+      "Cannot load the DICOM series.");
+    QTimer::singleShot(0, this, SLOT(close()));
+    return;
+  }
 
 
   for (int i = 0; i < 3; i++)